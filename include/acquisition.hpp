@@ -3,10 +3,12 @@
 #ifndef NN_ACQUISITION_HPP
 #define NN_ACQUISITION_HPP
 
-// This path is the only one relative to "acquisition.hpp"
+// These two paths are the only ones relative to "acquisition.hpp"
 #include "pattern.hpp"
+#include "thread_pool.hpp"
 
 #include <SFML/Graphics.hpp>
+#include <cstddef>
 #include <filesystem>
 #include <vector>
 
@@ -28,14 +30,19 @@ sf::Image resize_image(sf::Image const& image, unsigned int width,
 Pattern binarize_image(sf::Image const& image, unsigned int width,
                        unsigned int height, sf::Uint8 threshold);
 
+// Images waiting between two stages of the acquisition pipeline, per stage
+constexpr std::size_t default_acquisition_queue_capacity{16};
+
 class Acquisition
 {
  private:
   std::vector<Pattern> patterns_; // Not necessary but useful in testing
+  std::vector<std::filesystem::path> names_; // The ".txt" names of patterns_
   const std::filesystem::path source_directory_;
   const std::filesystem::path binarized_directory_;
   const std::filesystem::path patterns_directory_;
   const std::vector<std::filesystem::path> extensions_allowed_;
+  const Dimensions dimensions_;
 
   void validate_source_directory_() const;
   void configure_output_directories_() const;
@@ -45,21 +52,42 @@ class Acquisition
    * Given the current structure of the project root, base_directory can only be
    * "" or "tests/" to differentiate ordinary code execution from test
    * execution. Alternatively the program throws an error since the
-   * source_directory_ does not exist.
+   * source_directory_ does not exist. Images are resized to dimensions.
    */
-  Acquisition(std::filesystem::path const& base_directory);
+  Acquisition(std::filesystem::path const& base_directory,
+              Dimensions dimensions = default_dimensions);
 
   Acquisition();
 
   const std::vector<Pattern>& patterns() const;
 
-  // Acquires images from "../base_directory/images/source_images/" and saves
-  // patterns in a one-line .txt file in "../base_directory/patterns/"
+  Dimensions dimensions() const;
+
+  /*
+   * Acquires images from "../base_directory/images/source_images/" and saves
+   * patterns in a .txt file in "../base_directory/patterns/", a header line
+   * with the dimensions followed by the values on one line, and their
+   * binarized images in "../base_directory/images/binarized_images/".
+   *
+   * The images go through four stages, decoding, resizing, binarization and
+   * writing, run by the threads of pool on whichever images are ready, the
+   * later stages first; at most queue_capacity images wait between two
+   * stages, which bounds the memory whatever the size of the corpus. The
+   * files are taken in the order of their names, and patterns() and the
+   * written files do not depend on the number of threads. If an image cannot
+   * be acquired, the exception of the first one in that order is rethrown,
+   * the patterns before it being acquired and saved, and the files written
+   * for it or for the images after it removed.
+   */
+  void acquire_and_save_patterns(
+      Thread_Pool& pool,
+      std::size_t queue_capacity = default_acquisition_queue_capacity);
+
+  // As above, one image at a time on the calling thread
   void acquire_and_save_patterns();
 
-  // Saves binarized images in "../base_directory/images/binarized_images/"
-  // binarized images are constructed by loading patterns stored in
-  // "../base_directory/patterns/"
+  // Saves again the binarized images of the acquired patterns, from memory,
+  // in "../base_directory/images/binarized_images/"
   void save_binarized_images() const;
 };
 
@@ -0,0 +1,98 @@
+// All relative paths are relative to the build/ directory
+
+#ifndef NN_BINARY_FORMAT_HPP
+#define NN_BINARY_FORMAT_HPP
+
+// This path is the only one relative to "binary_format.hpp"
+#include "dimensions.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+namespace nn {
+
+// Helpers shared by the binary files of Weight_Matrix, Pattern_Memory and
+// Tiled_Weight_Matrix, whose 64-byte headers start with an 8-byte magic and a
+// 32-bit version, and store the number of neurons and the dimensions
+
+// FNV-1a hash of the 64-bit words word(element) of the elements
+template<class Element, class Word = std::identity>
+std::uint64_t fnv1a_checksum(std::span<const Element> elements, Word word = {})
+{
+  std::uint64_t hash{14'695'981'039'346'656'037ull};
+  for (auto const& element : elements) {
+    hash ^= static_cast<std::uint64_t>(word(element));
+    hash *= 1'099'511'628'211ull;
+  }
+
+  return hash;
+}
+
+// Throws error("Not a <kind> file.") if header has not the given magic and
+// error("Unsupported version: ...") if it has not the given version; error
+// returns the exception to throw from a message
+template<class Header, class Error>
+void check_binary_header(Header const& header, const char (&magic)[8],
+                         std::uint32_t version, std::string const& kind,
+                         Error&& error)
+{
+  static_assert(sizeof(header.magic) == sizeof(magic));
+  if (std::memcmp(header.magic, magic, sizeof(magic)) != 0) {
+    throw error("Not a " + kind + " file.");
+  }
+  if (header.version != version) {
+    throw error("Unsupported version: " + std::to_string(header.version));
+  }
+}
+
+// Header of the file at path; throws a std::runtime_error if it cannot be
+// read or has not the given magic, the version being left to the caller
+template<class Header>
+Header read_binary_header(std::filesystem::path const& path,
+                          const char (&magic)[8], std::string const& kind)
+{
+  std::ifstream infile{path, std::ios::binary};
+
+  if (!infile) {
+    throw std::runtime_error("File \"" + path.string()
+                             + "\" not opened successfully.");
+  }
+
+  Header header;
+  if (!infile.read(reinterpret_cast<char*>(&header), sizeof(header))
+      || std::memcmp(header.magic, magic, sizeof(magic)) != 0) {
+    throw std::runtime_error("Error in file \"" + path.string()
+                             + "\".\nNot a " + kind + " file.");
+  }
+
+  return header;
+}
+
+// Dimensions stored in header, read from the file at path, or
+// square_dimensions() of its number of neurons if they are unknown
+template<class Header>
+Dimensions binary_header_dimensions(Header const& header,
+                                    std::filesystem::path const& path)
+{
+  if (header.width == 0 && header.height == 0) {
+    return square_dimensions(header.neurons);
+  }
+  Dimensions dimensions{header.width, header.height};
+  if (dimensions.neurons() != header.neurons) {
+    throw std::runtime_error(
+        "Error in file \"" + path.string()
+        + "\".\nDimensions do not match the number of neurons.");
+  }
+
+  return dimensions;
+}
+
+} // namespace nn
+
+#endif
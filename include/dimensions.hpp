@@ -0,0 +1,58 @@
+// All relative paths are relative to the build/ directory
+
+#ifndef NN_DIMENSIONS_HPP
+#define NN_DIMENSIONS_HPP
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+namespace nn {
+
+// Size of the images of a network: a pattern has width * height neurons,
+// stored row by row. Every count derived from it is a 64-bit std::size_t: a
+// 256x256 network has 65536 neurons and 2'147'450'880 weights.
+struct Dimensions
+{
+  unsigned int width;
+  unsigned int height;
+
+  constexpr std::size_t neurons() const
+  {
+    return std::size_t{width} * std::size_t{height};
+  }
+
+  // Number of weights of the packed upper triangle, N * (N - 1) / 2
+  constexpr std::size_t weights() const
+  {
+    return neurons() == 0 ? 0 : neurons() * (neurons() - 1) / 2;
+  }
+
+  bool operator==(Dimensions const& other) const = default;
+};
+
+// Dimensions used when none is given
+constexpr Dimensions default_dimensions{64, 64};
+
+// Dimensions of a square network of the given number of neurons, used for the
+// files written before the dimensions were stored; throws if neurons is not a
+// perfect square
+inline Dimensions square_dimensions(std::size_t neurons)
+{
+  std::size_t side{0};
+  while ((side + 1) * (side + 1) <= neurons) {
+    ++side;
+  }
+  if (side * side != neurons || side == 0) {
+    throw std::runtime_error(
+        "Dimensions of a network of " + std::to_string(neurons)
+        + " neurons not found.\nThe number of neurons must be a perfect square "
+          "or the dimensions must be stored in the file.");
+  }
+
+  return {static_cast<unsigned int>(side), static_cast<unsigned int>(side)};
+}
+
+} // namespace nn
+
+#endif
\ No newline at end of file
@@ -0,0 +1,350 @@
+// All relative paths are relative to the build/ directory
+
+#ifndef NN_NETWORK_HPP
+#define NN_NETWORK_HPP
+
+// These two paths are the only ones relative to "network.hpp"
+#include "recall.hpp"
+#include "weight_matrix.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace nn {
+
+// Synchronous dynamics of single states against a trained weight matrix,
+// which must outlive the network. The local fields are computed once per
+// state and then updated with the neurons flipped by every update, as in
+// Recall. A network keeps its working buffers, so it must not be used by two
+// threads at once.
+class Network_Base
+{
+ public:
+  virtual ~Network_Base() = default;
+
+  virtual Dimensions dimensions() const = 0;
+
+  // Equal to hopfield_local_fields()
+  virtual std::vector<double>
+  local_fields(std::vector<int> const& state) const = 0;
+
+  // Equal to hopfield_energy()
+  virtual double energy(std::vector<int> const& state) const = 0;
+
+  // Versions of hopfield_local_fields() and update_local_fields() writing
+  // into a buffer of N local fields owned by the caller, which allocate
+  // nothing; used by the serial synchronous updates of Recall
+  virtual void local_fields(std::vector<int> const& state,
+                            std::span<double> fields) const = 0;
+
+  virtual void update_local_fields(std::span<double> fields,
+                                   std::vector<std::size_t> const& flipped,
+                                   std::vector<int> const& state) const = 0;
+
+  // Updates state until an update leaves it unchanged, performing at most
+  // max_iterations updates; returns the number of updates performed, counted
+  // as Recall::current_iteration()
+  virtual std::size_t update_dynamics(std::vector<int>& state,
+                                      std::size_t max_iterations) = 0;
+};
+
+// Any dimensions, storage and layout, through the free functions of Recall
+class Generic_Network : public Network_Base
+{
+ private:
+  Weight_Matrix const& weight_matrix_;
+  const Dimensions dimensions_;
+  std::vector<double> local_fields_;
+  std::vector<std::size_t> flipped_;
+
+ public:
+  Generic_Network(Weight_Matrix const& weight_matrix, Dimensions dimensions);
+
+  Dimensions dimensions() const override;
+
+  std::vector<double>
+  local_fields(std::vector<int> const& state) const override;
+
+  double energy(std::vector<int> const& state) const override;
+
+  void local_fields(std::vector<int> const& state,
+                    std::span<double> fields) const override;
+
+  void update_local_fields(std::span<double> fields,
+                           std::vector<std::size_t> const& flipped,
+                           std::vector<int> const& state) const override;
+
+  std::size_t update_dynamics(std::vector<int>& state,
+                              std::size_t max_iterations) override;
+};
+
+/*
+ * Network of Width * Height neurons known at compile time, on a weight matrix
+ * with Weight_Storage::real and Weight_Layout::packed. States and local fields
+ * are std::arrays, the offsets of the rows of the packed triangle are a
+ * constexpr table and every loop has a compile-time bound, so that the
+ * compiler can unroll and vectorize them. The results are equal to the ones
+ * of Generic_Network: the products are added in the same order. A
+ * Network<256, 256> holds 1.5 MiB of buffers, the local fields, the scratch
+ * fields and the flipped neurons, 3 * 65,536 * 8 bytes, and is better
+ * allocated on the heap, as make_network() does. The const energy() writes
+ * the mutable scratch fields, so even calling it from two threads at once is
+ * a data race.
+ */
+template<unsigned int Width, unsigned int Height>
+class Network : public Network_Base
+{
+ public:
+  static constexpr std::size_t neurons{std::size_t{Width} * Height};
+
+  using State  = std::array<int, neurons>;
+  using Fields = std::array<double, neurons>;
+
+ private:
+  // row_offsets_[i] is the position in the packed triangle of w_(i+1)(i+2),
+  // the first weight of the (i + 1)-th row; w_(i+1)(j+1) with i < j is at
+  // row_offsets_[i] + j - i - 1
+  static constexpr std::array<std::size_t, neurons> row_offsets_{[] {
+    std::array<std::size_t, neurons> offsets{};
+    std::size_t offset{0};
+    for (std::size_t i{0}; i != neurons; ++i) {
+      offsets[i] = offset;
+      offset += neurons - i - 1;
+    }
+    return offsets;
+  }()};
+
+  const double* weights_;
+  Fields local_fields_;
+  // Local fields of energy(), kept so that it allocates nothing
+  mutable Fields scratch_fields_;
+  std::array<std::size_t, neurons> flipped_;
+
+  // Kernels of the public functions on N values at state and fields, so that
+  // the arrays and the vectors share them without copies
+
+  // Adds factor * w_ki to fields[i] for every i != k (0-based)
+  void accumulate_row_(std::size_t k, double factor, double* fields) const;
+
+  void compute_local_fields_(const int* state, double* fields) const;
+
+  double energy_(const int* state) const;
+
+  std::size_t update_dynamics_(int* state, std::size_t max_iterations);
+
+ public:
+  explicit Network(Weight_Matrix const& weight_matrix);
+
+  Dimensions dimensions() const override;
+
+  // Same additions as Weight_Matrix::multiply()
+  void local_fields(State const& state, Fields& fields) const;
+
+  double energy(State const& state) const;
+
+  std::size_t update_dynamics(State& state, std::size_t max_iterations);
+
+  std::vector<double>
+  local_fields(std::vector<int> const& state) const override;
+
+  double energy(std::vector<int> const& state) const override;
+
+  void local_fields(std::vector<int> const& state,
+                    std::span<double> fields) const override;
+
+  void update_local_fields(std::span<double> fields,
+                           std::vector<std::size_t> const& flipped,
+                           std::vector<int> const& state) const override;
+
+  std::size_t update_dynamics(std::vector<int>& state,
+                              std::size_t max_iterations) override;
+};
+
+// Network<64, 64> when dimensions is 64x64 and the weights are real and
+// packed, Generic_Network otherwise
+std::unique_ptr<Network_Base> make_network(Weight_Matrix const& weight_matrix,
+                                           Dimensions dimensions);
+
+template<unsigned int Width, unsigned int Height>
+Network<Width, Height>::Network(Weight_Matrix const& weight_matrix)
+    : weights_{nullptr}
+    , local_fields_{}
+    , scratch_fields_{}
+    , flipped_{}
+{
+  if (weight_matrix.neurons() != neurons
+      || weight_matrix.size() != neurons * (neurons - 1) / 2
+      || weight_matrix.storage() != Weight_Storage::real
+      || weight_matrix.layout() != Weight_Layout::packed) {
+    throw std::runtime_error(
+        "The weight matrix must be filled, with " + std::to_string(neurons)
+        + " neurons, the real storage and the packed layout.");
+  }
+  weights_ = weight_matrix.weights().data();
+
+  static_assert(row_offsets_[neurons - 1] == neurons * (neurons - 1) / 2);
+}
+
+template<unsigned int Width, unsigned int Height>
+Dimensions Network<Width, Height>::dimensions() const
+{
+  return {Width, Height};
+}
+
+template<unsigned int Width, unsigned int Height>
+void Network<Width, Height>::accumulate_row_(std::size_t k, double factor,
+                                             double* fields) const
+{
+  // w_ik with i < k lies in the i-th row, w_ki with i > k in the k-th one
+  for (std::size_t i{0}; i < k; ++i) {
+    fields[i] += factor * weights_[row_offsets_[i] + k - i - 1];
+  }
+  auto row = weights_ + row_offsets_[k];
+  for (auto i{k + 1}; i < neurons; ++i) {
+    fields[i] += factor * row[i - k - 1];
+  }
+}
+
+template<unsigned int Width, unsigned int Height>
+void Network<Width, Height>::compute_local_fields_(const int* state,
+                                                   double* fields) const
+{
+  std::fill_n(fields, neurons, 0.);
+  for (std::size_t i{0}; i != neurons; ++i) {
+    auto row = weights_ + row_offsets_[i];
+    auto s_i = state[i];
+    auto h_i = fields[i];
+    for (auto j{i + 1}; j < neurons; ++j) {
+      auto w_ij = row[j - i - 1];
+      h_i += w_ij * state[j];
+      fields[j] += w_ij * s_i;
+    }
+    fields[i] = h_i;
+  }
+}
+
+template<unsigned int Width, unsigned int Height>
+double Network<Width, Height>::energy_(const int* state) const
+{
+  compute_local_fields_(state, scratch_fields_.data());
+
+  double energy{0.};
+  for (std::size_t i{0}; i != neurons; ++i) {
+    energy += state[i] * scratch_fields_[i];
+  }
+
+  return -energy / 2;
+}
+
+template<unsigned int Width, unsigned int Height>
+std::size_t Network<Width, Height>::update_dynamics_(int* state,
+                                                     std::size_t max_iterations)
+{
+  compute_local_fields_(state, local_fields_.data());
+
+  std::size_t iteration{0};
+  while (iteration != max_iterations) {
+    ++iteration;
+
+    std::size_t flips{0};
+    for (std::size_t i{0}; i != neurons; ++i) {
+      auto new_value = sign(local_fields_[i]);
+      if (new_value != state[i]) {
+        state[i]          = new_value;
+        flipped_[flips++] = i;
+      }
+    }
+    if (flips == 0) {
+      break;
+    }
+
+    for (std::size_t f{0}; f != flips; ++f) {
+      auto k = flipped_[f];
+      accumulate_row_(k, 2. * state[k], local_fields_.data());
+    }
+  }
+
+  return iteration;
+}
+
+template<unsigned int Width, unsigned int Height>
+void Network<Width, Height>::local_fields(State const& state,
+                                          Fields& fields) const
+{
+  compute_local_fields_(state.data(), fields.data());
+}
+
+template<unsigned int Width, unsigned int Height>
+double Network<Width, Height>::energy(State const& state) const
+{
+  return energy_(state.data());
+}
+
+template<unsigned int Width, unsigned int Height>
+std::size_t Network<Width, Height>::update_dynamics(State& state,
+                                                    std::size_t max_iterations)
+{
+  return update_dynamics_(state.data(), max_iterations);
+}
+
+template<unsigned int Width, unsigned int Height>
+std::vector<double>
+Network<Width, Height>::local_fields(std::vector<int> const& state) const
+{
+  std::vector<double> fields(neurons);
+  local_fields(state, fields);
+
+  return fields;
+}
+
+template<unsigned int Width, unsigned int Height>
+double Network<Width, Height>::energy(std::vector<int> const& state) const
+{
+  assert(state.size() == neurons);
+
+  return energy_(state.data());
+}
+
+template<unsigned int Width, unsigned int Height>
+void Network<Width, Height>::local_fields(std::vector<int> const& state,
+                                          std::span<double> fields) const
+{
+  assert(state.size() == neurons);
+  assert(fields.size() == neurons);
+
+  compute_local_fields_(state.data(), fields.data());
+}
+
+template<unsigned int Width, unsigned int Height>
+void Network<Width, Height>::update_local_fields(
+    std::span<double> fields, std::vector<std::size_t> const& flipped,
+    std::vector<int> const& state) const
+{
+  assert(state.size() == neurons);
+  assert(fields.size() == neurons);
+
+  for (auto j : flipped) {
+    assert(j >= 1 && j <= neurons);
+    accumulate_row_(j - 1, 2. * state[j - 1], fields.data());
+  }
+}
+
+template<unsigned int Width, unsigned int Height>
+std::size_t
+Network<Width, Height>::update_dynamics(std::vector<int>& state,
+                                        std::size_t max_iterations)
+{
+  assert(state.size() == neurons);
+
+  return update_dynamics_(state.data(), max_iterations);
+}
+
+} // namespace nn
+
+#endif
\ No newline at end of file
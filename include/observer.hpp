@@ -0,0 +1,176 @@
+// All relative paths are relative to the build/ directory
+
+#ifndef NN_OBSERVER_HPP
+#define NN_OBSERVER_HPP
+
+// This path is the only one relative to "observer.hpp"
+#include "dimensions.hpp"
+
+#include <SFML/Graphics.hpp>
+#include <filesystem>
+#include <fstream>
+#include <iosfwd>
+#include <vector>
+
+namespace nn {
+
+// Receives the states visited by Recall::network_update_dynamics(), which
+// calls on_start() with the starting state, on_iteration() after every update
+// that changed the state and on_finish() whenever the dynamics ends, passing
+// the overlap of the last state with the original pattern (+1 if it has been
+// restored); nn::Termination tells why it ended
+class Observer
+{
+ public:
+  virtual ~Observer() = default;
+
+  virtual void on_start(std::vector<int> const& state, double energy,
+                        double original_energy) = 0;
+
+  virtual void on_iteration(std::size_t iteration,
+                            std::vector<int> const& state, double energy) = 0;
+
+  virtual void on_finish(std::size_t iteration, std::vector<int> const& state,
+                         double energy, double overlap) = 0;
+};
+
+// Headless default: does nothing
+class Null_Observer : public Observer
+{
+ public:
+  void on_start(std::vector<int> const& state, double energy,
+                double original_energy) override;
+
+  void on_iteration(std::size_t iteration, std::vector<int> const& state,
+                    double energy) override;
+
+  void on_finish(std::size_t iteration, std::vector<int> const& state,
+                 double energy, double overlap) override;
+};
+
+// Prints the energies and the outcome of the dynamics
+class Console_Observer : public Observer
+{
+ private:
+  std::ostream& os_;
+
+ public:
+  Console_Observer(std::ostream& os);
+
+  Console_Observer();
+
+  void on_start(std::vector<int> const& state, double energy,
+                double original_energy) override;
+
+  void on_iteration(std::size_t iteration, std::vector<int> const& state,
+                    double energy) override;
+
+  void on_finish(std::size_t iteration, std::vector<int> const& state,
+                 double energy, double overlap) override;
+};
+
+// Shows the starting state and the current state side by side; the window is
+// opened by on_start()
+class Window_Observer : public Observer
+{
+ private:
+  const unsigned int width_;
+  const unsigned int height_;
+  const float scale_;
+
+  sf::RenderWindow window_;
+  sf::Image starting_image_;
+  sf::Image current_image_;
+  sf::Texture starting_texture_;
+  sf::Texture current_texture_;
+
+  void draw_();
+
+ public:
+  Window_Observer(unsigned int width, unsigned int height, float scale);
+
+  void on_start(std::vector<int> const& state, double energy,
+                double original_energy) override;
+
+  void on_iteration(std::size_t iteration, std::vector<int> const& state,
+                    double energy) override;
+
+  void on_finish(std::size_t iteration, std::vector<int> const& state,
+                 double energy, double overlap) override;
+};
+
+// Records every visited state in a text file, one line per state:
+// "<iteration> <energy> <values...>"
+class File_Observer : public Observer
+{
+ private:
+  const std::filesystem::path path_;
+  std::ofstream outfile_;
+
+  void record_(std::size_t iteration, std::vector<int> const& state,
+               double energy);
+
+ public:
+  File_Observer(std::filesystem::path const& path);
+
+  void on_start(std::vector<int> const& state, double energy,
+                double original_energy) override;
+
+  void on_iteration(std::size_t iteration, std::vector<int> const& state,
+                    double energy) override;
+
+  void on_finish(std::size_t iteration, std::vector<int> const& state,
+                 double energy, double overlap) override;
+};
+
+// Saves the starting state as "<name>.corrupted.txt" and the final state as
+// "<name>.restored.txt" in directory, each one with its image, as
+// Recall::corrupt_pattern() and Recall::save_current_state() do; name is the
+// one of the original pattern, e.g. "ae.txt"
+class Pattern_File_Observer : public Observer
+{
+ private:
+  const std::filesystem::path directory_;
+  const std::filesystem::path name_;
+  const Dimensions dimensions_;
+
+  void save_(std::vector<int> const& state,
+             std::filesystem::path const& extension) const;
+
+ public:
+  Pattern_File_Observer(std::filesystem::path const& directory,
+                        std::filesystem::path const& name,
+                        Dimensions dimensions);
+
+  void on_start(std::vector<int> const& state, double energy,
+                double original_energy) override;
+
+  void on_iteration(std::size_t iteration, std::vector<int> const& state,
+                    double energy) override;
+
+  void on_finish(std::size_t iteration, std::vector<int> const& state,
+                 double energy, double overlap) override;
+};
+
+// Forwards every call to each of the given observers, in order
+class Observer_List : public Observer
+{
+ private:
+  const std::vector<Observer*> observers_;
+
+ public:
+  Observer_List(std::vector<Observer*> const& observers);
+
+  void on_start(std::vector<int> const& state, double energy,
+                double original_energy) override;
+
+  void on_iteration(std::size_t iteration, std::vector<int> const& state,
+                    double energy) override;
+
+  void on_finish(std::size_t iteration, std::vector<int> const& state,
+                 double energy, double overlap) override;
+};
+
+} // namespace nn
+
+#endif
@@ -3,7 +3,11 @@
 #ifndef NN_PATTERN_HPP
 #define NN_PATTERN_HPP
 
+// This path is the only one relative to "pattern.hpp"
+#include "dimensions.hpp"
+
 #include <SFML/Graphics.hpp>
+#include <cstdint>
 #include <filesystem>
 #include <vector>
 
@@ -14,25 +18,61 @@ sf::Color compute_color(int value);
 sf::Image create_image(unsigned int width, unsigned int height,
                        std::vector<int> const& pattern);
 
+// Number of positions at which two bit-packed patterns of the same size
+// differ, i.e. the number of neurons flipped going from one to the other
+std::size_t flip_count(std::vector<std::uint64_t> const& first,
+                       std::vector<std::uint64_t> const& second);
+
+// Dimensions of the pattern text file at path: the ones of its header, or
+// square_dimensions() of its number of entries if it has none
+Dimensions read_pattern_dimensions(std::filesystem::path const& path);
+
 class Pattern
 {
  private:
-  std::vector<int> pattern_;
+  // Bit-packed values: bit k % 64 of words_[k / 64] is set if the k-th value
+  // is +1 and cleared if it is -1; unused bits of the last word are cleared
+  std::vector<std::uint64_t> words_;
+  std::size_t size_;
 
  public:
-  Pattern(std::vector<int> pattern);
+  // Every value of pattern must be +1 or -1
+  Pattern(std::vector<int> const& pattern);
 
   Pattern();
 
-  const std::vector<int>& pattern() const;
+  // Unpacked copy of the values
+  std::vector<int> pattern() const;
+
+  const std::vector<std::uint64_t>& words() const;
 
   std::size_t size() const;
 
+  // index is 0-based
+  int at(std::size_t index) const;
+
+  void set(std::size_t index, int value);
+
   void add(int value);
 
+  // Normalized overlap (1 / N) * sum_i p_i * q_i, in [-1, +1]
+  double overlap(Pattern const& other) const;
+
+  std::size_t hamming_distance(Pattern const& other) const;
+
+  bool operator==(Pattern const& other) const = default;
+
   void save_to_file(std::filesystem::path const& patterns_directory,
                     std::filesystem::path const& name, std::size_t size) const;
 
+  // As above, the values being preceded by the header line
+  // "# <width> <height>"
+  void save_to_file(std::filesystem::path const& patterns_directory,
+                    std::filesystem::path const& name,
+                    Dimensions dimensions) const;
+
+  // Files with and without header are read; the header, if any, must match
+  // size
   void load_from_file(std::filesystem::path const& patterns_directory,
                       std::filesystem::path const& name, std::size_t size);
 
@@ -42,6 +82,10 @@ class Pattern
 
   void add_noise(double probability, std::size_t size);
 
+  // As above, the flips being drawn from an engine seeded with seed, so that
+  // the same seed gives the same noise
+  void add_noise(double probability, std::size_t size, unsigned int seed);
+
   // new_value must be +1 (white fill) or -1 (black fill)
   void cut(int new_value, unsigned int from_row, unsigned int to_row,
            unsigned int from_column, unsigned int to_column, unsigned int width,
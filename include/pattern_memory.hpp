@@ -0,0 +1,107 @@
+// All relative paths are relative to the build/ directory
+
+#ifndef NN_PATTERN_MEMORY_HPP
+#define NN_PATTERN_MEMORY_HPP
+
+// This path is the only one relative to "pattern_memory.hpp"
+#include "pattern.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+namespace nn {
+
+// Header of the binary pattern memory format; it is followed by the words of
+// the bit-packed patterns, one pattern after the other
+struct Pattern_Memory_Header
+{
+  char magic[8];         // "HNN-PM" padded with '\0'
+  std::uint32_t version; // Currently 1
+  std::uint32_t reserved;
+  std::uint64_t neurons;
+  std::uint64_t patterns;
+  std::uint64_t words; // Words per pattern: (neurons + 63) / 64
+  std::uint64_t checksum;
+  std::uint32_t width;  // 0 if unknown, as in Weight_Matrix_Header
+  std::uint32_t height;
+  std::uint64_t padding;
+};
+
+static_assert(sizeof(Pattern_Memory_Header) == 64);
+
+// Dimensions stored in the header of the pattern memory file at path, or
+// square_dimensions() of its number of neurons if they are unknown
+Dimensions read_pattern_memory_dimensions(std::filesystem::path const& path);
+
+/*
+ * Network memory stored as the training patterns themselves instead of the
+ * Hebbian weight matrix w_ij = (1 / N) * sum_mu p_i^mu * p_j^mu (i != j).
+ * With P patterns a product W * s costs O(P * N) instead of O(N^2): the
+ * overlaps m_mu = sum_j p_j^mu * s_j are computed by XOR-popcount on the
+ * bit-packed values and h_i = (sum_mu p_i^mu * m_mu - P * s_i) / N.
+ * Every intermediate result is an integer divided by N, so for N a power of
+ * two the local fields are exactly equal to the ones of the weight matrix.
+ */
+class Pattern_Memory
+{
+ private:
+  const std::size_t neurons_;
+  std::size_t words_per_pattern_;
+
+  // Bit-packed patterns as in Pattern, stored one after the other
+  std::vector<std::uint64_t> words_;
+
+  // dimensions is {0, 0} if unknown
+  void save_(std::filesystem::path const& path, Dimensions dimensions) const;
+
+ public:
+  Pattern_Memory(std::size_t neurons);
+
+  // default_dimensions.neurons() neurons
+  Pattern_Memory();
+
+  std::size_t neurons() const;
+
+  // Number of stored patterns
+  std::size_t size() const;
+
+  // Words of the pattern mu (0-based)
+  std::span<const std::uint64_t> words(std::size_t mu) const;
+
+  // Equal to Weight_Matrix::at() of the weight matrix filled with the same
+  // patterns; i and j are 1-based
+  double at(std::size_t i, std::size_t j) const;
+
+  // sum_j p_j^mu * state_j for every pattern, state being bit-packed
+  std::vector<std::int64_t> overlaps(Pattern const& state) const;
+
+  // Adds factor * p_j^mu to target[j - 1] for every j
+  void accumulate_pattern(std::size_t mu, double factor,
+                          std::span<double> target) const;
+
+  // Adds factor * w_ij to target[j - 1] for every j, as
+  // Weight_Matrix::accumulate_row(); i is 1-based
+  void accumulate_row(std::size_t i, double factor,
+                      std::span<double> target) const;
+
+  void fill(std::vector<std::vector<int>> const& patterns, std::size_t neurons);
+
+  // Binary format only (".bin")
+  void save_to_file(std::filesystem::path const& memory_directory,
+                    std::filesystem::path const& name,
+                    std::size_t neurons) const;
+
+  // As above, the header also storing the dimensions of the network
+  void save_to_file(std::filesystem::path const& memory_directory,
+                    std::filesystem::path const& name,
+                    Dimensions dimensions) const;
+
+  void load_from_file(std::filesystem::path const& memory_directory,
+                      std::filesystem::path const& name, std::size_t neurons);
+};
+
+} // namespace nn
+
+#endif
@@ -3,11 +3,21 @@
 #ifndef NN_RECALL_HPP
 #define NN_RECALL_HPP
 
-// These two paths are the only ones relative to "recall.hpp"
+// These six paths are the only ones relative to "recall.hpp"
+#include "observer.hpp"
 #include "pattern.hpp"
+#include "pattern_memory.hpp"
+#include "thread_pool.hpp"
+#include "tiled_weight_matrix.hpp"
 #include "weight_matrix.hpp"
 
+#include <array>
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
+#include <memory>
+#include <random>
+#include <span>
 #include <vector>
 
 namespace nn {
@@ -24,37 +34,315 @@ std::vector<double> hopfield_local_fields(std::vector<int> const& current_state,
 double hopfield_energy(std::vector<int> const& current_state,
                        Weight_Matrix const& weight_matrix);
 
+// Versions of the two functions above writing the local fields into a buffer
+// of N elements owned by the caller; nothing is allocated with
+// Weight_Storage::real
+void hopfield_local_fields(std::vector<int> const& current_state,
+                           Weight_Matrix const& weight_matrix,
+                           std::span<double> local_fields);
+
+double hopfield_energy(std::vector<int> const& current_state,
+                       Weight_Matrix const& weight_matrix,
+                       std::span<double> local_fields);
+
+// Updates the local fields of a state after the neurons in flipped (1-based
+// indices) changed sign, reaching new_state: h_i += 2 * w_ij * new_state_j.
+// The cost is O(N * flipped.size()) instead of the O(N^2) of a recomputation;
+// with N a power of two Hebbian weights are dyadic rationals and the updated
+// fields are exactly equal to the recomputed ones.
+void update_local_fields(std::vector<double>& local_fields,
+                         std::vector<std::size_t> const& flipped,
+                         std::vector<int> const& new_state,
+                         Weight_Matrix const& weight_matrix);
+
+// Parallel versions of the three functions above: the neurons are distributed
+// over the threads of pool and every local field is computed as in the serial
+// version, so the results do not depend on the number of threads
+std::vector<double> hopfield_local_fields(std::vector<int> const& current_state,
+                                          Weight_Matrix const& weight_matrix,
+                                          Thread_Pool& pool,
+                                          Partitioning partitioning);
+
+double hopfield_energy(std::vector<int> const& current_state,
+                       Weight_Matrix const& weight_matrix, Thread_Pool& pool,
+                       Partitioning partitioning);
+
+void update_local_fields(std::vector<double>& local_fields,
+                         std::vector<std::size_t> const& flipped,
+                         std::vector<int> const& new_state,
+                         Weight_Matrix const& weight_matrix, Thread_Pool& pool,
+                         Partitioning partitioning);
+
+void hopfield_local_fields(std::vector<int> const& current_state,
+                           Weight_Matrix const& weight_matrix,
+                           Thread_Pool& pool, Partitioning partitioning,
+                           std::span<double> local_fields);
+
+// Versions of the three functions above for a network stored as its patterns:
+// the cost is O(P * N) instead of O(N^2), O(P * (N + flipped.size())) for the
+// update, and the results are equal to the ones of the corresponding weight
+// matrix when N is a power of two
+std::vector<double> hopfield_local_fields(std::vector<int> const& current_state,
+                                          Pattern_Memory const& pattern_memory);
+
+double hopfield_energy(std::vector<int> const& current_state,
+                       Pattern_Memory const& pattern_memory);
+
+void update_local_fields(std::vector<double>& local_fields,
+                         std::vector<std::size_t> const& flipped,
+                         std::vector<int> const& new_state,
+                         Pattern_Memory const& pattern_memory);
+
+// Local fields of a batch of states at once. states stores the states
+// interleaved: states[(i - 1) * batch + b] is the value of the i-th neuron in
+// the b-th state, and local_fields is resized and filled in the same layout.
+// The packed triangle is streamed once and every weight w_ij is used for the
+// fields h_i and h_j of all the states in the batch.
+void hopfield_local_fields(std::vector<int> const& states, std::size_t batch,
+                           Weight_Matrix const& weight_matrix,
+                           std::vector<double>& local_fields);
+
+// Synchronous dynamics of many states against the same weight matrix. The
+// states still evolving advance together, one pass over the weights per
+// iteration, and a state leaves the batch as soon as an update leaves it
+// unchanged. Returns the number of updates performed on each state (counted
+// as Recall::current_iteration()), at most max_iterations.
+std::vector<std::size_t>
+batch_network_update_dynamics(std::vector<std::vector<int>>& states,
+                              Weight_Matrix const& weight_matrix,
+                              std::size_t max_iterations);
+
+// Synchronous: every neuron is updated from the local fields of the previous
+// state. Asynchronous: neurons are updated one at a time, each from the local
+// fields of the current state, in sweeps over all the neurons.
+enum class Update_Mode
+{
+  synchronous,
+  asynchronous
+};
+
+// Order of the neurons in an asynchronous sweep. Fixed: increasing indices.
+// Random: a new random permutation at every sweep.
+enum class Neuron_Order
+{
+  fixed,
+  random
+};
+
+// Storage of the network memory used by Recall. Weight matrix: the Hebbian
+// weights, N * (N - 1) / 2 doubles or integer counts (see Weight_Storage).
+// Pattern memory: the P training patterns bit-packed, N * P bits, preferable
+// when P is much smaller than N. Tiled weight matrix: the Hebbian weights as
+// doubles in the tiles of a file (see Tiled_Weight_Matrix), read through a
+// cache of default_tile_cache_bytes, for networks whose weights do not fit in
+// memory.
+enum class Recall_Backend
+{
+  weight_matrix,
+  pattern_memory,
+  tiled_weight_matrix
+};
+
+// Outcome of Recall::network_update_dynamics(). Fixed point: an update left
+// the state unchanged. Cycle: the state came back to one visited a few updates
+// before, so that the dynamics would repeat forever; with symmetric weights
+// the synchronous dynamics can only oscillate between two states. Iteration
+// and time budget: the limits given to Recall::set_budget() were reached
+// first.
+enum class Termination
+{
+  fixed_point,
+  cycle,
+  iteration_budget,
+  time_budget
+};
+
+// Corruption applied to the probe by Recall::recall() before the dynamics.
+// Noise: every neuron is flipped with probability noise, drawn from seed.
+// Cut: the rectangle of rows from_row to to_row and columns from_column to
+// to_column (1-based, inclusive) is set to -1, as by Recall::corrupt_pattern().
+enum class Corruption
+{
+  none,
+  noise,
+  cut
+};
+
+struct Recall_Options
+{
+  Corruption corruption{Corruption::none};
+  double noise{0.};
+  unsigned int seed{0};
+  unsigned int from_row{0};
+  unsigned int to_row{0};
+  unsigned int from_column{0};
+  unsigned int to_column{0};
+  // Receives the visited states, e.g. a Pattern_File_Observer to save the
+  // probe and the recalled pattern; nothing is written without one
+  Observer* observer{nullptr};
+};
+
+// corrupted is the starting state, state the recalled one, energy its energy
+// and overlap its overlap with the probe before the corruption
+struct Recall_Result
+{
+  Pattern corrupted;
+  Pattern state;
+  Termination termination;
+  std::size_t iterations;
+  double energy;
+  double overlap;
+};
+
+// Defined in "network.hpp", which includes this header
+class Network_Base;
+
 class Recall
 {
  private:
-  Weight_Matrix weight_matrix_;
+  const Recall_Backend backend_;
+  const std::filesystem::path weight_matrix_directory_;
+  const std::filesystem::path patterns_directory_;
+  const std::filesystem::path corrupted_directory_;
+  const Dimensions dimensions_;
+  // Shared with the other Recall objects using the same file, empty with
+  // Recall_Backend::pattern_memory; set_weight_layout() makes a private copy
+  Shared_Weight_Matrix weight_matrix_;
+  Pattern_Memory pattern_memory_; // Empty with Recall_Backend::weight_matrix
+  // Only with Recall_Backend::tiled_weight_matrix
+  std::unique_ptr<Tiled_Weight_Matrix> tiled_weight_matrix_;
   Pattern original_pattern_;
   Pattern noisy_pattern_;
   Pattern cut_pattern_;
   std::vector<int> current_state_;
   std::size_t current_iteration_;
 
-  const std::filesystem::path weight_matrix_directory_;
-  const std::filesystem::path patterns_directory_;
-  const std::filesystem::path corrupted_directory_;
+  // Local fields of current_state_, kept between iterations and updated only
+  // for the neurons flipped by the last update; valid if local_fields_ready_
+  std::vector<double> local_fields_;
+  bool local_fields_ready_;
+  std::vector<std::size_t> flipped_;
+
+  // Energy of current_state_, valid with the local fields. An update flipping
+  // the neurons k changes it by -sum_k s'_k * (h_k + h'_k), s' and h' being
+  // the new state and fields, so it is kept in O(flips) from the fields
+  // flipped_fields_[f] = h_k of the flipped_[f] = k before the update. The
+  // sums are exact for N a power of two; otherwise the rounding errors of
+  // the updates accumulate, and the energy is only close to the recomputed
+  // one.
+  double energy_;
+  std::vector<double> flipped_fields_;
+
+  // Second buffer of local fields, for the energies of other states. Both
+  // buffers, flipped_, flipped_fields_ and current_state_ are sized once by
+  // the constructor, so that no iteration of the dynamics allocates memory.
+  std::vector<double> scratch_fields_;
+
+  // Kernels of the serial synchronous updates of weight_matrix_, given by
+  // make_network(): Network<64, 64> for 64x64 real packed weights
+  std::unique_ptr<Network_Base> network_;
+
+  // Synchronous updates are parallelized when thread_pool_ is set
+  Thread_Pool* thread_pool_;
+  Partitioning partitioning_;
+
+  Update_Mode update_mode_;
+  Neuron_Order neuron_order_;
+  std::default_random_engine engine_;
+  std::vector<std::size_t> order_;
+
+  // Limits of network_update_dynamics(), none by default
+  std::size_t max_iterations_;
+  std::chrono::steady_clock::duration max_duration_;
+
+  // Zobrist hash of current_state_, the xor of a random 64-bit key per neuron
+  // at +1, kept by the updates from the flipped neurons. recent_hashes_[t % 8]
+  // is the hash of the state after the t-th update of the dynamics: a state
+  // already visited is found in O(1) without storing the states.
+  std::uint64_t state_hash_;
+  std::array<std::uint64_t, 8> recent_hashes_;
+
+  // weight_matrix is nullptr to load the one of the weight_matrix_directory_
+  Recall(std::filesystem::path const& base_directory, Recall_Backend backend,
+         Shared_Weight_Matrix weight_matrix);
 
   void validate_weight_matrix_directory_() const;
   void validate_patterns_directory_() const;
   void configure_corrupted_directory_() const;
 
+  // Validates the directories read and returns the dimensions of the network,
+  // read from the header of the file of the backend, or from the patterns
+  // when the weight matrix is imported from the text format
+  Dimensions acquire_dimensions_() const;
+
+  // Dispatch to the free functions of the backend in use
+  void compute_local_fields_(std::vector<int> const& state,
+                             std::span<double> local_fields) const;
+  double compute_energy_(std::vector<int> const& state);
+  void apply_flips_();
+
+  // Computes local_fields_, energy_ and state_hash_ of current_state_ unless
+  // they are ready
+  void prepare_local_fields_();
+
+  // Recomputes local_fields_ if N is not a power of two and one of them is
+  // within 1 / (2 * N) of 0, where the rounding of the updates could give it
+  // another sign than a full recompute
+  void refresh_borderline_fields_();
+
+  // Sizes the buffers of the dynamics once, for every constructor
+  void reserve_buffers_();
+
+  // Runs the dynamics from current_state_; the energy and the overlap of the
+  // original pattern are passed to observer
+  Termination run_dynamics_(Observer& observer, Pattern const& original,
+                            double original_energy);
+
+  // Records the hash of the state after the current_iteration_-th update;
+  // true if it is the one of a state visited at most 8 updates before
+  bool revisits_state_();
+
+  bool synchronous_update_();
+  bool asynchronous_sweep_();
+
  public:
   /*
    * Given the current structure of the project root, base_directory can only be
    * "" or "tests/" to differentiate ordinary code execution from test
    * execution. Alternatively the program throws an error since the
    * patterns_directory_ and the weight_matrix_directory_ do not exist.
+   * The backend reads "weight_matrix.bin" (or "weight_matrix.txt"),
+   * "pattern_memory.bin" or "weight_matrix.tiles" from the
+   * weight_matrix_directory_.
    */
-  Recall(std::filesystem::path const& base_directory);
+  Recall(std::filesystem::path const& base_directory,
+         Recall_Backend backend = Recall_Backend::weight_matrix);
+
+  // Recall_Backend::weight_matrix on weight_matrix, e.g. the
+  // shared_weight_matrix() of another Recall object, instead of the one of
+  // the weight_matrix_directory_; the numbers of neurons must match
+  Recall(std::filesystem::path const& base_directory,
+         Shared_Weight_Matrix weight_matrix);
 
   Recall();
 
+  // In-memory recall on weight_matrix, of a network of the given dimensions,
+  // without any directory: the probes are given to recall(), and
+  // corrupt_pattern() and save_current_state() cannot be used
+  Recall(Shared_Weight_Matrix weight_matrix, Dimensions dimensions);
+
+  ~Recall();
+
+  Recall_Backend backend() const;
+
+  Dimensions dimensions() const;
+
   const Weight_Matrix& weight_matrix() const;
 
+  Shared_Weight_Matrix shared_weight_matrix() const;
+
+  const Pattern_Memory& pattern_memory() const;
+
   const Pattern& original_pattern() const;
 
   const Pattern& noisy_pattern() const;
@@ -63,8 +351,35 @@ class Recall
 
   const std::vector<int>& current_state() const;
 
+  // Number of synchronous updates or asynchronous sweeps performed
   std::size_t current_iteration() const;
 
+  // Energy of current_state(), kept by every update at the cost of O(flips)
+  // and read without any computation; only valid once the dynamics has
+  // started. It is exactly hopfield_energy() when N is a power of two, and
+  // may differ from it by the rounding of the updates otherwise
+  double current_energy() const;
+
+  Update_Mode update_mode() const;
+
+  // seed is used only by Neuron_Order::random
+  void set_update_mode(Update_Mode mode,
+                       Neuron_Order order = Neuron_Order::fixed,
+                       unsigned int seed  = 0);
+
+  // Runs the synchronous updates and the energy computations on pool; the
+  // dynamics does not depend on the number of threads. nullptr restores the
+  // serial path. pool must outlive its use by the Recall object. It has no
+  // effect with Recall_Backend::pattern_memory and
+  // Recall_Backend::tiled_weight_matrix.
+  void set_thread_pool(Thread_Pool* pool,
+                       Partitioning partitioning = Partitioning::blocked);
+
+  // Converts the weight matrix to layout (see Weight_Layout), on a private
+  // copy if it is shared; the dynamics does not depend on the layout. It has
+  // effect only with Recall_Backend::weight_matrix.
+  void set_weight_layout(Weight_Layout layout);
+
   void clear_state();
 
   // Acquires and corrupt a pattern from "../base_directory/patterns/" and saves
@@ -72,11 +387,44 @@ class Recall
   // sets the class state in order to call network_update_dynamics().
   void corrupt_pattern(std::filesystem::path const& name);
 
-  // Applies Hopefield rule to update the current state
+  /*
+   * Applies Hopefield rule to update the current state, performing a
+   * synchronous update or an asynchronous sweep according to update_mode();
+   * returns false if no neuron has changed its state. The local fields are
+   * kept from the flipped neurons; when N is not a power of two they carry
+   * the rounding of those updates, so a synchronous update recomputes them
+   * whenever one is within 1 / (2 * N) of 0 and follows the signs of a full
+   * recompute. An asynchronous sweep always uses the kept fields, so a null
+   * field may take either sign.
+   */
   bool single_network_update();
 
-  // Updates the current state until it converges to a stable state
-  void network_update_dynamics();
+  // Limits the updates performed by network_update_dynamics() to
+  // max_iterations and its duration to max_duration; the defaults remove
+  // either limit
+  void set_budget(std::size_t max_iterations,
+                  std::chrono::steady_clock::duration max_duration =
+                      std::chrono::steady_clock::duration::max());
+
+  // Updates the current state until it converges to a stable state, falls
+  // into a cycle or exhausts the budget, passing every visited state to
+  // observer. A cycle is detected from the hashes of the last 8 states, with a
+  // probability of a false detection of about 2^-61 per update.
+  Termination network_update_dynamics(Observer& observer);
+
+  // Headless version of network_update_dynamics(Observer&): no I/O is
+  // performed and no memory is allocated between two iterations
+  Termination network_update_dynamics();
+
+  /*
+   * Recalls probe, corrupted as given by options, without touching the
+   * filesystem: the dynamics runs as in network_update_dynamics(), with the
+   * update mode, the thread pool and the budget of the object, and the
+   * current state is left at the recalled one. A std::runtime_error is thrown
+   * if probe has not N values or the corruption does not fit the network.
+   */
+  Recall_Result recall(Pattern const& probe,
+                       Recall_Options const& options = {});
 
   // Saves the current state (pattern and image) in
   // "../base_directory/corrupted_files/"
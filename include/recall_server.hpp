@@ -0,0 +1,244 @@
+// All relative paths are relative to the build/ directory
+
+#ifndef NN_RECALL_SERVER_HPP
+#define NN_RECALL_SERVER_HPP
+
+// These three paths are the only ones relative to "recall_server.hpp"
+#include "pattern.hpp"
+#include "recall.hpp"
+#include "weight_matrix.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace nn {
+
+// The probe is pattern, N values +1 or -1, or, if pattern is empty, the
+// stored pattern name of the patterns directory of the server, e.g. "1.txt";
+// the corruption is the one of Recall_Options
+struct Recall_Request
+{
+  std::string name;
+  std::vector<int> pattern;
+  Corruption corruption{Corruption::none};
+  double noise{0.};
+  std::uint32_t seed{0};
+  std::uint32_t from_row{0};
+  std::uint32_t to_row{0};
+  std::uint32_t from_column{0};
+  std::uint32_t to_column{0};
+  Update_Mode mode{Update_Mode::synchronous};
+  // 0 selects the limit of the server, which also caps larger values
+  std::uint32_t max_iterations{0};
+};
+
+// Without error, state, termination, iterations, energy and overlap are the
+// ones of the Recall_Result, and microseconds is the time spent by the worker
+// on the request
+struct Recall_Response
+{
+  bool ok{false};
+  std::string error;
+  std::vector<int> state;
+  Termination termination{Termination::fixed_point};
+  std::uint32_t iterations{0};
+  double energy{0.};
+  double overlap{0.};
+  std::uint64_t microseconds{0};
+};
+
+/*
+ * Every message of the protocol is a frame: its size in bytes as a native
+ * 32-bit unsigned integer, followed by a header and a payload of
+ * payload_size bytes. The payload of a request is the probe, one signed byte
+ * +1 or -1 per neuron, or the characters of the name of the stored pattern;
+ * the one of a response is the recalled state in the same form, or the error
+ * message. A client may send any number of requests on a connection, each
+ * one being answered before the next is read.
+ */
+struct Recall_Request_Header
+{
+  char magic[4];              // "HNRQ"
+  std::uint32_t version;      // Currently 1
+  std::uint8_t source;        // 0: probe, 1: name of a stored pattern
+  std::uint8_t corruption;    // 0: none, 1: noise, 2: cut
+  std::uint8_t mode;          // 0: synchronous, 1: asynchronous
+  std::uint8_t reserved;
+  std::uint32_t seed;
+  double noise;
+  std::uint32_t from_row;
+  std::uint32_t to_row;
+  std::uint32_t from_column;
+  std::uint32_t to_column;
+  std::uint32_t max_iterations;
+  std::uint32_t payload_size;
+};
+
+static_assert(sizeof(Recall_Request_Header) == 48);
+
+struct Recall_Response_Header
+{
+  char magic[4];            // "HNRS"
+  std::uint32_t version;    // Currently 1
+  std::uint8_t status;      // 0: recalled, 1: error
+  std::uint8_t termination; // Order of Termination
+  std::uint16_t reserved;
+  std::uint32_t iterations;
+  double energy;
+  double overlap;
+  std::uint64_t microseconds;
+  std::uint32_t payload_size;
+  std::uint32_t padding;
+};
+
+static_assert(sizeof(Recall_Response_Header) == 48);
+
+// Default longest time a worker of Recall_Server waits for the rest of a
+// request or for the client to take its response
+constexpr std::chrono::seconds request_timeout{5};
+
+// Largest frame read by the server and the client: a request of a 4096x4096
+// network
+constexpr std::size_t max_recall_frame_size{
+    sizeof(Recall_Request_Header) + (std::size_t{1} << 24)};
+
+// Header and payload of a frame, without its size. The decoding functions
+// throw a std::runtime_error if the frame is malformed.
+std::vector<char> encode_request(Recall_Request const& request);
+
+Recall_Request decode_request(std::span<const char> frame);
+
+std::vector<char> encode_response(Recall_Response const& response);
+
+Recall_Response decode_response(std::span<const char> frame);
+
+/*
+ * Resident recall server: the weight matrix of "../base_directory/
+ * weight_matrix/weight_matrix.bin" is loaded once, and the stored patterns of
+ * "../base_directory/patterns/" are read at their first request and kept, so
+ * that a request costs only its dynamics. A dispatcher thread accepts the
+ * connections of the Unix domain socket socket_path and waits with poll() for
+ * a request on any of them; each request is served by one of workers threads
+ * by Recall::recall(), on in-memory Recall objects sharing the read-only
+ * weights, each one used by a single request at a time, and its connection
+ * then goes back to the dispatcher. An idle connection therefore holds no
+ * worker. A request must be received within request_timeout of its first
+ * byte, and its response sent within request_timeout of the end of its
+ * dynamics, however slowly the client sends or reads, so that a stalled
+ * client holds a worker at most that long for each of them; every dynamics
+ * is bounded by max_iterations updates and max_duration, and stops on
+ * cycles. Invalid requests are answered with an error and leave the
+ * connection open; malformed frames close it. When the process runs out of
+ * descriptors the dispatcher pauses before accepting again, rather than
+ * spinning on the failing accept().
+ */
+class Recall_Server
+{
+ private:
+  const std::filesystem::path patterns_directory_;
+  const std::filesystem::path socket_path_;
+  const Dimensions dimensions_;
+  const Shared_Weight_Matrix weight_matrix_;
+  const std::size_t max_iterations_;
+  const std::chrono::steady_clock::duration max_duration_;
+  const std::chrono::steady_clock::duration request_timeout_;
+
+  std::mutex patterns_mutex_;
+  std::map<std::string, Pattern> patterns_;
+
+  // Recall objects not in use, created when none is left; there are at most
+  // as many as concurrent requests
+  std::mutex recalls_mutex_;
+  std::vector<std::unique_ptr<Recall>> idle_recalls_;
+
+  // Connections with a pending request, waiting for a worker, and
+  // connections whose request was answered, to be watched again by the
+  // dispatcher; stopping_ is set under the same mutex
+  std::mutex queue_mutex_;
+  std::condition_variable request_ready_;
+  std::deque<int> pending_connections_;
+  std::vector<int> answered_connections_;
+
+  int descriptor_; // Listening socket, non-blocking
+  int wakeup_[2];  // Pipe waking the dispatcher from poll()
+  std::atomic<bool> stopping_;
+  std::thread dispatcher_;
+  std::vector<std::thread> workers_;
+
+  // The stored pattern name, loaded at its first use
+  Pattern stored_pattern_(std::string const& name);
+
+  void wake_dispatcher_();
+
+  // Serves one request of connection; false if the connection must be closed
+  bool serve_(int connection);
+
+  void dispatch_();
+  void work_();
+
+ public:
+  // Throws a std::runtime_error if workers is 0 or the socket cannot be
+  // created
+  Recall_Server(std::filesystem::path const& base_directory,
+                std::filesystem::path const& socket_path, std::size_t workers,
+                std::size_t max_iterations = 1000,
+                std::chrono::steady_clock::duration max_duration =
+                    std::chrono::seconds{10},
+                std::chrono::steady_clock::duration request_timeout =
+                    nn::request_timeout);
+
+  Recall_Server(Recall_Server const&)            = delete;
+  Recall_Server& operator=(Recall_Server const&) = delete;
+
+  // Stops the server and removes the socket
+  ~Recall_Server();
+
+  Dimensions dimensions() const;
+
+  std::size_t workers() const;
+
+  // Recalls request without any I/O but the first read of a stored pattern;
+  // the requests which cannot be served are answered with an error.
+  // Thread-safe.
+  Recall_Response recall(Recall_Request const& request);
+
+  // Stops accepting connections and requests, and closes every connection
+  // once the requests being served are answered; the threads are joined
+  void stop();
+};
+
+// Connection to a Recall_Server; it must not be used by two threads at once
+class Recall_Client
+{
+ private:
+  int descriptor_;
+  std::vector<char> frame_;
+
+ public:
+  // Throws a std::runtime_error if the server cannot be reached
+  explicit Recall_Client(std::filesystem::path const& socket_path);
+
+  Recall_Client(Recall_Client const&)            = delete;
+  Recall_Client& operator=(Recall_Client const&) = delete;
+
+  ~Recall_Client();
+
+  // Sends request and waits for its response; throws a std::runtime_error if
+  // the connection fails
+  Recall_Response recall(Recall_Request const& request);
+};
+
+} // namespace nn
+
+#endif
\ No newline at end of file
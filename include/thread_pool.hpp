@@ -0,0 +1,102 @@
+// All relative paths are relative to the build/ directory
+
+#ifndef NN_THREAD_POOL_HPP
+#define NN_THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace nn {
+
+// Blocked: the range is split into one contiguous block per thread.
+// Dynamic: threads repeatedly take the next chunk of the range, which balances
+// uneven work at the cost of some synchronization.
+enum class Partitioning
+{
+  blocked,
+  dynamic
+};
+
+template<class Signature>
+class Function_Ref;
+
+// Non-owning reference to a callable, which must outlive it. Unlike
+// std::function it never allocates, so passing a lambda capturing many
+// references to Thread_Pool::parallel_for() costs no heap allocation.
+template<class Result, class... Arguments>
+class Function_Ref<Result(Arguments...)>
+{
+ private:
+  const void* callable_;
+  Result (*call_)(const void*, Arguments...);
+
+ public:
+  template<class Callable>
+    requires(!std::is_same_v<std::remove_cvref_t<Callable>, Function_Ref>
+             && std::is_invocable_r_v<Result, Callable const&, Arguments...>)
+  Function_Ref(Callable const& callable)
+      : callable_{&callable}
+      , call_{[](const void* pointer, Arguments... arguments) -> Result {
+        return (*static_cast<Callable const*>(pointer))(
+            std::forward<Arguments>(arguments)...);
+      }}
+  {}
+
+  Result operator()(Arguments... arguments) const
+  {
+    return call_(callable_, std::forward<Arguments>(arguments)...);
+  }
+};
+
+class Thread_Pool
+{
+ private:
+  std::vector<std::thread> workers_;
+
+  std::mutex mutex_;
+  std::condition_variable task_ready_;
+  std::condition_variable task_done_;
+  Function_Ref<void(std::size_t)> const* task_;
+  std::size_t generation_;
+  std::size_t running_;
+  bool stopping_;
+  std::exception_ptr exception_;
+
+  void work_(std::size_t thread);
+
+  // Calls task(thread) once on every thread of the pool, the calling thread
+  // being thread 0, and waits for all of them
+  void run_(Function_Ref<void(std::size_t)> task);
+
+ public:
+  // threads is the total number of threads, including the calling one; 0
+  // selects std::thread::hardware_concurrency()
+  Thread_Pool(std::size_t threads);
+
+  Thread_Pool();
+
+  Thread_Pool(Thread_Pool const&)            = delete;
+  Thread_Pool& operator=(Thread_Pool const&) = delete;
+
+  ~Thread_Pool();
+
+  std::size_t threads() const;
+
+  // Calls body(begin, end) on disjoint subranges covering [first, last) and
+  // waits for all of them; the first exception thrown by body is rethrown.
+  // chunk is the size of the subranges with Partitioning::dynamic. No memory
+  // is allocated.
+  void parallel_for(std::size_t first, std::size_t last,
+                    Partitioning partitioning,
+                    Function_Ref<void(std::size_t, std::size_t)> body,
+                    std::size_t chunk = 64);
+};
+
+} // namespace nn
+
+#endif
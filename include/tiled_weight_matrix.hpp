@@ -0,0 +1,229 @@
+// All relative paths are relative to the build/ directory
+
+#ifndef NN_TILED_WEIGHT_MATRIX_HPP
+#define NN_TILED_WEIGHT_MATRIX_HPP
+
+// These two paths are the only ones relative to "tiled_weight_matrix.hpp"
+#include "dimensions.hpp"
+#include "thread_pool.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace nn {
+
+// Side of the square tiles of weights of Tiled_Weight_Matrix: a tile of
+// doubles takes 2 MiB
+constexpr std::size_t default_weight_tile_size{512};
+
+// Memory kept by the tile cache of Tiled_Weight_Matrix when none is given
+constexpr std::size_t default_tile_cache_bytes{256ull << 20};
+
+// Header of the tiled weight matrix format (".tiles" files); it is followed
+// by the tiles of the upper triangle, row of tiles by row of tiles, each one
+// tile_size * tile_size native doubles
+struct Tiled_Weight_Matrix_Header
+{
+  char magic[8];           // "HNN-WT" padded with '\0'
+  std::uint32_t version;   // Currently 1
+  std::uint32_t tile_size; // Side of the tiles, in neurons
+  std::uint64_t neurons;
+  std::uint64_t tiles;  // T * (T + 1) / 2 with T = ceil(neurons / tile_size)
+  std::uint32_t width;  // 0 if unknown
+  std::uint32_t height; // 0 if unknown
+  std::uint64_t padding[3];
+};
+
+static_assert(sizeof(Tiled_Weight_Matrix_Header) == 64);
+
+// Header of the ".tiles" file path; throws a std::runtime_error if it is not
+// a tiled weight matrix file
+Tiled_Weight_Matrix_Header
+read_tiled_weight_matrix_header(std::filesystem::path const& path);
+
+// Dimensions stored in the header of the ".tiles" file path, or
+// square_dimensions() of its number of neurons if they are unknown
+Dimensions
+read_tiled_weight_matrix_dimensions(std::filesystem::path const& path);
+
+/*
+ * Out-of-core weight matrix, for networks whose N * (N - 1) / 2 weights do not
+ * fit in memory: 65536 neurons take 17 GB as doubles. The upper triangle is
+ * split into square tiles of tile_size * tile_size weights, stored in a file;
+ * w_ij with i < j (1-based) is element (i - 1) % tile_size * tile_size +
+ * (j - 1) % tile_size of the tile of the ((i - 1) / tile_size)-th row and the
+ * ((j - 1) / tile_size)-th column of tiles. Tiles are read on demand into a
+ * cache of at most cache_bytes, so the memory used by the weights is bounded
+ * by max_resident_bytes() whatever N. A matrix keeps its file open and its
+ * cache, so it must not be used by two threads at once.
+ */
+class Tiled_Weight_Matrix
+{
+ private:
+  using Tile = std::vector<double>;
+
+  struct Cached_Tile
+  {
+    std::size_t index;
+    std::shared_ptr<const Tile> tile;
+    std::uint64_t last_use;
+  };
+
+  const std::size_t neurons_;
+  const std::size_t tile_size_;
+
+  // Number of tiles held by the cache
+  const std::size_t cache_tiles_;
+
+  // -1 until the matrix is filled or loaded
+  int descriptor_;
+
+  mutable std::vector<Cached_Tile> cache_;
+  mutable std::uint64_t clock_;
+
+  // Read-ahead of multiply(): a single persistent thread reads the tile
+  // requested_ into read_ (or its exception into read_error_) while the
+  // calling thread uses the previous one; none_requested when idle
+  static constexpr std::size_t none_requested{static_cast<std::size_t>(-1)};
+  mutable std::mutex reader_mutex_;
+  mutable std::condition_variable reader_wakeup_;
+  mutable std::size_t requested_;
+  mutable std::shared_ptr<const Tile> read_;
+  mutable std::exception_ptr read_error_;
+  bool reader_stopping_;
+  std::thread reader_;
+
+  // Tiles per row of tiles, ceil(N / tile_size)
+  std::size_t tile_rows_() const;
+
+  // Position in the file of the tile of the row_tile-th row and the
+  // column_tile-th column of tiles (row_tile <= column_tile)
+  std::size_t tile_index_(std::size_t row_tile, std::size_t column_tile) const;
+
+  std::size_t tile_bytes_() const;
+
+  void close_();
+
+  // Reads the index-th tile from the file, bypassing the cache; safe to call
+  // from another thread
+  std::shared_ptr<const Tile> read_tile_(std::size_t index) const;
+
+  // The cached tile, or nullptr
+  std::shared_ptr<const Tile> find_tile_(std::size_t index) const;
+
+  // The cached tile, or the tile read and cached, evicting the least
+  // recently used one
+  std::shared_ptr<const Tile> tile_(std::size_t index) const;
+
+  // Adds tile to the cache, evicting the least recently used tile if it is
+  // full and evict is true; without evict the tile is only kept if there is
+  // room
+  void cache_tile_(std::size_t index, std::shared_ptr<const Tile> tile,
+                   bool evict) const;
+
+  // Starts reading the index-th tile on the reader thread, unless it is
+  // cached; take_tile_() returns it. At most one tile is requested at a time.
+  void fetch_tile_(std::size_t index) const;
+
+  // Waits for the tile of the last fetch_tile_() and rethrows its exception
+  std::shared_ptr<const Tile> take_tile_() const;
+
+  void read_ahead_();
+
+  void open_(std::filesystem::path const& path);
+
+  // Writes the tiles on pool, or serially if pool is nullptr; on error the
+  // temporary file is removed and nothing is left open
+  void fill_(std::vector<std::vector<int>> const& patterns,
+             std::filesystem::path const& path, Dimensions dimensions,
+             Thread_Pool* pool);
+
+  // Writes header and the tiles to the open file descriptor
+  void fill_file_(std::vector<std::vector<int>> const& patterns,
+                  int descriptor, Tiled_Weight_Matrix_Header const& header,
+                  Thread_Pool* pool) const;
+
+ public:
+  // tile_size must not be null; the cache holds cache_bytes / (tile_size *
+  // tile_size * 8) tiles, possibly none
+  Tiled_Weight_Matrix(std::size_t neurons,
+                      std::size_t cache_bytes = default_tile_cache_bytes,
+                      std::size_t tile_size   = default_weight_tile_size);
+
+  Tiled_Weight_Matrix(Tiled_Weight_Matrix const&)            = delete;
+  Tiled_Weight_Matrix& operator=(Tiled_Weight_Matrix const&) = delete;
+
+  // Stops the reader thread and closes the file
+  ~Tiled_Weight_Matrix();
+
+  std::size_t neurons() const;
+
+  std::size_t tile_size() const;
+
+  // Number of tiles of the upper triangle, the diagonal ones included
+  std::size_t tiles() const;
+
+  std::size_t cached_tiles() const;
+
+  // Largest amount of memory taken by the tiles: the cache, the tile in use
+  // and the one being read ahead
+  std::size_t max_resident_bytes() const;
+
+  bool is_open() const;
+
+  /*
+   * Tiled Hebbian training into the file matrix_directory / name, which
+   * becomes the storage of the matrix: every tile is computed from the
+   * bitsets of transpose_patterns() by hebbian_sums(), written and dropped,
+   * so only one tile per thread is in memory. The weights are equal to the
+   * ones of Weight_Matrix::fill(). The file is written under a temporary name
+   * and renamed once complete.
+   */
+  void fill(std::vector<std::vector<int>> const& patterns, std::size_t neurons,
+            std::filesystem::path const& matrix_directory,
+            std::filesystem::path const& name,
+            Dimensions dimensions = {0, 0});
+
+  // As above, the tiles being distributed dynamically over the threads of pool
+  void fill(std::vector<std::vector<int>> const& patterns, std::size_t neurons,
+            Thread_Pool& pool, std::filesystem::path const& matrix_directory,
+            std::filesystem::path const& name,
+            Dimensions dimensions = {0, 0});
+
+  // Opens a file written by fill(); its tile size must be the one of the
+  // matrix
+  void load_from_file(std::filesystem::path const& matrix_directory,
+                      std::filesystem::path const& name, std::size_t neurons);
+
+  // Evicts the least recently used tile when the tile of w_ij is not cached
+  double at(std::size_t i, std::size_t j) const;
+
+  // Adds factor * w_ij to target[j - 1] for every j, as
+  // Weight_Matrix::accumulate_row(); i is 1-based. Row i spans one row and
+  // one column of tiles, which are used through the cache as by at().
+  void accumulate_row(std::size_t i, double factor,
+                      std::span<double> target) const;
+
+  /*
+   * Sets result[i - 1] = sum_j w_ij * state[j - 1] for every i, the local
+   * fields. The tiles are streamed once in file order, every w_ij being used
+   * for both result[i - 1] and result[j - 1], while the next tile is read by
+   * the reader thread of the matrix. A pass caches tiles only while the cache
+   * has room, so that repeated passes keep the first tiles in memory and read
+   * only the others. The additions are not made in the order of
+   * Weight_Matrix::multiply(): the results are the same when N is a power of
+   * two, and within rounding otherwise.
+   */
+  void multiply(std::vector<int> const& state, std::span<double> result) const;
+};
+
+} // namespace nn
+
+#endif
\ No newline at end of file
@@ -3,22 +3,47 @@
 #ifndef NN_TRAINING_HPP
 #define NN_TRAINING_HPP
 
-// This path is the only one relative to "training.hpp"
+// These three paths are the only ones relative to "training.hpp"
+#include "pattern_memory.hpp"
+#include "tiled_weight_matrix.hpp"
 #include "weight_matrix.hpp"
 
 #include <filesystem>
+#include <vector>
 
 namespace nn {
 
+// Full: the weight matrix directory is emptied on construction and the
+// matrices are computed from every pattern. Incremental: the directory must
+// contain "weight_matrix.bin", which is kept to be updated.
+enum class Training_Mode
+{
+  full,
+  incremental
+};
+
 class Training
 {
  private:
-  Weight_Matrix weight_matrix_; // Non necessary but useful in testing
   const std::filesystem::path patterns_directory_;
   const std::filesystem::path weight_matrix_directory_;
+  const Training_Mode mode_;
+  const Dimensions dimensions_;
+  Weight_Matrix weight_matrix_;   // Non necessary but useful in testing
+  Pattern_Memory pattern_memory_; // Non necessary but useful in testing
 
   void validate_patterns_directory_() const;
   void configure_weight_matrix_directory_() const;
+  void validate_weight_matrix_directory_() const;
+
+  // Validates the directories read and returns the dimensions of the network:
+  // the ones of the patterns, which must all be equal, with
+  // Training_Mode::full and the ones of the saved weight matrix with
+  // Training_Mode::incremental
+  Dimensions acquire_dimensions_() const;
+
+  // Acquires every pattern in "../base_directory/patterns/"
+  std::vector<std::vector<int>> acquire_patterns_() const;
 
  public:
   /*
@@ -27,16 +52,50 @@ class Training
    * execution. Alternatively the program throws an error since the
    * patterns_directory_ does not exist.
    */
-  Training(std::filesystem::path const& base_directory);
+  Training(std::filesystem::path const& base_directory,
+           Training_Mode mode = Training_Mode::full);
 
   Training();
 
+  Training_Mode mode() const;
+
+  Dimensions dimensions() const;
+
   const Weight_Matrix& weight_matrix() const;
 
+  const Pattern_Memory& pattern_memory() const;
+
   // Acquires patterns from "../base_directory/patterns/" and saves
-  // the wheight_matrix in a one-line .txt file in
-  // "../base_directory/weight_matrix/"
-  void acquire_and_save_weight_matrix();
+  // the wheight_matrix in the binary file "weight_matrix.bin" in
+  // "../base_directory/weight_matrix/", with the given storage
+  void acquire_and_save_weight_matrix(
+      Weight_Storage storage = Weight_Storage::real);
+
+  // Acquires patterns from "../base_directory/patterns/" and saves them
+  // bit-packed in the binary file "pattern_memory.bin" in
+  // "../base_directory/weight_matrix/", to be used by
+  // Recall_Backend::pattern_memory; no weight is computed
+  void acquire_and_save_pattern_memory();
+
+  // Acquires patterns from "../base_directory/patterns/" and saves the
+  // weight matrix in tiles of tile_size * tile_size weights in the file
+  // "weight_matrix.tiles" in "../base_directory/weight_matrix/", to be used
+  // by Recall_Backend::tiled_weight_matrix; the tiles are computed in
+  // parallel and written one by one, so the weights are never all in memory
+  void acquire_and_save_tiled_weight_matrix(
+      std::size_t tile_size = default_weight_tile_size);
+
+  /*
+   * Only with Training_Mode::incremental. Loads "weight_matrix.bin" from
+   * "../base_directory/weight_matrix/", removes the patterns of the files
+   * removed and adds the ones of the files added, then saves the matrix back
+   * in the same storage. Paths are relative to the build/ directory; a file
+   * removed must hold the pattern as it was when it was trained. Costs O(N^2)
+   * per file, with no rescan of "../base_directory/patterns/".
+   */
+  void update_and_save_weight_matrix(
+      std::vector<std::filesystem::path> const& added,
+      std::vector<std::filesystem::path> const& removed);
 };
 
 } // namespace nn
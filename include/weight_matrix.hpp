@@ -3,7 +3,19 @@
 #ifndef NN_WEIGHT_MATRIX_HPP
 #define NN_WEIGHT_MATRIX_HPP
 
+// These two paths are the only ones relative to "weight_matrix.hpp"
+#include "dimensions.hpp"
+#include "thread_pool.hpp"
+
+#include <cassert>
+#include <cstdint>
 #include <filesystem>
+#include <memory>
+#include <new>
+#include <span>
+#include <string>
+#include <tuple>
+#include <utility>
 #include <vector>
 
 namespace nn {
@@ -18,37 +30,354 @@ void increment_ij(std::size_t& i, std::size_t& j, std::size_t N);
 double compute_weight_ij(std::size_t i, std::size_t j, std::size_t N,
                          std::vector<std::vector<int>> const& patterns);
 
+// Neuron-major bitsets of the patterns used by the tiled fills: bit mu % 64
+// of values[i * words + mu / 64] is set if the (i + 1)-th neuron is +1 in the
+// pattern mu, and the unused bits of the last word of each neuron are cleared
+std::vector<std::uint64_t>
+transpose_patterns(std::vector<std::vector<int>> const& patterns,
+                   std::size_t neurons, std::size_t words);
+
+// Sets sums[(i - rows.first) * stride + j - columns.first] to the Hebbian sum
+// sum_mu p_i^mu * p_j^mu of the P patterns transposed in values, for every
+// 0-based i in [rows.first, rows.second) and j > i in [columns.first,
+// columns.second); the other elements of sums are left unchanged. The popcount
+// uses AVX2 or POPCNT when the CPU supports them.
+void hebbian_sums(std::vector<std::uint64_t> const& values, std::size_t P,
+                  std::size_t words, std::pair<std::size_t, std::size_t> rows,
+                  std::pair<std::size_t, std::size_t> columns,
+                  std::span<std::int64_t> sums, std::size_t stride);
+
+// Real: the weights w_ij as doubles. Counts: the integer sums
+// sum_mu p_i^mu * p_j^mu, in [-P, P], as 8-bit integers when P < 128 and as
+// 16-bit integers otherwise, w_ij being the count divided by N.
+enum class Weight_Storage
+{
+  real,
+  counts
+};
+
+// Packed: the upper triangle, N * (N - 1) / 2 elements, row by row. Dense:
+// the N * N matrix, null diagonal included, each row padded to a multiple of
+// 64 bytes and starting on a 64-byte boundary, so that every row is
+// contiguous. The dense layout is available with Weight_Storage::real only.
+enum class Weight_Layout
+{
+  packed,
+  dense
+};
+
+// Allocator of std::vector aligning the elements on Alignment bytes
+template<class T, std::size_t Alignment>
+struct Aligned_Allocator
+{
+  using value_type = T;
+
+  template<class U>
+  struct rebind
+  {
+    using other = Aligned_Allocator<U, Alignment>;
+  };
+
+  Aligned_Allocator() = default;
+
+  template<class U>
+  Aligned_Allocator(Aligned_Allocator<U, Alignment> const&)
+  {}
+
+  T* allocate(std::size_t n)
+  {
+    return static_cast<T*>(
+        ::operator new(n * sizeof(T), std::align_val_t{Alignment}));
+  }
+
+  void deallocate(T* pointer, std::size_t)
+  {
+    ::operator delete(pointer, std::align_val_t{Alignment});
+  }
+
+  bool operator==(Aligned_Allocator const&) const = default;
+};
+
+// Header of the binary weight matrix format (".bin" files); it is followed by
+// the stored elements in the same order as weights_, so that the payload
+// starts 64-byte aligned and can be used in place once mapped
+struct Weight_Matrix_Header
+{
+  char magic[8];              // "HNN-WM" padded with '\0'
+  std::uint32_t version;      // Currently 1
+  std::uint32_t element_type; // 1: 64-bit IEEE 754 double, 2: 8-bit integer
+                              // count, 3: 16-bit integer count
+  std::uint32_t layout;       // 1: packed upper triangle, row by row
+  std::uint32_t reserved;
+  std::uint64_t neurons;
+  std::uint64_t entries; // neurons * (neurons - 1) / 2
+  std::uint64_t checksum;
+  std::uint32_t width;  // 0 if unknown, for files of square networks saved
+  std::uint32_t height; // before the dimensions were stored
+  std::uint64_t padding;
+};
+
+static_assert(sizeof(Weight_Matrix_Header) == 64);
+
+// Dimensions stored in the header of the binary weight matrix file at path,
+// or square_dimensions() of its number of neurons if they are unknown
+Dimensions read_weight_matrix_dimensions(std::filesystem::path const& path);
+
+// FNV-1a hash computed on the bit representation of the weights
+std::uint64_t compute_checksum(std::span<const double> weights);
+
+// FNV-1a hash computed on the counts, each one sign-extended to 64 bits
+std::uint64_t compute_checksum(std::span<const std::int8_t> counts);
+
+std::uint64_t compute_checksum(std::span<const std::int16_t> counts);
+
+// Largest number of neurons for which Weight_Matrix::count_products() sums
+// fit in 32 bits: (N - 1) * 32767 < 2^31
+constexpr std::size_t max_count_products_neurons{65'536};
+
 class Weight_Matrix
 {
  private:
   const std::size_t neurons_;
 
+  Weight_Storage storage_;
+
   // Since weight matrix is symmetric neurons_ * neurons_ with null diagonal
-  // weights_.size() == neurons_ * (neurons_ - 1) / 2 after the call to fill()
+  // weights_.size() == neurons_ * (neurons_ - 1) / 2 after the call to fill();
+  // with Weight_Storage::counts the same holds for counts8_ or counts16_, the
+  // other containers staying empty
   std::vector<double> weights_;
+  std::vector<std::int8_t> counts8_;
+  std::vector<std::int16_t> counts16_;
+
+  // With Weight_Layout::dense the weights are in dense_ only, w_ij being
+  // dense_[(i - 1) * stride_ + j - 1]
+  Weight_Layout layout_;
+  std::vector<double, Aligned_Allocator<double, 64>> dense_;
+  const std::size_t stride_;
+
+  // Size in bytes of a stored element: 8, 1 or 2
+  std::size_t element_size_;
+
+  // When a ".bin" file is loaded the elements are read in place from the
+  // mapped file, the containers stay empty and mapping_ keeps the mapping
+  // alive
+  std::shared_ptr<const void> mapping_;
+  const void* mapped_data_;
+
+  void clear_();
+
+  void save_to_text_file_(std::filesystem::path const& path) const;
+  // Header and payload of the binary format
+  std::tuple<Weight_Matrix_Header, const void*, std::size_t>
+  binary_contents_(Dimensions dimensions) const;
+
+  void save_to_binary_file_(std::filesystem::path const& path,
+                            Dimensions dimensions) const;
+
+  // dimensions is {0, 0} if unknown
+  void save_(std::filesystem::path const& matrix_directory,
+             std::filesystem::path const& name, Dimensions dimensions) const;
+  void load_from_text_file_(std::filesystem::path const& path);
+  void load_from_binary_file_(std::filesystem::path const& path);
+
+  // Maps the binary format read from descriptor, which is closed; source
+  // names it in the error messages
+  void map_binary_(int descriptor, std::string const& source);
+
+  // Runs the tiled fill on pool, or serially if pool is nullptr
+  void fill_(std::vector<std::vector<int>> const& patterns,
+             Weight_Storage storage, Thread_Pool* pool);
+
+  // Adds sign * p_i * p_j, sign being +1 or -1, to every count of the matrix
+  void update_pattern_(std::vector<int> const& pattern, int sign);
 
  public:
   // Not necessary but useful in testing
   Weight_Matrix(std::size_t neurons);
 
+  // default_dimensions.neurons() neurons
   Weight_Matrix();
 
-  const std::vector<double>& weights() const;
+  // Only with Weight_Storage::real and Weight_Layout::packed
+  std::span<const double> weights() const;
+
+  // Number of weights of the upper triangle, N * (N - 1) / 2 once the matrix
+  // is filled or loaded, whatever the storage and the layout
+  std::size_t size() const;
 
   std::size_t neurons() const;
 
+  Weight_Storage storage() const;
+
+  Weight_Layout layout() const;
+
+  // Converts the matrix to layout, leaving the weights unchanged; a mapped
+  // matrix is copied. Throws with Weight_Layout::dense and
+  // Weight_Storage::counts.
+  void set_layout(Weight_Layout layout);
+
+  // Only with Weight_Layout::dense: the N weights w_ij of the i-th row, the
+  // row starting on a 64-byte boundary; i is 1-based
+  std::span<const double> row(std::size_t i) const;
+
+  bool is_mapped() const;
+
+  /*
+   * Only with Weight_Layout::packed.
+   * Calls function(elements, divisor) with the stored elements, a span of
+   * const double, std::int8_t or std::int16_t, and the divisor d such that
+   * w_ij = elements[matrix_to_vector_index(i, j, N)] / d: 1 with
+   * Weight_Storage::real and N with Weight_Storage::counts. Lets a kernel be
+   * written once for every storage.
+   */
+  template<class Function>
+  decltype(auto) visit(Function&& function) const;
+
   double at(std::size_t i, std::size_t j) const;
 
-  void fill(std::vector<std::vector<int>> const& patterns, std::size_t neurons);
+  // Adds factor * w_ij to target[j - 1] for every j, i.e. factor times the
+  // i-th row (equivalently column) of the matrix; i is 1-based
+  void accumulate_row(std::size_t i, double factor,
+                      std::span<double> target) const;
+
+  // As above, restricted to the positions begin <= j - 1 < end of target
+  void accumulate_row(std::size_t i, double factor, std::span<double> target,
+                      std::size_t begin, std::size_t end) const;
+
+  // sum_j w_ij * state[j - 1] for j <= state.size(), the products being added
+  // with increasing j as with at(), without computing the index of every
+  // weight; i is 1-based. With Weight_Layout::dense the row is read
+  // contiguously.
+  double row_product(std::size_t i, std::vector<int> const& state) const;
+
+  // Sets result[i - 1] = row_product(i, state) for every i. The packed
+  // triangle is streamed once, every w_ij being used for both result[i - 1]
+  // and result[j - 1]; the additions are made in the same order as in
+  // row_product(), so the results are the same. The dense matrix is streamed
+  // row by row.
+  void multiply(std::vector<int> const& state, std::span<double> result) const;
+
+  /*
+   * Only with Weight_Storage::counts and at most max_count_products_neurons
+   * neurons. Sets sums[i - 1] = sum_j c_ij * state[j - 1], the integer
+   * numerator of the i-th local field, for a state of +1 and -1 values. The
+   * packed triangle is streamed once in 16-bit integer arithmetic, with AVX2
+   * or SSE4.1 when the CPU supports them; no floating-point operation is
+   * done. values is a buffer of N elements owned by the caller, which
+   * receives the state as 16-bit integers, so nothing is allocated.
+   */
+  void count_products(std::vector<int> const& state,
+                      std::span<std::int16_t> values,
+                      std::span<std::int32_t> sums) const;
 
+  /*
+   * Training as a symmetric rank-P update: the patterns are transposed into
+   * one bitset over the patterns per neuron, so that
+   * sum_mu p_i^mu * p_j^mu = P - 2 * popcount(x_i ^ x_j), and the upper
+   * triangle is computed in square tiles of weights, reading the bitsets in
+   * slices small enough for the rows of a tile to stay in cache. The popcount
+   * uses AVX2 or POPCNT when the CPU supports them. The weights are equal to
+   * compute_weight_ij(). With Weight_Storage::counts the sums themselves are
+   * stored and there must be at most 32767 patterns. The matrix is left with
+   * Weight_Layout::packed.
+   */
+  void fill(std::vector<std::vector<int>> const& patterns, std::size_t neurons,
+            Weight_Storage storage = Weight_Storage::real);
+
+  // As above, the tiles being distributed dynamically over the threads of pool
+  void fill(std::vector<std::vector<int>> const& patterns, std::size_t neurons,
+            Thread_Pool& pool, Weight_Storage storage = Weight_Storage::real);
+
+  /*
+   * Incremental training: adds the Hebbian term p_i * p_j / N of pattern to
+   * every weight in O(N^2), without the other patterns. The update is made on
+   * the integer counts, recovered from the doubles with Weight_Storage::real,
+   * so the weights are bit-identical to the ones of fill() with pattern added
+   * to the patterns. 8-bit counts are widened to 16 bits when needed, and
+   * beyond 32767 patterns a std::runtime_error is thrown. A mapped matrix is
+   * copied first; an empty one starts from null weights.
+   */
+  void add_pattern(std::vector<int> const& pattern);
+
+  // As above, subtracting the term of pattern, which must have been stored:
+  // add_pattern() followed by remove_pattern() restores the original bits
+  void remove_pattern(std::vector<int> const& pattern);
+
+  // The format is chosen by the extension of name: ".txt" for the
+  // space-separated text format, ".bin" for the binary format. The text format
+  // always contains the weights; the binary one keeps the storage. Both store
+  // the packed layout.
   void save_to_file(std::filesystem::path const& matrix_directory,
                     std::filesystem::path const& name,
                     std::size_t neurons) const;
 
+  // As above, the binary header also storing the dimensions of the network
+  void save_to_file(std::filesystem::path const& matrix_directory,
+                    std::filesystem::path const& name,
+                    Dimensions dimensions) const;
+
+  // ".bin" files are memory-mapped and used in place without copying when
+  // layout is Weight_Layout::packed, and converted otherwise
   void load_from_file(std::filesystem::path const& matrix_directory,
-                      std::filesystem::path const& name, std::size_t neurons);
+                      std::filesystem::path const& name, std::size_t neurons,
+                      Weight_Layout layout = Weight_Layout::packed);
+
+  /*
+   * Copies the matrix in the binary format into the POSIX shared memory
+   * object name (such as "/hopfield_weights"), replacing any previous object
+   * of that name, so that other processes can map it with
+   * load_from_shared_memory() without reading or parsing any file. The object
+   * lives until remove_shared_weight_matrix() or the next reboot.
+   */
+  void save_to_shared_memory(std::string const& name,
+                             Dimensions dimensions = {0, 0}) const;
+
+  // Maps the shared memory object name in place, as a ".bin" file: every
+  // process mapping it reads the same physical pages
+  void load_from_shared_memory(std::string const& name, std::size_t neurons);
 };
 
+// Unlinks the POSIX shared memory object name; the processes which have it
+// mapped keep their mapping
+void remove_shared_weight_matrix(std::string const& name);
+
+// Immutable weight matrix shared by several users, e.g. Recall objects; it is
+// released with the last handle
+using Shared_Weight_Matrix = std::shared_ptr<const Weight_Matrix>;
+
+/*
+ * Loads the weight matrix file at path (".bin" or ".txt") once per process:
+ * while a handle to it is alive, later calls for the same unchanged file
+ * return that handle without loading anything. A ".bin" file is mapped with
+ * MAP_SHARED, so every process mapping it shares its pages through the page
+ * cache. Thread-safe.
+ */
+Shared_Weight_Matrix
+load_shared_weight_matrix(std::filesystem::path const& path,
+                          std::size_t neurons);
+
+template<class Function>
+decltype(auto) Weight_Matrix::visit(Function&& function) const
+{
+  assert(layout_ == Weight_Layout::packed);
+
+  if (storage_ == Weight_Storage::real) {
+    return function(weights(), 1.);
+  }
+
+  auto divisor = static_cast<double>(neurons_);
+  if (element_size_ == sizeof(std::int16_t)) {
+    auto data = is_mapped() ? static_cast<const std::int16_t*>(mapped_data_)
+                            : counts16_.data();
+    return function(std::span<const std::int16_t>{data, size()}, divisor);
+  }
+  assert(element_size_ == sizeof(std::int8_t));
+  auto data = is_mapped() ? static_cast<const std::int8_t*>(mapped_data_)
+                          : counts8_.data();
+  return function(std::span<const std::int8_t>{data, size()}, divisor);
+}
+
 } // namespace nn
 
 #endif
\ No newline at end of file
@@ -0,0 +1,45 @@
+// All relative paths are relative to the build/ directory
+
+#ifndef NN_WEIGHT_MATRIX_KERNELS_HPP
+#define NN_WEIGHT_MATRIX_KERNELS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace nn {
+
+// The versions of the kernels of Weight_Matrix, exposed so that each one can
+// be tested: a kernels function lists every version the CPU supports, the
+// portable one first and the fastest one, used by Weight_Matrix, last. All
+// the versions give the same results.
+template<class Function>
+struct Kernel
+{
+  std::string_view name;
+  Function function;
+};
+
+// Number of bits set in first[w] ^ second[w] for w < words, i.e. the number
+// of patterns in which two neurons have opposite values
+using Different_Bits = std::int64_t (*)(const std::uint64_t*,
+                                        const std::uint64_t*, std::size_t);
+
+std::vector<Kernel<Different_Bits>> different_bits_kernels();
+
+// Adds to sums the products of the packed triangle of counts with state, of
+// +1 and -1 values: sums[i] += sum_j c_ij * s_j. Count is std::int8_t or
+// std::int16_t.
+template<class Count>
+using Count_Products = void (*)(std::span<const Count>,
+                                std::span<const std::int16_t>,
+                                std::span<std::int32_t>);
+
+template<class Count>
+std::vector<Kernel<Count_Products<Count>>> count_products_kernels();
+
+} // namespace nn
+
+#endif
@@ -6,6 +6,14 @@
  * $ cd build/
  * build$ Debug/acquisition
  *
+ * Images are resized to 64x64 pixels unless the option --size gives other
+ * dimensions, which are then stored in the pattern files and used by training
+ * and recall:
+ *
+ * build$ Debug/acquisition --size 128x128
+ *
+ * The images are acquired by all the hardware threads.
+ *
  * Running from other directory may cause errors due to incorrect relative
  * paths.
  */
@@ -15,14 +23,30 @@
 #include <cstdlib>
 #include <exception>
 #include <iostream>
+#include <stdexcept>
+#include <string>
 
-int main()
+int main(int argc, char* argv[])
 {
   try {
-    nn::Acquisition acquisition;
+    auto dimensions = nn::default_dimensions;
+    if (argc > 2 && std::string{argv[1]} == "--size") {
+      std::string size{argv[2]};
+      auto separator = size.find('x');
+      if (separator == std::string::npos) {
+        throw std::runtime_error("Invalid size \"" + size
+                                 + "\": expected <width>x<height>.");
+      }
+      dimensions = {static_cast<unsigned int>(std::stoul(size)),
+                    static_cast<unsigned int>(
+                        std::stoul(size.substr(separator + 1)))};
+    }
+
+    nn::Acquisition acquisition{"", dimensions};
 
-    acquisition.acquire_and_save_patterns();
-    acquisition.save_binarized_images();
+    // The patterns and the binarized images are written by the pipeline
+    nn::Thread_Pool pool;
+    acquisition.acquire_and_save_patterns(pool);
 
   } catch (std::exception const& e) {
     std::cerr << "Caught exception: '" << e.what() << "'\n";
@@ -0,0 +1,232 @@
+/*
+ * Compares the serial and the parallel versions of the local field, energy
+ * and synchronous update computations on a 4096-neuron network trained on
+ * random patterns, and the packed double weights with the dense layout, the
+ * integer counts and the pattern memory, the generic network with the
+ * compile-time Network<64, 64>, and the out-of-core tiled matrix, written to
+ * the temporary directory, with and without tile cache. The number of threads
+ * can be given as argument.
+ *
+ * For example:
+ *
+ * $ cd build/
+ * build$ Release/benchmark 32
+ */
+
+#include "../include/network.hpp"
+#include "../include/recall.hpp"
+#include "../include/tiled_weight_matrix.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+
+namespace {
+
+// Average time in milliseconds of a call to function
+template<class Function>
+double time_ms(Function&& function, int repetitions)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (int r{0}; r != repetitions; ++r) {
+    function();
+  }
+  std::chrono::duration<double, std::milli> elapsed{
+      std::chrono::steady_clock::now() - start};
+  return elapsed.count() / repetitions;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  try {
+    std::size_t max_threads = std::thread::hardware_concurrency();
+    if (argc > 1) {
+      max_threads = std::stoul(argv[1]);
+    }
+
+    constexpr std::size_t N{4096};
+    std::default_random_engine engine{2024};
+    std::bernoulli_distribution dist{0.5};
+
+    std::vector<std::vector<int>> patterns(10, std::vector<int>(N));
+    for (auto& pattern : patterns) {
+      for (auto& value : pattern) {
+        value = dist(engine) ? +1 : -1;
+      }
+    }
+    nn::Weight_Matrix weight_matrix(N);
+    weight_matrix.fill(patterns, N);
+
+    std::vector<int> state(N);
+    for (auto& value : state) {
+      value = dist(engine) ? +1 : -1;
+    }
+    // A late iteration: 64 flipped neurons
+    std::vector<std::size_t> flipped;
+    for (std::size_t j{1}; j <= N; j += N / 64) {
+      flipped.push_back(j);
+    }
+    auto fields = nn::hopfield_local_fields(state, weight_matrix);
+
+    auto serial_fields = time_ms(
+        [&] { (void)nn::hopfield_local_fields(state, weight_matrix); }, 5);
+    auto serial_energy =
+        time_ms([&] { (void)nn::hopfield_energy(state, weight_matrix); }, 5);
+    auto serial_update = time_ms(
+        [&] {
+          nn::update_local_fields(fields, flipped, state, weight_matrix);
+        },
+        20);
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "serial: local fields " << serial_fields << " ms, energy "
+              << serial_energy << " ms, update (64 flips) " << serial_update
+              << " ms\n";
+
+    nn::Weight_Matrix counts(N);
+    counts.fill(patterns, N, nn::Weight_Storage::counts);
+
+    auto counts_fields =
+        time_ms([&] { (void)nn::hopfield_local_fields(state, counts); }, 5);
+    auto counts_update = time_ms(
+        [&] { nn::update_local_fields(fields, flipped, state, counts); }, 20);
+
+    std::cout << "count storage: local fields " << counts_fields
+              << " ms, update (64 flips) " << counts_update << " ms\n";
+
+    auto dense = weight_matrix;
+    dense.set_layout(nn::Weight_Layout::dense);
+
+    auto dense_fields =
+        time_ms([&] { (void)nn::hopfield_local_fields(state, dense); }, 5);
+    auto dense_update = time_ms(
+        [&] { nn::update_local_fields(fields, flipped, state, dense); }, 20);
+
+    std::cout << "dense layout: local fields " << dense_fields
+              << " ms, update (64 flips) " << dense_update << " ms\n";
+
+    nn::Pattern_Memory pattern_memory(N);
+    pattern_memory.fill(patterns, N);
+
+    auto memory_fields = time_ms(
+        [&] { (void)nn::hopfield_local_fields(state, pattern_memory); }, 5);
+    auto memory_energy =
+        time_ms([&] { (void)nn::hopfield_energy(state, pattern_memory); }, 5);
+    auto memory_update = time_ms(
+        [&] {
+          nn::update_local_fields(fields, flipped, state, pattern_memory);
+        },
+        20);
+
+    std::cout << "pattern memory: local fields " << memory_fields
+              << " ms, energy " << memory_energy << " ms, update (64 flips) "
+              << memory_update << " ms\n";
+
+    // Full dynamics from a pattern with 10% of its neurons flipped
+    auto probe = patterns.front();
+    for (std::size_t i{0}; i < N; i += 10) {
+      probe[i] = -probe[i];
+    }
+    nn::Generic_Network generic(weight_matrix, {64, 64});
+    nn::Network<64, 64> specialized(weight_matrix);
+    auto generic_dynamics = time_ms(
+        [&] {
+          auto copy = probe;
+          (void)generic.update_dynamics(copy, 100);
+        },
+        5);
+    auto specialized_fields =
+        time_ms([&] { (void)specialized.local_fields(state); }, 5);
+    auto specialized_dynamics = time_ms(
+        [&] {
+          auto copy = probe;
+          (void)specialized.update_dynamics(copy, 100);
+        },
+        5);
+
+    std::cout << "Network<64, 64>: local fields " << specialized_fields
+              << " ms, dynamics " << specialized_dynamics
+              << " ms (generic network: " << generic_dynamics << " ms)\n";
+
+    // The whole triangle, 36 tiles of 2 MiB, fits in the first cache, and the
+    // second one holds none: every pass streams the file with read-ahead
+    auto tiles_directory = std::filesystem::temp_directory_path() / "";
+    nn::Tiled_Weight_Matrix cached(N, 128ull << 20);
+    cached.fill(patterns, N, tiles_directory, "benchmark.tiles");
+    nn::Tiled_Weight_Matrix streamed(N, 0);
+    streamed.load_from_file(tiles_directory, "benchmark.tiles", N);
+
+    std::vector<double> tiled_fields(N);
+    auto cached_fields =
+        time_ms([&] { cached.multiply(state, tiled_fields); }, 5);
+    auto streamed_fields =
+        time_ms([&] { streamed.multiply(state, tiled_fields); }, 5);
+    std::filesystem::remove(tiles_directory / "benchmark.tiles");
+
+    std::cout << "tiled matrix: local fields " << cached_fields
+              << " ms cached, " << streamed_fields << " ms streamed (at most "
+              << streamed.max_resident_bytes() / (1 << 20) << " MiB)\n";
+
+    std::vector<std::size_t> thread_counts;
+    for (std::size_t threads{1}; threads < max_threads; threads *= 2) {
+      thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(std::max<std::size_t>(max_threads, 1));
+
+    for (auto threads : thread_counts) {
+      nn::Thread_Pool pool(threads);
+      for (auto partitioning :
+           {nn::Partitioning::blocked, nn::Partitioning::dynamic}) {
+        auto parallel_fields = time_ms(
+            [&] {
+              (void)nn::hopfield_local_fields(state, weight_matrix, pool,
+                                              partitioning);
+            },
+            5);
+        auto parallel_energy = time_ms(
+            [&] {
+              (void)nn::hopfield_energy(state, weight_matrix, pool,
+                                        partitioning);
+            },
+            5);
+        auto parallel_update = time_ms(
+            [&] {
+              nn::update_local_fields(fields, flipped, state, weight_matrix,
+                                      pool, partitioning);
+            },
+            20);
+
+        auto dense_parallel_fields = time_ms(
+            [&] {
+              (void)nn::hopfield_local_fields(state, dense, pool,
+                                              partitioning);
+            },
+            5);
+
+        std::cout << threads << " threads, "
+                  << (partitioning == nn::Partitioning::blocked ? "blocked"
+                                                                : "dynamic")
+                  << ": local fields x" << serial_fields / parallel_fields
+                  << ", energy x" << serial_energy / parallel_energy
+                  << ", update x" << serial_update / parallel_update
+                  << ", dense local fields x"
+                  << serial_fields / dense_parallel_fields << '\n';
+      }
+    }
+
+  } catch (std::exception const& e) {
+    std::cerr << "Caught exception: '" << e.what() << "'\n";
+    return EXIT_FAILURE;
+  } catch (...) {
+    std::cerr << "Caught unknown exception\n";
+    return EXIT_FAILURE;
+  }
+}
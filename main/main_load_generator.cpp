@@ -0,0 +1,110 @@
+/*
+ * Load generator for "recall_server": every client thread opens a connection
+ * and sends its requests one at a time, each one for the stored pattern name
+ * with 10% noise drawn from a different seed. The throughput and the
+ * latencies seen by the clients are printed.
+ *
+ * Usage: load_generator [clients] [requests] [name] [socket path]
+ *
+ * For example:
+ *
+ * $ cd build/
+ * build$ Release/load_generator 16 200 ae.txt recall.sock
+ */
+
+#include "../include/recall_server.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+int main(int argc, char* argv[])
+{
+  try {
+    std::size_t clients  = argc > 1 ? std::stoul(argv[1]) : 8;
+    std::size_t requests = argc > 2 ? std::stoul(argv[2]) : 100;
+    std::string name     = argc > 3 ? argv[3] : "ae.txt";
+    std::filesystem::path socket_path{argc > 4 ? argv[4] : "recall.sock"};
+
+    // Latencies in microseconds, one vector per client
+    std::vector<std::vector<double>> latencies(clients);
+    std::atomic<std::size_t> errors{0};
+    std::atomic<std::size_t> restored{0};
+    std::mutex failure_mutex;
+    std::exception_ptr failure;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (std::size_t c{0}; c != clients; ++c) {
+      threads.emplace_back([&, c] {
+        try {
+          nn::Recall_Client client(socket_path);
+          nn::Recall_Request request;
+          request.name       = name;
+          request.corruption = nn::Corruption::noise;
+          request.noise      = 0.1;
+          latencies[c].reserve(requests);
+          for (std::size_t r{0}; r != requests; ++r) {
+            request.seed = static_cast<std::uint32_t>(c * requests + r);
+            auto sent    = std::chrono::steady_clock::now();
+            auto response = client.recall(request);
+            std::chrono::duration<double, std::micro> latency{
+                std::chrono::steady_clock::now() - sent};
+            latencies[c].push_back(latency.count());
+            if (!response.ok) {
+              ++errors;
+            } else if (response.overlap == 1.) {
+              ++restored;
+            }
+          }
+        } catch (...) {
+          std::lock_guard lock{failure_mutex};
+          failure = std::current_exception();
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    std::chrono::duration<double> elapsed{std::chrono::steady_clock::now()
+                                          - start};
+    if (failure) {
+      std::rethrow_exception(failure);
+    }
+
+    std::vector<double> all;
+    for (auto const& client_latencies : latencies) {
+      all.insert(all.end(), client_latencies.begin(), client_latencies.end());
+    }
+    std::sort(all.begin(), all.end());
+    auto percentile = [&](double p) {
+      return all.empty() ? 0.
+                         : all[static_cast<std::size_t>(
+                               p * static_cast<double>(all.size() - 1))];
+    };
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << all.size() << " requests from " << clients << " clients in "
+              << elapsed.count() << " s: "
+              << static_cast<double>(all.size()) / elapsed.count()
+              << " requests/s\n"
+              << "latency: p50 " << percentile(0.5) << " us, p99 "
+              << percentile(0.99) << " us, max " << percentile(1.) << " us\n"
+              << "restored " << restored << ", errors " << errors << '\n';
+
+  } catch (std::exception const& e) {
+    std::cerr << "Caught exception: '" << e.what() << "'\n";
+    return EXIT_FAILURE;
+  } catch (...) {
+    std::cerr << "Caught unknown exception\n";
+    return EXIT_FAILURE;
+  }
+}
\ No newline at end of file
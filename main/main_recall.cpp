@@ -6,23 +6,59 @@
  * $ cd build/
  * build$ Debug/recall
  *
+ * With the option --pattern-memory the network is read from the patterns saved
+ * by "training --pattern-memory" instead of the weight matrix:
+ *
+ * build$ Debug/recall --pattern-memory
+ *
+ * With the option --tiled the weights are streamed from the tiles saved by
+ * "training --tiled", for networks whose weights do not fit in memory:
+ *
+ * build$ Debug/recall --tiled
+ *
+ * With the option --dense the weight matrix is expanded to the dense layout,
+ * N * N weights with contiguous rows, which takes twice the memory:
+ *
+ * build$ Debug/recall --dense
+ *
  * Running from other directory may cause errors due to incorrect relative
  * paths.
  */
 
 #include "../include/recall.hpp"
 
+#include <algorithm>
 #include <cstdlib>
 #include <exception>
 #include <iostream>
+#include <string>
 
-int main()
+int main(int argc, char* argv[])
 {
   try {
-    nn::Recall recall;
+    auto backend = nn::Recall_Backend::weight_matrix;
+    if (argc > 1 && std::string{argv[1]} == "--pattern-memory") {
+      backend = nn::Recall_Backend::pattern_memory;
+    } else if (argc > 1 && std::string{argv[1]} == "--tiled") {
+      backend = nn::Recall_Backend::tiled_weight_matrix;
+    }
+    nn::Recall recall("", backend);
+    if (argc > 1 && std::string{argv[1]} == "--dense") {
+      recall.set_weight_layout(nn::Weight_Layout::dense);
+    }
+
+    nn::Console_Observer console;
+    // 192 pixels per side at most, as 64x64 networks scaled by 3
+    auto [width, height] = recall.dimensions();
+    auto scale           = std::max(1.f, 192.f / static_cast<float>(width));
+    nn::Window_Observer window(width, height, scale);
+    nn::Observer_List observers({&console, &window});
 
     recall.corrupt_pattern("ae.txt");
-    recall.network_update_dynamics();
+    auto termination = recall.network_update_dynamics(observers);
+    if (termination == nn::Termination::cycle) {
+      std::cout << "The dynamics oscillates between states.\n";
+    }
     recall.save_current_state("ae.txt");
 
   } catch (std::exception const& e) {
@@ -0,0 +1,73 @@
+/*
+ * Sends one recall request to a running "recall_server": the stored pattern
+ * given as argument (by default "ae.txt") with 10% of its neurons flipped, or
+ * the noise given as second argument. The third argument is the socket path,
+ * by default "recall.sock". The outcome of the dynamics is printed.
+ *
+ * For example:
+ *
+ * $ cd build/
+ * build$ Release/recall_client ae.txt 0.2
+ *
+ * The pattern is read by the server, from its own patterns directory.
+ */
+
+#include "../include/recall_server.hpp"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+
+namespace {
+
+const char* termination_name(nn::Termination termination)
+{
+  switch (termination) {
+  case nn::Termination::fixed_point:
+    return "fixed point";
+  case nn::Termination::cycle:
+    return "cycle";
+  case nn::Termination::iteration_budget:
+    return "iteration budget exhausted";
+  case nn::Termination::time_budget:
+    return "time budget exhausted";
+  }
+  return "unknown";
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  try {
+    nn::Recall_Request request;
+    request.name       = argc > 1 ? argv[1] : "ae.txt";
+    request.corruption = nn::Corruption::noise;
+    request.noise      = argc > 2 ? std::stod(argv[2]) : 0.1;
+    request.seed       = std::random_device{}();
+    std::filesystem::path socket_path{argc > 3 ? argv[3] : "recall.sock"};
+
+    nn::Recall_Client client(socket_path);
+    auto response = client.recall(request);
+    if (!response.ok) {
+      std::cerr << "Request refused: '" << response.error << "'\n";
+      return EXIT_FAILURE;
+    }
+
+    std::cout << "Termination: " << termination_name(response.termination)
+              << " after " << response.iterations << " iterations\n"
+              << "Energy: " << response.energy << '\n'
+              << "Overlap with the original pattern: " << response.overlap
+              << '\n'
+              << "Served in " << response.microseconds << " us\n";
+
+  } catch (std::exception const& e) {
+    std::cerr << "Caught exception: '" << e.what() << "'\n";
+    return EXIT_FAILURE;
+  } catch (...) {
+    std::cerr << "Caught unknown exception\n";
+    return EXIT_FAILURE;
+  }
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+/*
+ * To run this program, execute from the build/ directory.
+
+ * For example:
+ *
+ * $ cd build/
+ * build$ Release/recall_server
+ *
+ * The server loads "../weight_matrix/weight_matrix.bin" once and serves the
+ * recall requests received on the Unix domain socket "recall.sock" until it
+ * is interrupted (Ctrl-C or SIGTERM). The socket path and the number of
+ * workers, by default the number of hardware threads, can be given as
+ * arguments:
+ *
+ * build$ Release/recall_server /tmp/recall.sock 8
+ *
+ * Requests are sent by "recall_client" and "load_generator".
+ *
+ * Running from other directory may cause errors due to incorrect relative
+ * paths.
+ */
+
+#include "../include/recall_server.hpp"
+
+#include <algorithm>
+#include <csignal>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <pthread.h>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+int main(int argc, char* argv[])
+{
+  try {
+    std::filesystem::path socket_path{argc > 1 ? argv[1] : "recall.sock"};
+    std::size_t workers = std::max(1u, std::thread::hardware_concurrency());
+    if (argc > 2) {
+      workers = std::stoul(argv[2]);
+      if (workers == 0) {
+        throw std::runtime_error("The number of workers must be positive.");
+      }
+    }
+
+    // SIGINT and SIGTERM are blocked in every thread, the workers inheriting
+    // the mask, and awaited by the main thread
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    nn::Recall_Server server("", socket_path, workers);
+    auto [width, height] = server.dimensions();
+    std::cout << "Serving the " << width << "x" << height
+              << " network on \"" << socket_path.string() << "\" with "
+              << server.workers() << " workers" << std::endl;
+
+    int signal;
+    sigwait(&signals, &signal);
+    server.stop();
+    std::cout << "Server stopped." << '\n';
+
+  } catch (std::exception const& e) {
+    std::cerr << "Caught exception: '" << e.what() << "'\n";
+    return EXIT_FAILURE;
+  } catch (...) {
+    std::cerr << "Caught unknown exception\n";
+    return EXIT_FAILURE;
+  }
+}
\ No newline at end of file
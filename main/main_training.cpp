@@ -6,6 +6,29 @@
  * $ cd build/
  * build$ Debug/training
  *
+ * With the option --pattern-memory only the bit-packed patterns are saved, to
+ * be used by "recall --pattern-memory", and no weight matrix is computed:
+ *
+ * build$ Debug/training --pattern-memory
+ *
+ * With the option --counts the weight matrix is saved as integer counts (8 or
+ * 16 bits each) instead of doubles; recall reads either storage:
+ *
+ * build$ Debug/training --counts
+ *
+ * With the option --tiled the weight matrix is saved in square tiles, written
+ * one by one, for networks whose weights do not fit in memory; "recall
+ * --tiled" streams them from the file:
+ *
+ * build$ Debug/training --tiled
+ *
+ * With the option --update the saved weight matrix is updated instead of
+ * recomputed: the patterns of the files following --remove are subtracted and
+ * the ones of the files following --add are added, in the same storage. Files
+ * removed must hold the patterns as they were trained:
+ *
+ * build$ Debug/training --update --remove ../old/3.txt --add ../patterns/3.txt
+ *
  * Running from other directory may cause errors due to incorrect relative
  * paths.
  */
@@ -14,14 +37,49 @@
 
 #include <cstdlib>
 #include <exception>
+#include <filesystem>
 #include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
-int main()
+int main(int argc, char* argv[])
 {
   try {
+    if (argc > 1 && std::string{argv[1]} == "--update") {
+      std::vector<std::filesystem::path> added;
+      std::vector<std::filesystem::path> removed;
+      std::vector<std::filesystem::path>* target{nullptr};
+      for (int i{2}; i < argc; ++i) {
+        std::string argument{argv[i]};
+        if (argument == "--add") {
+          target = &added;
+        } else if (argument == "--remove") {
+          target = &removed;
+        } else if (target != nullptr) {
+          target->push_back(argument);
+        } else {
+          throw std::runtime_error("Unexpected argument \"" + argument
+                                   + "\": expected --add or --remove.");
+        }
+      }
+
+      nn::Training training{"", nn::Training_Mode::incremental};
+      training.update_and_save_weight_matrix(added, removed);
+      return EXIT_SUCCESS;
+    }
+
     nn::Training training;
 
-    training.acquire_and_save_weight_matrix();
+    if (argc > 1 && std::string{argv[1]} == "--pattern-memory") {
+      training.acquire_and_save_pattern_memory();
+    } else if (argc > 1 && std::string{argv[1]} == "--tiled") {
+      training.acquire_and_save_tiled_weight_matrix();
+    } else if (argc > 1 && std::string{argv[1]} == "--counts") {
+      training.acquire_and_save_weight_matrix(nn::Weight_Storage::counts);
+    } else {
+      training.acquire_and_save_weight_matrix();
+    }
 
   } catch (std::exception const& e) {
     std::cerr << "Caught exception: '" << e.what() << "'\n";
@@ -4,12 +4,31 @@
 #include "../include/acquisition.hpp"
 
 #include <algorithm>
+#include <array>
 #include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <utility>
 
 namespace nn {
 
+namespace {
+
+// An image travelling through the stages of the acquisition pipeline: index
+// is its position among the source files sorted by name
+struct Acquired_Image
+{
+  std::size_t index;
+  sf::Image image;
+  Pattern pattern;
+};
+
+} // namespace
+
 sf::Image load_image(std::filesystem::path const& path, unsigned int min_width,
                      unsigned int min_height)
 {
@@ -175,15 +194,20 @@ void Acquisition::configure_output_directories_() const
 }
 
 // base_directory can only be "" or "tests/"
-Acquisition::Acquisition(std::filesystem::path const& base_directory)
+Acquisition::Acquisition(std::filesystem::path const& base_directory,
+                         Dimensions dimensions)
     : source_directory_{"../" + base_directory.string()
                         + "images/source_images/"}
     , binarized_directory_{"../" + base_directory.string()
                            + "images/binarized_images/"}
     , patterns_directory_{"../" + base_directory.string() + "patterns/"}
     , extensions_allowed_{".jpg", ".jpeg", ".png"} // By assumption
+    , dimensions_{dimensions}
 {
   assert(extensions_allowed_.size() != 0);
+  if (dimensions_.neurons() == 0) {
+    throw std::runtime_error("Pattern dimensions must be positive.");
+  }
 
   validate_source_directory_();
   configure_output_directories_();
@@ -205,44 +229,189 @@ const std::vector<Pattern>& Acquisition::patterns() const
   return patterns_;
 }
 
-void Acquisition::acquire_and_save_patterns()
+Dimensions Acquisition::dimensions() const
 {
+  return dimensions_;
+}
+
+void Acquisition::acquire_and_save_patterns(Thread_Pool& pool,
+                                            std::size_t queue_capacity)
+{
+  if (queue_capacity == 0) {
+    throw std::runtime_error("The acquisition queues must hold an image.");
+  }
+
+  // The directory order depends on the file system
+  std::vector<std::filesystem::path> files;
   for (auto const& file :
        std::filesystem::directory_iterator(source_directory_)) {
     assert(file.is_regular_file());
     assert(extensions_allowed_.end()
            != std::find(extensions_allowed_.begin(), extensions_allowed_.end(),
                         file.path().extension()));
+    files.push_back(file.path());
+  }
+  std::sort(files.begin(), files.end());
+
+  std::vector<std::filesystem::path> names;
+  for (auto const& file : files) {
+    names.push_back(std::filesystem::path{file.filename()}.replace_extension(
+        ".txt"));
+    assert(names.back().extension() == ".txt");
+  }
+  std::vector<Pattern> patterns(files.size());
+
+  auto [width, height] = dimensions_;
+
+  // Stage 0 decodes the file of index next_file, stage s = 1, 2, 3 takes its
+  // images from queues[s - 1], and stage s < 3 puts them in queues[s];
+  // producing[s] counts the images of stage s, which have a place reserved
+  // in queues[s]. The images after the first failed one are dropped.
+  std::mutex mutex;
+  std::condition_variable progress;
+  std::array<std::deque<Acquired_Image>, 3> queues;
+  std::array<std::size_t, 3> producing{};
+  std::size_t running{0};
+  std::size_t next_file{0};
+  std::size_t failed{files.size()};
+  std::exception_ptr exception;
+
+  auto has_room = [&](std::size_t stage) {
+    return queues[stage].size() + producing[stage] < queue_capacity;
+  };
+
+  auto work = [&] {
+    std::unique_lock lock{mutex};
+    while (true) {
+      // The later stages go first, so that the images leave the pipeline
+      // before new ones enter it
+      std::size_t stage;
+      if (!queues[2].empty()) {
+        stage = 3;
+      } else if (!queues[1].empty() && has_room(2)) {
+        stage = 2;
+      } else if (!queues[0].empty() && has_room(1)) {
+        stage = 1;
+      } else if (next_file < failed && has_room(0)) {
+        stage = 0;
+      } else if (next_file >= failed && running == 0
+                 && std::all_of(queues.begin(), queues.end(),
+                                [](auto const& queue) {
+                                  return queue.empty();
+                                })) {
+        return;
+      } else {
+        progress.wait(lock);
+        continue;
+      }
+
+      Acquired_Image item;
+      if (stage == 0) {
+        item.index = next_file++;
+      } else {
+        item = std::move(queues[stage - 1].front());
+        queues[stage - 1].pop_front();
+        if (item.index > failed) {
+          progress.notify_all();
+          continue;
+        }
+      }
+      if (stage != 3) {
+        ++producing[stage];
+      }
+      ++running;
+      lock.unlock();
+
+      std::exception_ptr error;
+      try {
+        auto i = item.index;
+        switch (stage) {
+        case 0:
+          item.image = load_image(files[i], width, height);
+          assert(item.image.getSize().x >= width
+                 && item.image.getSize().y >= height);
+          break;
+        case 1:
+          item.image = resize_image(item.image, width, height);
+          assert(item.image.getSize().x == width
+                 && item.image.getSize().y == height);
+          break;
+        case 2:
+          item.pattern = binarize_image(item.image, width, height, 127);
+          assert(item.pattern.size() == dimensions_.neurons());
+          item.image = sf::Image{};
+          break;
+        default:
+          // The pattern goes to the image without being read back
+          item.pattern.save_to_file(patterns_directory_, names[i],
+                                    dimensions_);
+          item.pattern.save_image(binarized_directory_, names[i], width,
+                                  height);
+          patterns[i] = std::move(item.pattern);
+        }
+      } catch (...) {
+        error = std::current_exception();
+      }
 
-    auto image = load_image(file.path().string(), 64, 64);
-    assert(image.getSize().x >= 64 && image.getSize().y >= 64);
+      lock.lock();
+      --running;
+      if (stage != 3) {
+        --producing[stage];
+      }
+      if (error != nullptr) {
+        if (item.index < failed) {
+          failed    = item.index;
+          exception = error;
+        }
+      } else if (stage != 3 && item.index < failed) {
+        queues[stage].push_back(std::move(item));
+      }
+      progress.notify_all();
+    }
+  };
 
-    image = resize_image(image, 64, 64);
-    assert(image.getSize().x == 64 && image.getSize().y == 64);
+  pool.parallel_for(0, pool.threads(), Partitioning::blocked,
+                    [&](std::size_t, std::size_t) { work(); });
 
-    auto name = file.path().filename().replace_extension(".txt");
-    assert(name.extension() == ".txt");
+  assert(std::all_of(queues.begin(), queues.end(),
+                     [](auto const& queue) { return queue.empty(); }));
 
-    auto pattern = binarize_image(image, 64, 64, 127);
-    assert(pattern.size() == 64 * 64);
+  for (std::size_t i{0}; i != failed; ++i) {
+    patterns_.push_back(std::move(patterns[i]));
+    names_.push_back(std::move(names[i]));
+  }
 
-    pattern.save_to_file(patterns_directory_, name, 64 * 64);
-    patterns_.push_back(pattern);
+  if (exception != nullptr) {
+    // The images after the failed one may have been written before the
+    // failure was known, and the failed one partly written: their files are
+    // removed, so that the written files are the ones of patterns_ whatever
+    // the scheduling
+    for (auto i{failed}; i != files.size(); ++i) {
+      std::error_code error;
+      std::filesystem::remove(patterns_directory_ / names[i], error);
+      std::filesystem::remove(
+          binarized_directory_
+              / std::filesystem::path{names[i]}.replace_extension(".png"),
+          error);
+    }
+    std::rethrow_exception(exception);
   }
 }
 
+void Acquisition::acquire_and_save_patterns()
+{
+  Thread_Pool pool{1};
+  acquire_and_save_patterns(pool, 1);
+}
+
 void Acquisition::save_binarized_images() const
 {
-  for (auto const& file :
-       std::filesystem::directory_iterator(patterns_directory_)) {
-    assert(file.is_regular_file());
-    assert(file.path().extension() == ".txt");
+  assert(names_.size() == patterns_.size());
 
-    Pattern pattern;
-    pattern.load_from_file(patterns_directory_, file.path().filename(),
-                           64 * 64);
-    pattern.save_image(binarized_directory_, file.path().filename(), 64, 64);
+  for (std::size_t i{0}; i != patterns_.size(); ++i) {
+    patterns_[i].save_image(binarized_directory_, names_[i], dimensions_.width,
+                            dimensions_.height);
   }
 }
 
-} // namespace nn
+} // namespace nn
\ No newline at end of file
@@ -0,0 +1,106 @@
+// All relative paths are relative to the "build/" directory
+
+// This path is the only one relative to "network.cpp"
+#include "../include/network.hpp"
+
+#include <cassert>
+
+namespace nn {
+
+Generic_Network::Generic_Network(Weight_Matrix const& weight_matrix,
+                                 Dimensions dimensions)
+    : weight_matrix_{weight_matrix}
+    , dimensions_{dimensions}
+    , local_fields_{}
+    , flipped_{}
+{
+  if (weight_matrix_.neurons() != dimensions_.neurons()
+      || weight_matrix_.size() != dimensions_.weights()) {
+    throw std::runtime_error(
+        "The weight matrix must be filled, with "
+        + std::to_string(dimensions_.neurons()) + " neurons.");
+  }
+
+  // At most every neuron flips in an update
+  flipped_.reserve(dimensions_.neurons());
+}
+
+Dimensions Generic_Network::dimensions() const
+{
+  return dimensions_;
+}
+
+std::vector<double>
+Generic_Network::local_fields(std::vector<int> const& state) const
+{
+  return hopfield_local_fields(state, weight_matrix_);
+}
+
+double Generic_Network::energy(std::vector<int> const& state) const
+{
+  return hopfield_energy(state, weight_matrix_);
+}
+
+void Generic_Network::local_fields(std::vector<int> const& state,
+                                   std::span<double> fields) const
+{
+  hopfield_local_fields(state, weight_matrix_, fields);
+}
+
+void Generic_Network::update_local_fields(
+    std::span<double> fields, std::vector<std::size_t> const& flipped,
+    std::vector<int> const& state) const
+{
+  assert(state.size() == dimensions_.neurons());
+  assert(fields.size() == dimensions_.neurons());
+
+  // Same accumulations as the free update_local_fields()
+  for (auto j : flipped) {
+    assert(j >= 1 && j <= state.size());
+    weight_matrix_.accumulate_row(j, 2. * state[j - 1], fields);
+  }
+}
+
+std::size_t Generic_Network::update_dynamics(std::vector<int>& state,
+                                             std::size_t max_iterations)
+{
+  assert(state.size() == dimensions_.neurons());
+
+  local_fields_.resize(state.size());
+  local_fields(state, local_fields_);
+
+  std::size_t iteration{0};
+  while (iteration != max_iterations) {
+    ++iteration;
+
+    flipped_.clear();
+    for (std::size_t i{1}; i <= state.size(); ++i) {
+      auto new_value = sign(local_fields_[i - 1]);
+      if (new_value != state[i - 1]) {
+        state[i - 1] = new_value;
+        flipped_.push_back(i);
+      }
+    }
+    if (flipped_.empty()) {
+      break;
+    }
+
+    update_local_fields(local_fields_, flipped_, state);
+  }
+
+  return iteration;
+}
+
+std::unique_ptr<Network_Base> make_network(Weight_Matrix const& weight_matrix,
+                                           Dimensions dimensions)
+{
+  if (dimensions == Dimensions{64, 64}
+      && weight_matrix.storage() == Weight_Storage::real
+      && weight_matrix.layout() == Weight_Layout::packed) {
+    return std::make_unique<Network<64, 64>>(weight_matrix);
+  }
+
+  return std::make_unique<Generic_Network>(weight_matrix, dimensions);
+}
+
+} // namespace nn
\ No newline at end of file
@@ -0,0 +1,241 @@
+// All relative paths are relative to the "build/" directory
+
+// These two paths are the only ones relative to "observer.cpp"
+#include "../include/observer.hpp"
+#include "../include/pattern.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+
+namespace nn {
+
+void Null_Observer::on_start(std::vector<int> const&, double, double)
+{}
+
+void Null_Observer::on_iteration(std::size_t, std::vector<int> const&, double)
+{}
+
+void Null_Observer::on_finish(std::size_t, std::vector<int> const&, double,
+                              double)
+{}
+
+Console_Observer::Console_Observer(std::ostream& os)
+    : os_{os}
+{}
+
+Console_Observer::Console_Observer()
+    : Console_Observer::Console_Observer(std::cout)
+{}
+
+void Console_Observer::on_start(std::vector<int> const&, double energy,
+                                double original_energy)
+{
+  os_ << "Original pattern's energy: " << original_energy << '\n';
+  os_ << "Initial energy: " << energy << '\n';
+}
+
+void Console_Observer::on_iteration(std::size_t iteration,
+                                    std::vector<int> const&, double energy)
+{
+  os_ << "Iteration " << iteration << ". Current energy: " << energy << '\n';
+}
+
+void Console_Observer::on_finish(std::size_t, std::vector<int> const&, double,
+                                 double overlap)
+{
+  os_ << "Overlap with the original pattern: " << overlap << '\n';
+  if (overlap == 1.) {
+    os_ << "The original pattern has been restored." << '\n';
+  } else {
+    os_ << "The original pattern has not been restored." << '\n';
+  }
+}
+
+Window_Observer::Window_Observer(unsigned int width, unsigned int height,
+                                 float scale)
+    : width_{width}
+    , height_{height}
+    , scale_{scale}
+{
+  assert(scale_ > 0.f);
+}
+
+void Window_Observer::draw_()
+{
+  sf::Sprite starting_sprite(starting_texture_);
+  starting_sprite.setScale(scale_, scale_);
+  starting_sprite.setPosition(0, 0);
+
+  sf::Sprite current_sprite(current_texture_);
+  current_sprite.setScale(scale_, scale_);
+  current_sprite.setPosition(static_cast<float>(width_) * scale_, 0);
+
+  window_.clear();
+  window_.draw(starting_sprite);
+  window_.draw(current_sprite);
+  window_.display();
+}
+
+void Window_Observer::on_start(std::vector<int> const& state, double, double)
+{
+  assert(state.size() == width_ * height_);
+
+  // The scale may be fractional: the window fits the two scaled sprites
+  auto window_width  = std::lround(2.f * static_cast<float>(width_) * scale_);
+  auto window_height = std::lround(static_cast<float>(height_) * scale_);
+  window_.create(sf::VideoMode(static_cast<unsigned int>(window_width),
+                               static_cast<unsigned int>(window_height)),
+                 "Network update dynamics");
+
+  starting_image_ = create_image(width_, height_, state);
+  current_image_  = starting_image_;
+
+  starting_texture_.loadFromImage(starting_image_);
+  current_texture_.loadFromImage(current_image_);
+
+  draw_();
+}
+
+void Window_Observer::on_iteration(std::size_t, std::vector<int> const& state,
+                                   double)
+{
+  assert(state.size() == width_ * height_);
+
+  // The image is overwritten in place instead of being created again
+  for (unsigned int y{0}; y < height_; ++y) {
+    for (unsigned int x{0}; x < width_; ++x) {
+      current_image_.setPixel(
+          x, y, compute_color(state[std::size_t{y} * width_ + x]));
+    }
+  }
+  current_texture_.update(current_image_);
+
+  draw_();
+}
+
+void Window_Observer::on_finish(std::size_t, std::vector<int> const&, double,
+                                double)
+{}
+
+File_Observer::File_Observer(std::filesystem::path const& path)
+    : path_{path}
+    , outfile_{path}
+{
+  if (!outfile_) {
+    throw std::runtime_error("File \"" + path_.string()
+                             + "\" not created successfully.");
+  }
+}
+
+void File_Observer::record_(std::size_t iteration,
+                            std::vector<int> const& state, double energy)
+{
+  outfile_ << iteration << ' ' << energy;
+  for (auto value : state) {
+    assert(value == +1 || value == -1);
+    outfile_ << ' ' << value;
+  }
+  outfile_ << '\n';
+
+  if (!outfile_) {
+    throw std::runtime_error("File \"" + path_.string()
+                             + "\" not written successfully.");
+  }
+}
+
+void File_Observer::on_start(std::vector<int> const& state, double energy,
+                             double)
+{
+  record_(0, state, energy);
+}
+
+void File_Observer::on_iteration(std::size_t iteration,
+                                 std::vector<int> const& state, double energy)
+{
+  record_(iteration, state, energy);
+}
+
+void File_Observer::on_finish(std::size_t, std::vector<int> const&, double,
+                              double)
+{
+  outfile_.flush();
+}
+
+Pattern_File_Observer::Pattern_File_Observer(
+    std::filesystem::path const& directory, std::filesystem::path const& name,
+    Dimensions dimensions)
+    : directory_{directory}
+    , name_{name.filename()}
+    , dimensions_{dimensions}
+{
+  if (!std::filesystem::is_directory(directory_)) {
+    throw std::runtime_error("Path \"" + directory_.string()
+                             + "\" is not a directory.");
+  }
+}
+
+void Pattern_File_Observer::save_(std::vector<int> const& state,
+                                  std::filesystem::path const& extension) const
+{
+  assert(state.size() == dimensions_.neurons());
+
+  auto name = name_;
+  name.replace_extension(extension);
+  Pattern pattern{state};
+  pattern.save_to_file(directory_, name, dimensions_);
+  pattern.save_image(directory_, name, dimensions_.width, dimensions_.height);
+}
+
+void Pattern_File_Observer::on_start(std::vector<int> const& state, double,
+                                     double)
+{
+  save_(state, ".corrupted.txt");
+}
+
+void Pattern_File_Observer::on_iteration(std::size_t, std::vector<int> const&,
+                                         double)
+{}
+
+void Pattern_File_Observer::on_finish(std::size_t,
+                                      std::vector<int> const& state, double,
+                                      double)
+{
+  save_(state, ".restored.txt");
+}
+
+Observer_List::Observer_List(std::vector<Observer*> const& observers)
+    : observers_{observers}
+{
+  assert(std::all_of(observers_.begin(), observers_.end(),
+                     [](Observer* observer) { return observer != nullptr; }));
+}
+
+void Observer_List::on_start(std::vector<int> const& state, double energy,
+                             double original_energy)
+{
+  for (auto observer : observers_) {
+    observer->on_start(state, energy, original_energy);
+  }
+}
+
+void Observer_List::on_iteration(std::size_t iteration,
+                                 std::vector<int> const& state, double energy)
+{
+  for (auto observer : observers_) {
+    observer->on_iteration(iteration, state, energy);
+  }
+}
+
+void Observer_List::on_finish(std::size_t iteration,
+                              std::vector<int> const& state, double energy,
+                              double overlap)
+{
+  for (auto observer : observers_) {
+    observer->on_finish(iteration, state, energy, overlap);
+  }
+}
+
+} // namespace nn
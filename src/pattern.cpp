@@ -3,15 +3,63 @@
 // This path is the only one relative to "pattern.cpp"
 #include "../include/pattern.hpp"
 
-#include <algorithm>
+#include <bit>
 #include <cassert>
 #include <fstream>
+#include <functional>
+#include <numeric>
+#include <optional>
 #include <random>
 #include <stdexcept>
 #include <string>
 
 namespace nn {
 
+namespace {
+
+// Reads the header line "# <width> <height>" if infile starts with one
+std::optional<Dimensions> read_header(std::ifstream& infile,
+                                      std::filesystem::path const& path)
+{
+  if (!(infile >> std::ws) || infile.peek() != '#') {
+    return std::nullopt;
+  }
+
+  infile.get();
+  Dimensions dimensions;
+  if (!(infile >> dimensions.width >> dimensions.height)) {
+    throw std::runtime_error("Error in file \"" + path.string()
+                             + "\".\nInvalid header.");
+  }
+
+  return dimensions;
+}
+
+} // namespace
+
+Dimensions read_pattern_dimensions(std::filesystem::path const& path)
+{
+  std::ifstream infile{path};
+
+  if (!infile) {
+    throw std::runtime_error("File \"" + path.string()
+                             + "\" not opened successfully.");
+  }
+
+  if (auto dimensions = read_header(infile, path)) {
+    return *dimensions;
+  }
+
+  infile.clear();
+  std::size_t entries{0};
+  int value;
+  while (infile >> value) {
+    ++entries;
+  }
+
+  return square_dimensions(entries);
+}
+
 sf::Color compute_color(int value)
 {
   assert(value == +1 || value == -1);
@@ -28,7 +76,7 @@ sf::Image create_image(unsigned int width, unsigned int height,
 
   for (unsigned int y{0}; y < height; ++y) {
     for (unsigned int x{0}; x < width; ++x) {
-      auto color = compute_color(pattern[y * width + x]);
+      auto color = compute_color(pattern[std::size_t{y} * width + x]);
       image.setPixel(x, y, color);
     }
   }
@@ -39,30 +87,111 @@ sf::Image create_image(unsigned int width, unsigned int height,
   return image;
 }
 
-Pattern::Pattern(std::vector<int> pattern)
-    : pattern_{pattern}
+std::size_t flip_count(std::vector<std::uint64_t> const& first,
+                       std::vector<std::uint64_t> const& second)
 {
-  assert(pattern_.size() == pattern.size());
+  assert(first.size() == second.size());
+
+  return std::transform_reduce(
+      first.begin(), first.end(), second.begin(), std::size_t{0},
+      std::plus<>{}, [](std::uint64_t a, std::uint64_t b) {
+        return static_cast<std::size_t>(std::popcount(a ^ b));
+      });
+}
+
+Pattern::Pattern(std::vector<int> const& pattern)
+    : words_{}
+    , size_{0}
+{
+  words_.reserve((pattern.size() + 63) / 64);
+  for (auto value : pattern) {
+    add(value);
+  }
+
+  assert(size_ == pattern.size());
+  assert(words_.size() == (size_ + 63) / 64);
 }
 
 Pattern::Pattern()
     : Pattern::Pattern(std::vector<int>{})
 {}
 
-const std::vector<int>& Pattern::pattern() const
+std::vector<int> Pattern::pattern() const
 {
-  return pattern_;
+  std::vector<int> pattern(size_);
+  for (std::size_t k{0}; k != size_; ++k) {
+    pattern[k] = at(k);
+  }
+
+  return pattern;
+}
+
+const std::vector<std::uint64_t>& Pattern::words() const
+{
+  return words_;
 }
 
 std::size_t Pattern::size() const
 {
-  return pattern_.size();
+  return size_;
+}
+
+int Pattern::at(std::size_t index) const
+{
+  assert(index < size_);
+  return (words_[index / 64] >> (index % 64)) & 1 ? +1 : -1;
+}
+
+void Pattern::set(std::size_t index, int value)
+{
+  assert(index < size_);
+  assert(value == +1 || value == -1);
+
+  auto mask = std::uint64_t{1} << (index % 64);
+  if (value == +1) {
+    words_[index / 64] |= mask;
+  } else {
+    words_[index / 64] &= ~mask;
+  }
+
+  assert(at(index) == value);
 }
 
 void Pattern::add(int value)
 {
   assert(value == +1 || value == -1);
-  pattern_.push_back(value);
+
+  if (size_ % 64 == 0) {
+    words_.push_back(0);
+  }
+  ++size_;
+  set(size_ - 1, value);
+
+  assert(words_.size() == (size_ + 63) / 64);
+}
+
+double Pattern::overlap(Pattern const& other) const
+{
+  assert(size_ == other.size_);
+  assert(size_ != 0);
+
+  auto differences = static_cast<double>(hamming_distance(other));
+  auto overlap     = (static_cast<double>(size_) - 2. * differences)
+                 / static_cast<double>(size_);
+
+  assert(overlap >= -1. && overlap <= +1.);
+
+  return overlap;
+}
+
+std::size_t Pattern::hamming_distance(Pattern const& other) const
+{
+  assert(size_ == other.size_);
+
+  auto distance = flip_count(words_, other.words_);
+  assert(distance <= size_);
+
+  return distance;
 }
 
 void Pattern::save_to_file(std::filesystem::path const& patterns_directory,
@@ -84,11 +213,10 @@ void Pattern::save_to_file(std::filesystem::path const& patterns_directory,
 
   assert(std::filesystem::is_regular_file(path));
 
-  assert(pattern_.size() == size);
+  assert(size_ == size);
 
-  for (auto value : pattern_) {
-    assert(value == +1 || value == -1);
-    if (!(outfile << value << ' ')) {
+  for (std::size_t k{0}; k != size_; ++k) {
+    if (!(outfile << at(k) << ' ')) {
       throw std::runtime_error("File \"" + path.string()
                                + "\" not written successfully.");
     }
@@ -105,11 +233,48 @@ void Pattern::save_to_file(std::filesystem::path const& patterns_directory,
   }
 }
 
+void Pattern::save_to_file(std::filesystem::path const& patterns_directory,
+                           std::filesystem::path const& name,
+                           Dimensions dimensions) const
+{
+  assert(std::filesystem::is_directory(patterns_directory));
+
+  auto path = patterns_directory;
+  path.replace_filename(name);
+  assert(path.extension() == ".txt");
+
+  assert(size_ == dimensions.neurons());
+
+  std::ofstream outfile{path};
+
+  if (!outfile) {
+    throw std::runtime_error("File \"" + path.string()
+                             + "\" not created successfully.");
+  }
+
+  if (!(outfile << "# " << dimensions.width << ' ' << dimensions.height
+                << '\n')) {
+    throw std::runtime_error("File \"" + path.string()
+                             + "\" not written successfully.");
+  }
+  for (std::size_t k{0}; k != size_; ++k) {
+    if (!(outfile << at(k) << ' ')) {
+      throw std::runtime_error("File \"" + path.string()
+                               + "\" not written successfully.");
+    }
+  }
+
+  outfile.close();
+
+  assert(!std::filesystem::is_empty(path));
+}
+
 void Pattern::load_from_file(std::filesystem::path const& patterns_directory,
                              std::filesystem::path const& name,
                              std::size_t size)
 {
-  pattern_.clear();
+  words_.clear();
+  size_ = 0;
 
   assert(std::filesystem::is_directory(patterns_directory));
 
@@ -131,23 +296,33 @@ void Pattern::load_from_file(std::filesystem::path const& patterns_directory,
                              + "\" not opened successfully.");
   }
 
+  auto dimensions = read_header(infile, path);
+  if (dimensions && dimensions->neurons() != size) {
+    throw std::runtime_error(
+        "Error in file \"" + path.string() + "\".\nNumber of neurons must be: "
+        + std::to_string(size) + "\nActual dimensions: "
+        + std::to_string(dimensions->width) + "x"
+        + std::to_string(dimensions->height));
+  }
+  infile.clear();
+
   int value;
   while (infile >> value) {
     if (value != +1 && value != -1) {
       throw std::runtime_error("Error in file \"" + path.string()
                                + "\".\nEntries must be +1 or -1.");
     }
-    pattern_.push_back(value);
+    add(value);
   }
 
-  if (pattern_.size() != size) {
+  if (size_ != size) {
     throw std::runtime_error(
         "Error in file \"" + path.string()
         + "\".\nNumber of entries must be: " + std::to_string(size)
-        + "\nActual number of entries: " + std::to_string(pattern_.size()));
+        + "\nActual number of entries: " + std::to_string(size_));
   }
 
-  assert(pattern_.size() == size);
+  assert(size_ == size);
 }
 
 void Pattern::save_image(std::filesystem::path const& binarized_directory,
@@ -161,9 +336,9 @@ void Pattern::save_image(std::filesystem::path const& binarized_directory,
   assert(path.extension() == ".txt");
   path.replace_extension(".png");
 
-  assert(pattern_.size() == width * height);
+  assert(size_ == width * height);
 
-  auto image = create_image(width, height, pattern_);
+  auto image = create_image(width, height, pattern());
 
   if (!image.saveToFile(path)) {
     throw std::runtime_error("Image \"" + path.string()
@@ -180,22 +355,27 @@ void Pattern::save_image(std::filesystem::path const& binarized_directory,
 
 void Pattern::add_noise(double probability, std::size_t size)
 {
-  assert(pattern_.size() == size);
-  assert(std::all_of(pattern_.begin(), pattern_.end(),
-                     [](int value) { return value == +1 || value == -1; }));
+  std::random_device r;
+  add_noise(probability, size, r());
+}
+
+void Pattern::add_noise(double probability, std::size_t size,
+                        unsigned int seed)
+{
+  assert(size_ == size);
 
   assert(probability >= 0 && probability <= 1);
 
-  std::random_device r;
-  std::default_random_engine eng{r()};
+  std::default_random_engine eng{seed};
   std::bernoulli_distribution dist{probability};
 
-  std::transform(pattern_.begin(), pattern_.end(), pattern_.begin(),
-                 [&](int value) { return (dist(eng)) ? -1 * value : value; });
+  for (std::size_t k{0}; k != size_; ++k) {
+    if (dist(eng)) {
+      words_[k / 64] ^= std::uint64_t{1} << (k % 64);
+    }
+  }
 
-  assert(pattern_.size() == size);
-  assert(std::all_of(pattern_.begin(), pattern_.end(),
-                     [](int value) { return value == +1 || value == -1; }));
+  assert(size_ == size);
   (void)size; // Prevent unused parameter warning
 }
 
@@ -203,9 +383,7 @@ void Pattern::cut(int new_value, unsigned int from_row, unsigned int to_row,
                   unsigned int from_column, unsigned int to_column,
                   unsigned int width, unsigned int height)
 {
-  assert(pattern_.size() == width * height);
-  assert(std::all_of(pattern_.begin(), pattern_.end(),
-                     [](int value) { return value == +1 || value == -1; }));
+  assert(size_ == width * height);
 
   assert(new_value == +1 || new_value == -1);
   assert(from_row <= to_row && to_row <= height);
@@ -213,13 +391,11 @@ void Pattern::cut(int new_value, unsigned int from_row, unsigned int to_row,
 
   for (unsigned int y{from_row - 1}; y != to_row; ++y) {
     for (unsigned int x{from_column - 1}; x != to_column; ++x) {
-      pattern_[y * width + x] = new_value;
+      set(std::size_t{y} * width + x, new_value);
     }
   }
 
-  assert(pattern_.size() == width * height);
-  assert(std::all_of(pattern_.begin(), pattern_.end(),
-                     [](int value) { return value == +1 || value == -1; }));
+  assert(size_ == width * height);
   (void)height; // Prevent unused parameter warning
 }
 
@@ -0,0 +1,292 @@
+// All relative paths are relative to the "build/" directory
+
+// These two paths are the only ones relative to "pattern_memory.cpp"
+#include "../include/pattern_memory.hpp"
+#include "../include/binary_format.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace nn {
+
+namespace {
+
+constexpr char binary_magic[8]{'H', 'N', 'N', '-', 'P', 'M', '\0', '\0'};
+constexpr std::uint32_t binary_version{1};
+constexpr char binary_kind[]{"binary pattern memory"};
+
+} // namespace
+
+Dimensions read_pattern_memory_dimensions(std::filesystem::path const& path)
+{
+  auto header = read_binary_header<Pattern_Memory_Header>(path, binary_magic,
+                                                          binary_kind);
+
+  return binary_header_dimensions(header, path);
+}
+
+Pattern_Memory::Pattern_Memory(std::size_t neurons)
+    : neurons_{neurons}
+    , words_per_pattern_{(neurons + 63) / 64}
+    , words_{}
+{
+  assert(neurons_ == neurons);
+  assert(size() == 0);
+}
+
+Pattern_Memory::Pattern_Memory()
+    : Pattern_Memory::Pattern_Memory(default_dimensions.neurons())
+{}
+
+std::size_t Pattern_Memory::neurons() const
+{
+  return neurons_;
+}
+
+std::size_t Pattern_Memory::size() const
+{
+  return words_per_pattern_ == 0 ? 0 : words_.size() / words_per_pattern_;
+}
+
+std::span<const std::uint64_t> Pattern_Memory::words(std::size_t mu) const
+{
+  assert(mu < size());
+
+  return std::span<const std::uint64_t>{words_}.subspan(
+      mu * words_per_pattern_, words_per_pattern_);
+}
+
+double Pattern_Memory::at(std::size_t i, std::size_t j) const
+{
+  assert(i >= 1 && i <= neurons_);
+  assert(j >= 1 && j <= neurons_);
+
+  if (i == j) {
+    return 0.;
+  }
+
+  // p_i * p_j is +1 when the two bits are equal
+  int sum_ij{0};
+  for (std::size_t mu{0}; mu != size(); ++mu) {
+    auto pattern = words(mu);
+    auto bit_i   = (pattern[(i - 1) / 64] >> ((i - 1) % 64)) & 1u;
+    auto bit_j   = (pattern[(j - 1) / 64] >> ((j - 1) % 64)) & 1u;
+    sum_ij += (bit_i == bit_j) ? +1 : -1;
+  }
+
+  return static_cast<double>(sum_ij) / static_cast<double>(neurons_);
+}
+
+std::vector<std::int64_t> Pattern_Memory::overlaps(Pattern const& state) const
+{
+  assert(state.size() == neurons_);
+  assert(state.words().size() == words_per_pattern_);
+
+  // Unused bits are cleared in both operands and never counted as different
+  std::vector<std::int64_t> overlaps(size());
+  for (std::size_t mu{0}; mu != size(); ++mu) {
+    auto pattern = words(mu);
+    std::int64_t different{0};
+    for (std::size_t w{0}; w != words_per_pattern_; ++w) {
+      different += std::popcount(pattern[w] ^ state.words()[w]);
+    }
+    overlaps[mu] = static_cast<std::int64_t>(neurons_) - 2 * different;
+  }
+
+  return overlaps;
+}
+
+void Pattern_Memory::accumulate_pattern(std::size_t mu, double factor,
+                                        std::span<double> target) const
+{
+  assert(mu < size());
+  assert(target.size() == neurons_);
+
+  auto pattern = words(mu);
+  for (std::size_t j{0}; j != neurons_; ++j) {
+    target[j] += ((pattern[j / 64] >> (j % 64)) & 1u) ? factor : -factor;
+  }
+}
+
+void Pattern_Memory::accumulate_row(std::size_t i, double factor,
+                                    std::span<double> target) const
+{
+  assert(i >= 1 && i <= neurons_);
+  assert(target.size() == neurons_);
+
+  auto scale = factor / static_cast<double>(neurons_);
+  for (std::size_t mu{0}; mu != size(); ++mu) {
+    auto bit_i = (words(mu)[(i - 1) / 64] >> ((i - 1) % 64)) & 1u;
+    accumulate_pattern(mu, bit_i ? scale : -scale, target);
+  }
+
+  // The sum over the patterns also includes the null diagonal w_ii = P / N
+  target[i - 1] -= static_cast<double>(size()) * scale;
+}
+
+void Pattern_Memory::fill(std::vector<std::vector<int>> const& patterns,
+                          std::size_t neurons)
+{
+  assert(std::all_of(
+      patterns.begin(), patterns.end(),
+      [this](std::vector<int> const& pattern) {
+        return (pattern.size() == neurons_
+                && std::all_of(pattern.begin(), pattern.end(), [](int value) {
+                     return value == +1 || value == -1;
+                   }));
+      }));
+
+  assert(neurons_ == neurons);
+  (void)neurons; // Prevent unused parameter warning
+
+  words_.clear();
+  words_.reserve(patterns.size() * words_per_pattern_);
+  for (auto const& pattern : patterns) {
+    Pattern packed{pattern};
+    assert(packed.words().size() == words_per_pattern_);
+    words_.insert(words_.end(), packed.words().begin(), packed.words().end());
+  }
+
+  assert(size() == patterns.size() || neurons_ == 0);
+}
+
+void Pattern_Memory::save_(std::filesystem::path const& path,
+                           Dimensions dimensions) const
+{
+  assert(path.extension() == ".bin");
+  assert(dimensions.neurons() == neurons_ || dimensions.neurons() == 0);
+
+  Pattern_Memory_Header header{};
+  std::memcpy(header.magic, binary_magic, sizeof(header.magic));
+  header.version  = binary_version;
+  header.neurons  = neurons_;
+  header.patterns = size();
+  header.words    = words_per_pattern_;
+  header.checksum = fnv1a_checksum<std::uint64_t>(words_);
+  header.width    = dimensions.width;
+  header.height   = dimensions.height;
+
+  std::ofstream outfile{path, std::ios::binary};
+
+  if (!outfile) {
+    throw std::runtime_error("File \"" + path.string()
+                             + "\" not created successfully.");
+  }
+
+  if (!outfile.write(reinterpret_cast<const char*>(&header), sizeof(header))
+      || !outfile.write(reinterpret_cast<const char*>(words_.data()),
+                        static_cast<std::streamsize>(
+                            words_.size() * sizeof(std::uint64_t)))) {
+    throw std::runtime_error("File \"" + path.string()
+                             + "\" not written successfully.");
+  }
+
+  outfile.close();
+
+  assert(std::filesystem::file_size(path)
+         == sizeof(header) + words_.size() * sizeof(std::uint64_t));
+}
+
+void Pattern_Memory::save_to_file(
+    std::filesystem::path const& memory_directory,
+    std::filesystem::path const& name, std::size_t neurons) const
+{
+  assert(std::filesystem::is_directory(memory_directory));
+
+  auto path = memory_directory;
+  path.replace_filename(name);
+
+  assert(neurons_ == neurons);
+  (void)neurons; // Prevent unused parameter warning
+
+  save_(path, Dimensions{0, 0});
+}
+
+void Pattern_Memory::save_to_file(
+    std::filesystem::path const& memory_directory,
+    std::filesystem::path const& name, Dimensions dimensions) const
+{
+  assert(std::filesystem::is_directory(memory_directory));
+
+  auto path = memory_directory;
+  path.replace_filename(name);
+
+  assert(neurons_ == dimensions.neurons());
+
+  save_(path, dimensions);
+}
+
+void Pattern_Memory::load_from_file(
+    std::filesystem::path const& memory_directory,
+    std::filesystem::path const& name, std::size_t neurons)
+{
+  assert(std::filesystem::is_directory(memory_directory));
+
+  auto path = memory_directory;
+  path.replace_filename(name);
+
+  assert(neurons_ == neurons);
+  (void)neurons; // Prevent unused parameter warning
+
+  std::ifstream infile{path, std::ios::binary};
+
+  if (!infile) {
+    throw std::runtime_error("File \"" + path.string()
+                             + "\" not opened successfully.");
+  }
+
+  auto error = [&path](std::string const& message) {
+    return std::runtime_error("Error in file \"" + path.string() + "\".\n"
+                              + message);
+  };
+
+  Pattern_Memory_Header header;
+  if (!infile.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+    throw error("Missing binary header.");
+  }
+
+  check_binary_header(header, binary_magic, binary_version, binary_kind,
+                      error);
+  if (header.neurons != neurons_ || header.words != words_per_pattern_) {
+    throw error("Number of neurons must be: " + std::to_string(neurons_)
+                + "\nActual number of neurons: "
+                + std::to_string(header.neurons));
+  }
+  auto words_bytes = header.patterns * header.words * sizeof(std::uint64_t);
+  if (std::filesystem::file_size(path) != sizeof(header) + words_bytes) {
+    throw error("File size does not match the number of patterns.");
+  }
+
+  std::vector<std::uint64_t> words(header.patterns * header.words);
+  if (!infile.read(reinterpret_cast<char*>(words.data()),
+                   static_cast<std::streamsize>(words.size()
+                                                * sizeof(std::uint64_t)))) {
+    throw error("File not read successfully.");
+  }
+
+  if (fnv1a_checksum<std::uint64_t>(words) != header.checksum) {
+    throw error("Checksum mismatch.");
+  }
+
+  if (neurons_ % 64 != 0) {
+    auto unused = ~std::uint64_t{0} << (neurons_ % 64);
+    for (std::size_t w{words_per_pattern_ - 1}; w < words.size();
+         w += words_per_pattern_) {
+      if ((words[w] & unused) != 0) {
+        throw error("Unused bits of the patterns must be cleared.");
+      }
+    }
+  }
+
+  words_ = std::move(words);
+
+  assert(size() == header.patterns || neurons_ == 0);
+}
+
+} // namespace nn
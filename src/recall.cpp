@@ -1,18 +1,49 @@
 // All relative paths are relative to the "build/" directory
 
-// This path is the only one relative to "recall.cpp"
+// These two paths are the only ones relative to "recall.cpp"
+#include "../include/network.hpp"
 #include "../include/recall.hpp"
 
-#include <SFML/Graphics.hpp>
 #include <algorithm>
+#include <bit>
 #include <cassert>
-#include <iostream>
+#include <cmath>
+#include <cstdint>
+#include <limits>
 #include <numeric>
 #include <stdexcept>
 #include <string>
+#include <utility>
 
 namespace nn {
 
+namespace {
+
+// Zobrist key of the i-th neuron: the SplitMix64 finalizer of i, a fixed
+// pseudo-random 64-bit value
+std::uint64_t state_key(std::size_t i)
+{
+  std::uint64_t z{i * 0x9e3779b97f4a7c15ull};
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31);
+}
+
+// Whether the energy kept from the flips is the recomputed one: exactly when
+// N is a power of two, all the weights and partial sums being exact doubles,
+// and up to the rounding of the updates otherwise
+[[maybe_unused]] bool same_energy(double kept, double computed,
+                                  std::size_t neurons)
+{
+  if (std::has_single_bit(neurons)) {
+    return kept == computed;
+  }
+  return std::abs(kept - computed)
+      <= 1e-9 * (std::abs(computed) + static_cast<double>(neurons));
+}
+
+} // namespace
+
 int sign(double value)
 {
   return (value >= 0) ? +1 : -1;
@@ -25,48 +56,187 @@ double hopfield_local_field(std::size_t index,
   assert(index >= 1 && index <= weight_matrix.neurons());
   assert(current_state.size() >= index);
 
-  std::size_t j{0};
-  auto local_field =
-      std::accumulate(current_state.begin(), current_state.end(), 0.,
-                      [index, &j, &weight_matrix](double sum, int value) {
-                        ++j;
-                        return sum + weight_matrix.at(index, j) * value;
-                      });
-
-  assert(j == current_state.size());
-
-  return local_field;
+  return weight_matrix.row_product(index, current_state);
 }
 
 std::vector<double> hopfield_local_fields(std::vector<int> const& current_state,
                                           Weight_Matrix const& weight_matrix)
 {
-  assert(weight_matrix.weights().size()
-         == weight_matrix.neurons() * (weight_matrix.neurons() - 1) / 2);
-  assert(current_state.size() == weight_matrix.neurons());
+  std::vector<double> local_fields(current_state.size());
+  hopfield_local_fields(current_state, weight_matrix, local_fields);
 
-  std::vector<double> local_fields;
-  std::size_t i{0};
-  std::generate_n(
-      std::back_inserter(local_fields), current_state.size(), [&]() {
-        ++i;
-        return hopfield_local_field(i, current_state, weight_matrix);
-      });
-
-  assert(i == current_state.size());
   assert(local_fields.size() == current_state.size());
 
   return local_fields;
 }
 
+void hopfield_local_fields(std::vector<int> const& current_state,
+                           Weight_Matrix const& weight_matrix,
+                           std::span<double> local_fields)
+{
+  assert(weight_matrix.size()
+         == weight_matrix.neurons() * (weight_matrix.neurons() - 1) / 2);
+  assert(current_state.size() == weight_matrix.neurons());
+  assert(local_fields.size() == current_state.size());
+
+  // Integer kernel: the local fields are the exact sums divided by N, equal to
+  // the ones of the double path when N is a power of two
+  if (weight_matrix.storage() == Weight_Storage::counts
+      && weight_matrix.neurons() <= max_count_products_neurons) {
+    auto N = weight_matrix.neurons();
+    std::vector<std::int16_t> values(N);
+    std::vector<std::int32_t> sums(N);
+    weight_matrix.count_products(current_state, values, sums);
+
+    std::transform(sums.begin(), sums.end(), local_fields.begin(),
+                   [N](std::int32_t sum) {
+                     return static_cast<double>(sum) / static_cast<double>(N);
+                   });
+    return;
+  }
+
+  // Every weight is read once and used for two local fields, with the same
+  // additions as in hopfield_local_field()
+  weight_matrix.multiply(current_state, local_fields);
+}
+
 double hopfield_energy(std::vector<int> const& current_state,
                        Weight_Matrix const& weight_matrix)
 {
-  assert(weight_matrix.weights().size()
+  std::vector<double> local_fields(current_state.size());
+  return hopfield_energy(current_state, weight_matrix, local_fields);
+}
+
+double hopfield_energy(std::vector<int> const& current_state,
+                       Weight_Matrix const& weight_matrix,
+                       std::span<double> local_fields)
+{
+  assert(weight_matrix.size()
+         == weight_matrix.neurons() * (weight_matrix.neurons() - 1) / 2);
+
+  hopfield_local_fields(current_state, weight_matrix, local_fields);
+
+  double energy;
+  energy = std::inner_product(current_state.begin(), current_state.end(),
+                              local_fields.begin(), 0.);
+  energy = -energy / 2;
+
+  return energy;
+}
+
+void update_local_fields(std::vector<double>& local_fields,
+                         std::vector<std::size_t> const& flipped,
+                         std::vector<int> const& new_state,
+                         Weight_Matrix const& weight_matrix)
+{
+  assert(local_fields.size() == weight_matrix.neurons());
+  assert(new_state.size() == weight_matrix.neurons());
+  assert(flipped.size() <= new_state.size());
+
+  for (auto j : flipped) {
+    assert(j >= 1 && j <= new_state.size());
+    assert(new_state[j - 1] == +1 || new_state[j - 1] == -1);
+    weight_matrix.accumulate_row(j, 2. * new_state[j - 1], local_fields);
+  }
+}
+
+void hopfield_local_fields(std::vector<int> const& states, std::size_t batch,
+                           Weight_Matrix const& weight_matrix,
+                           std::vector<double>& local_fields)
+{
+  auto N = weight_matrix.neurons();
+  assert(weight_matrix.size() == N * (N - 1) / 2);
+  assert(states.size() == N * batch);
+
+  local_fields.assign(N * batch, 0.);
+
+  // Contributions to h_i are added with increasing j, as in
+  // hopfield_local_field(), so the results are the same
+  if (weight_matrix.layout() == Weight_Layout::dense) {
+    for (std::size_t i{1}; i <= N; ++i) {
+      auto row_i = weight_matrix.row(i);
+      auto h_i   = &local_fields[(i - 1) * batch];
+      for (std::size_t j{1}; j <= N; ++j) {
+        if (j == i) {
+          continue;
+        }
+        auto w_ij = row_i[j - 1];
+        auto s_j  = &states[(j - 1) * batch];
+        for (std::size_t b{0}; b != batch; ++b) {
+          h_i[b] += w_ij * s_j[b];
+        }
+      }
+    }
+    return;
+  }
+
+  // Counts are summed exactly and divided by N at the end
+  weight_matrix.visit([&](auto weights, double divisor) {
+    std::size_t index{0};
+    for (std::size_t i{1}; i < N; ++i) {
+      auto s_i = &states[(i - 1) * batch];
+      auto h_i = &local_fields[(i - 1) * batch];
+      for (std::size_t j{i + 1}; j <= N; ++j, ++index) {
+        auto w_ij = static_cast<double>(weights[index]);
+        auto s_j  = &states[(j - 1) * batch];
+        auto h_j  = &local_fields[(j - 1) * batch];
+        for (std::size_t b{0}; b != batch; ++b) {
+          h_i[b] += w_ij * s_j[b];
+          h_j[b] += w_ij * s_i[b];
+        }
+      }
+    }
+    assert(index == weights.size());
+
+    if (divisor != 1.) {
+      for (auto& local_field : local_fields) {
+        local_field /= divisor;
+      }
+    }
+  });
+}
+
+std::vector<double> hopfield_local_fields(std::vector<int> const& current_state,
+                                          Weight_Matrix const& weight_matrix,
+                                          Thread_Pool& pool,
+                                          Partitioning partitioning)
+{
+  std::vector<double> local_fields(current_state.size());
+  hopfield_local_fields(current_state, weight_matrix, pool, partitioning,
+                        local_fields);
+
+  assert(local_fields.size() == current_state.size());
+
+  return local_fields;
+}
+
+void hopfield_local_fields(std::vector<int> const& current_state,
+                           Weight_Matrix const& weight_matrix,
+                           Thread_Pool& pool, Partitioning partitioning,
+                           std::span<double> local_fields)
+{
+  assert(weight_matrix.size()
          == weight_matrix.neurons() * (weight_matrix.neurons() - 1) / 2);
+  assert(current_state.size() == weight_matrix.neurons());
+  assert(local_fields.size() == current_state.size());
 
-  auto local_fields = hopfield_local_fields(current_state, weight_matrix);
+  pool.parallel_for(0, current_state.size(), partitioning,
+                    [&](std::size_t begin, std::size_t end) {
+                      for (auto i{begin}; i != end; ++i) {
+                        local_fields[i] = hopfield_local_field(
+                            i + 1, current_state, weight_matrix);
+                      }
+                    });
+}
 
+double hopfield_energy(std::vector<int> const& current_state,
+                       Weight_Matrix const& weight_matrix, Thread_Pool& pool,
+                       Partitioning partitioning)
+{
+  auto local_fields =
+      hopfield_local_fields(current_state, weight_matrix, pool, partitioning);
+
+  // The O(N) reduction is serial, in the same order as in hopfield_energy()
   double energy;
   energy = std::inner_product(current_state.begin(), current_state.end(),
                               local_fields.begin(), 0.);
@@ -75,6 +245,169 @@ double hopfield_energy(std::vector<int> const& current_state,
   return energy;
 }
 
+void update_local_fields(std::vector<double>& local_fields,
+                         std::vector<std::size_t> const& flipped,
+                         std::vector<int> const& new_state,
+                         Weight_Matrix const& weight_matrix, Thread_Pool& pool,
+                         Partitioning partitioning)
+{
+  assert(local_fields.size() == weight_matrix.neurons());
+  assert(new_state.size() == weight_matrix.neurons());
+
+  if (flipped.empty()) {
+    return;
+  }
+
+  // Each thread owns a range of local fields, which receive the flipped
+  // columns in the same order as in the serial version
+  pool.parallel_for(0, local_fields.size(), partitioning,
+                    [&](std::size_t begin, std::size_t end) {
+                      for (auto j : flipped) {
+                        assert(j >= 1 && j <= new_state.size());
+                        weight_matrix.accumulate_row(j, 2. * new_state[j - 1],
+                                                     local_fields, begin, end);
+                      }
+                    });
+}
+
+std::vector<double> hopfield_local_fields(std::vector<int> const& current_state,
+                                          Pattern_Memory const& pattern_memory)
+{
+  auto N = pattern_memory.neurons();
+  auto P = pattern_memory.size();
+  assert(current_state.size() == N);
+
+  auto overlaps = pattern_memory.overlaps(Pattern{current_state});
+  assert(overlaps.size() == P);
+
+  // h_i = (sum_mu p_i^mu * m_mu - P * s_i) / N, the last term removing the
+  // diagonal of the sum over the patterns
+  std::vector<double> local_fields(N, 0.);
+  for (std::size_t mu{0}; mu != P; ++mu) {
+    pattern_memory.accumulate_pattern(
+        mu, static_cast<double>(overlaps[mu]) / static_cast<double>(N),
+        local_fields);
+  }
+  for (std::size_t i{0}; i != N; ++i) {
+    local_fields[i] -= static_cast<double>(P) * current_state[i]
+                     / static_cast<double>(N);
+  }
+
+  return local_fields;
+}
+
+double hopfield_energy(std::vector<int> const& current_state,
+                       Pattern_Memory const& pattern_memory)
+{
+  auto N = static_cast<std::int64_t>(pattern_memory.neurons());
+  auto P = static_cast<std::int64_t>(pattern_memory.size());
+  assert(current_state.size() == pattern_memory.neurons());
+
+  // sum_i s_i * h_i = (sum_mu m_mu^2 - P * N) / N
+  auto overlaps = pattern_memory.overlaps(Pattern{current_state});
+  auto sum = std::accumulate(overlaps.begin(), overlaps.end(), std::int64_t{0},
+                             [](std::int64_t partial, std::int64_t overlap) {
+                               return partial + overlap * overlap;
+                             });
+
+  return -static_cast<double>(sum - P * N) / static_cast<double>(2 * N);
+}
+
+void update_local_fields(std::vector<double>& local_fields,
+                         std::vector<std::size_t> const& flipped,
+                         std::vector<int> const& new_state,
+                         Pattern_Memory const& pattern_memory)
+{
+  auto N = pattern_memory.neurons();
+  auto P = pattern_memory.size();
+  assert(local_fields.size() == N);
+  assert(new_state.size() == N);
+  assert(flipped.size() <= new_state.size());
+
+  // The flips change each overlap m_mu by 2 * sum_j p_j^mu * new_state_j
+  for (std::size_t mu{0}; mu != P; ++mu) {
+    auto words = pattern_memory.words(mu);
+    std::int64_t delta{0};
+    for (auto j : flipped) {
+      assert(j >= 1 && j <= N);
+      auto bit_j = (words[(j - 1) / 64] >> ((j - 1) % 64)) & 1u;
+      delta += bit_j ? 2 * new_state[j - 1] : -2 * new_state[j - 1];
+    }
+    if (delta != 0) {
+      pattern_memory.accumulate_pattern(
+          mu, static_cast<double>(delta) / static_cast<double>(N),
+          local_fields);
+    }
+  }
+
+  for (auto j : flipped) {
+    local_fields[j - 1] -= static_cast<double>(P) * 2 * new_state[j - 1]
+                         / static_cast<double>(N);
+  }
+}
+
+std::vector<std::size_t>
+batch_network_update_dynamics(std::vector<std::vector<int>>& states,
+                              Weight_Matrix const& weight_matrix,
+                              std::size_t max_iterations)
+{
+  auto N = weight_matrix.neurons();
+  assert(std::all_of(states.begin(), states.end(),
+                     [N](std::vector<int> const& state) {
+                       return state.size() == N;
+                     }));
+
+  std::vector<std::size_t> iterations(states.size(), 0);
+
+  // Indices in states of the states still evolving
+  std::vector<std::size_t> active(states.size());
+  std::iota(active.begin(), active.end(), std::size_t{0});
+
+  std::vector<int> batch_states;
+  std::vector<double> local_fields;
+
+  for (std::size_t iteration{1};
+       iteration <= max_iterations && !active.empty(); ++iteration) {
+    auto batch = active.size();
+
+    batch_states.resize(N * batch);
+    for (std::size_t b{0}; b != batch; ++b) {
+      auto const& state = states[active[b]];
+      for (std::size_t i{0}; i != N; ++i) {
+        batch_states[i * batch + b] = state[i];
+      }
+    }
+
+    hopfield_local_fields(batch_states, batch, weight_matrix, local_fields);
+
+    std::size_t still_active{0};
+    for (std::size_t b{0}; b != batch; ++b) {
+      auto& state = states[active[b]];
+      bool changed{false};
+      for (std::size_t i{0}; i != N; ++i) {
+        auto new_value = sign(local_fields[i * batch + b]);
+        if (new_value != state[i]) {
+          state[i] = new_value;
+          changed  = true;
+        }
+      }
+      iterations[active[b]] = iteration;
+      if (changed) {
+        active[still_active] = active[b];
+        ++still_active;
+      }
+    }
+    active.resize(still_active);
+  }
+
+  assert(std::all_of(iterations.begin(), iterations.end(),
+                     [max_iterations](std::size_t iteration) {
+                       return iteration <= max_iterations;
+                     }));
+
+  return iterations;
+}
+
 void Recall::validate_weight_matrix_directory_() const
 {
   if (!std::filesystem::exists(weight_matrix_directory_)) {
@@ -97,10 +430,15 @@ void Recall::validate_weight_matrix_directory_() const
                                + file.path().filename().string()
                                + "\" is not a regular file.");
     }
-    if (file.path().filename() != "weight_matrix.txt") {
+    if (file.path().filename() != "weight_matrix.bin"
+        && file.path().filename() != "weight_matrix.txt"
+        && file.path().filename() != "pattern_memory.bin"
+        && file.path().filename() != "weight_matrix.tiles") {
       throw std::runtime_error(
           "In directory \"" + weight_matrix_directory_.string()
-          + "\" there must be only the file \"weight_matrix.txt\".\nFile \""
+          + "\" there must be only the files \"weight_matrix.bin\", "
+            "\"weight_matrix.txt\", \"pattern_memory.bin\" and "
+            "\"weight_matrix.tiles\".\nFile \""
           + file.path().filename().string() + "\" was found.");
     }
   }
@@ -153,27 +491,112 @@ void Recall::configure_corrupted_directory_() const
   }
 }
 
+Dimensions Recall::acquire_dimensions_() const
+{
+  validate_weight_matrix_directory_();
+  validate_patterns_directory_();
+
+  if (backend_ == Recall_Backend::pattern_memory) {
+    return read_pattern_memory_dimensions(weight_matrix_directory_
+                                          / "pattern_memory.bin");
+  }
+  if (backend_ == Recall_Backend::tiled_weight_matrix) {
+    return read_tiled_weight_matrix_dimensions(weight_matrix_directory_
+                                               / "weight_matrix.tiles");
+  }
+  if (std::filesystem::exists(weight_matrix_directory_ / "weight_matrix.bin")) {
+    return read_weight_matrix_dimensions(weight_matrix_directory_
+                                         / "weight_matrix.bin");
+  }
+  return read_pattern_dimensions(
+      std::filesystem::directory_iterator(patterns_directory_)->path());
+}
+
 // base_directory can only be "" or "tests/"
-Recall::Recall(std::filesystem::path const& base_directory)
-    : weight_matrix_{}
+Recall::Recall(std::filesystem::path const& base_directory,
+               Recall_Backend backend)
+    : Recall::Recall(base_directory, backend, nullptr)
+{}
+
+Recall::Recall(std::filesystem::path const& base_directory,
+               Shared_Weight_Matrix weight_matrix)
+    : Recall::Recall(base_directory, Recall_Backend::weight_matrix,
+                     std::move(weight_matrix))
+{
+  assert(weight_matrix_ != nullptr);
+}
+
+Recall::Recall(std::filesystem::path const& base_directory,
+               Recall_Backend backend, Shared_Weight_Matrix weight_matrix)
+    : backend_{backend}
+    , weight_matrix_directory_{"../" + base_directory.string()
+                               + "weight_matrix/"}
+    , patterns_directory_{"../" + base_directory.string() + "patterns/"}
+    , corrupted_directory_{"../" + base_directory.string() + "corrupted_files/"}
+    , dimensions_{acquire_dimensions_()}
+    , weight_matrix_{std::move(weight_matrix)}
+    , pattern_memory_{dimensions_.neurons()}
+    , tiled_weight_matrix_{}
     , original_pattern_{}
     , noisy_pattern_{}
     , cut_pattern_{}
     , current_state_{}
     , current_iteration_{0}
-    , weight_matrix_directory_{"../" + base_directory.string()
-                               + "weight_matrix/"}
-    , patterns_directory_{"../" + base_directory.string() + "patterns/"}
-    , corrupted_directory_{"../" + base_directory.string() + "corrupted_files/"}
+    , local_fields_(dimensions_.neurons())
+    , local_fields_ready_{false}
+    , flipped_{}
+    , energy_{0.}
+    , flipped_fields_{}
+    , scratch_fields_(dimensions_.neurons())
+    , network_{}
+    , thread_pool_{nullptr}
+    , partitioning_{Partitioning::blocked}
+    , update_mode_{Update_Mode::synchronous}
+    , neuron_order_{Neuron_Order::fixed}
+    , engine_{}
+    , order_(dimensions_.neurons())
+    , max_iterations_{std::numeric_limits<std::size_t>::max()}
+    , max_duration_{std::chrono::steady_clock::duration::max()}
+    , state_hash_{0}
+    , recent_hashes_{}
 {
-  validate_weight_matrix_directory_();
-  validate_patterns_directory_();
   configure_corrupted_directory_();
 
-  weight_matrix_.load_from_file(weight_matrix_directory_, "weight_matrix.txt",
-                                4096);
-  assert(weight_matrix_.neurons() == 4096);
-  assert(weight_matrix_.weights().size() == 8'386'560);
+  auto neurons = dimensions_.neurons();
+  if (backend_ == Recall_Backend::pattern_memory) {
+    pattern_memory_.load_from_file(weight_matrix_directory_,
+                                   "pattern_memory.bin", neurons);
+    assert(pattern_memory_.neurons() == neurons);
+    weight_matrix_ = std::make_shared<Weight_Matrix>(neurons);
+  } else if (backend_ == Recall_Backend::tiled_weight_matrix) {
+    // The tile size is the one of the file
+    auto header = read_tiled_weight_matrix_header(weight_matrix_directory_
+                                                  / "weight_matrix.tiles");
+    tiled_weight_matrix_ = std::make_unique<Tiled_Weight_Matrix>(
+        neurons, default_tile_cache_bytes, std::max(header.tile_size, 1u));
+    tiled_weight_matrix_->load_from_file(weight_matrix_directory_,
+                                         "weight_matrix.tiles", neurons);
+    weight_matrix_ = std::make_shared<Weight_Matrix>(neurons);
+  } else if (weight_matrix_ != nullptr) {
+    if (weight_matrix_->neurons() != neurons
+        || weight_matrix_->size() != dimensions_.weights()) {
+      throw std::runtime_error(
+          "The weight matrix must be filled, with "
+          + std::to_string(neurons) + " neurons.\nActual number of neurons: "
+          + std::to_string(weight_matrix_->neurons()));
+    }
+  } else if (std::filesystem::exists(weight_matrix_directory_.string()
+                                     + "weight_matrix.bin")) {
+    // The binary format is mapped in place, the text format is only imported
+    // when the binary one is missing; either is loaded once per process
+    weight_matrix_ = load_shared_weight_matrix(
+        weight_matrix_directory_ / "weight_matrix.bin", neurons);
+  } else {
+    weight_matrix_ = load_shared_weight_matrix(
+        weight_matrix_directory_ / "weight_matrix.txt", neurons);
+  }
+  assert(backend_ != Recall_Backend::weight_matrix
+         || weight_matrix_->size() == dimensions_.weights());
 
   assert(original_pattern_.size() == 0);
 
@@ -183,8 +606,19 @@ Recall::Recall(std::filesystem::path const& base_directory)
   assert(current_state_.size() == 0);
   assert(current_iteration_ == 0);
 
+  reserve_buffers_();
+  if (backend_ == Recall_Backend::weight_matrix) {
+    network_ = make_network(*weight_matrix_, dimensions_);
+  }
+
   assert(std::filesystem::exists(weight_matrix_directory_.string()
-                                 + "weight_matrix.txt"));
+                                 + "weight_matrix.bin")
+         || std::filesystem::exists(weight_matrix_directory_.string()
+                                    + "weight_matrix.txt")
+         || std::filesystem::exists(weight_matrix_directory_.string()
+                                    + "pattern_memory.bin")
+         || std::filesystem::exists(weight_matrix_directory_.string()
+                                    + "weight_matrix.tiles"));
   assert(std::filesystem::is_directory(patterns_directory_)
          && !std::filesystem::is_empty(patterns_directory_));
   assert(std::filesystem::is_directory(corrupted_directory_)
@@ -195,11 +629,81 @@ Recall::Recall()
     : Recall::Recall("")
 {}
 
+Recall::Recall(Shared_Weight_Matrix weight_matrix, Dimensions dimensions)
+    : backend_{Recall_Backend::weight_matrix}
+    , weight_matrix_directory_{}
+    , patterns_directory_{}
+    , corrupted_directory_{}
+    , dimensions_{dimensions}
+    , weight_matrix_{std::move(weight_matrix)}
+    , pattern_memory_{dimensions_.neurons()}
+    , tiled_weight_matrix_{}
+    , original_pattern_{}
+    , noisy_pattern_{}
+    , cut_pattern_{}
+    , current_state_{}
+    , current_iteration_{0}
+    , local_fields_(dimensions_.neurons())
+    , local_fields_ready_{false}
+    , flipped_{}
+    , energy_{0.}
+    , flipped_fields_{}
+    , scratch_fields_(dimensions_.neurons())
+    , network_{}
+    , thread_pool_{nullptr}
+    , partitioning_{Partitioning::blocked}
+    , update_mode_{Update_Mode::synchronous}
+    , neuron_order_{Neuron_Order::fixed}
+    , engine_{}
+    , order_(dimensions_.neurons())
+    , max_iterations_{std::numeric_limits<std::size_t>::max()}
+    , max_duration_{std::chrono::steady_clock::duration::max()}
+    , state_hash_{0}
+    , recent_hashes_{}
+{
+  assert(weight_matrix_ != nullptr);
+  if (weight_matrix_->neurons() != dimensions_.neurons()
+      || weight_matrix_->size() != dimensions_.weights()) {
+    throw std::runtime_error(
+        "The weight matrix must be filled, with "
+        + std::to_string(dimensions_.neurons())
+        + " neurons.\nActual number of neurons: "
+        + std::to_string(weight_matrix_->neurons()));
+  }
+
+  reserve_buffers_();
+  if (backend_ == Recall_Backend::weight_matrix) {
+    network_ = make_network(*weight_matrix_, dimensions_);
+  }
+}
+
+Recall::~Recall() = default;
+
+Recall_Backend Recall::backend() const
+{
+  return backend_;
+}
+
+Dimensions Recall::dimensions() const
+{
+  return dimensions_;
+}
+
 const Weight_Matrix& Recall::weight_matrix() const
+{
+  return *weight_matrix_;
+}
+
+Shared_Weight_Matrix Recall::shared_weight_matrix() const
 {
   return weight_matrix_;
 }
 
+const Pattern_Memory& Recall::pattern_memory() const
+{
+  return pattern_memory_;
+}
+
 const Pattern& Recall::original_pattern() const
 {
   return original_pattern_;
@@ -225,10 +729,57 @@ std::size_t Recall::current_iteration() const
   return current_iteration_;
 }
 
+double Recall::current_energy() const
+{
+  assert(local_fields_ready_);
+  return energy_;
+}
+
+Update_Mode Recall::update_mode() const
+{
+  return update_mode_;
+}
+
+void Recall::set_update_mode(Update_Mode mode, Neuron_Order order,
+                             unsigned int seed)
+{
+  update_mode_  = mode;
+  neuron_order_ = order;
+  engine_.seed(seed);
+  std::iota(order_.begin(), order_.end(), std::size_t{1});
+}
+
+void Recall::set_budget(std::size_t max_iterations,
+                        std::chrono::steady_clock::duration max_duration)
+{
+  max_iterations_ = max_iterations;
+  max_duration_   = max_duration;
+}
+
+void Recall::set_thread_pool(Thread_Pool* pool, Partitioning partitioning)
+{
+  thread_pool_  = pool;
+  partitioning_ = partitioning;
+}
+
+void Recall::set_weight_layout(Weight_Layout layout)
+{
+  if (backend_ == Recall_Backend::weight_matrix
+      && weight_matrix_->layout() != layout) {
+    auto copy = std::make_shared<Weight_Matrix>(*weight_matrix_);
+    copy->set_layout(layout);
+    weight_matrix_ = std::move(copy);
+    network_       = make_network(*weight_matrix_, dimensions_);
+  }
+}
+
 void Recall::clear_state()
 {
   current_state_.clear();
-  current_iteration_ = 0;
+  current_iteration_  = 0;
+  local_fields_ready_ = false;
+  flipped_.clear();
+  flipped_fields_.clear();
 }
 
 void Recall::corrupt_pattern(std::filesystem::path const& name)
@@ -239,144 +790,389 @@ void Recall::corrupt_pattern(std::filesystem::path const& name)
   assert(std::filesystem::is_regular_file(path));
   assert(path.extension() == ".txt");
 
-  original_pattern_.load_from_file(patterns_directory_, name, 4096);
-  assert(original_pattern_.size() == 4096);
-  assert(std::all_of(original_pattern_.pattern().begin(),
-                     original_pattern_.pattern().end(),
-                     [](int value) { return value == +1 || value == -1; }));
+  auto [width, height] = dimensions_;
+  auto neurons         = dimensions_.neurons();
+
+  original_pattern_.load_from_file(patterns_directory_, name, neurons);
+  assert(original_pattern_.size() == neurons);
 
   noisy_pattern_ = original_pattern_;
-  noisy_pattern_.add_noise(0.1, 4096);
-  assert(noisy_pattern_.size() == 4096);
-  assert(std::all_of(noisy_pattern_.pattern().begin(),
-                     noisy_pattern_.pattern().end(),
-                     [](int value) { return value == +1 || value == -1; }));
+  noisy_pattern_.add_noise(0.1, neurons);
+  assert(noisy_pattern_.size() == neurons);
 
   auto noisy_name = name.filename().replace_extension(".noise.txt");
-  noisy_pattern_.save_to_file(corrupted_directory_, noisy_name, 4096);
-  noisy_pattern_.save_image(corrupted_directory_, noisy_name, 64, 64);
-
+  noisy_pattern_.save_to_file(corrupted_directory_, noisy_name, dimensions_);
+  noisy_pattern_.save_image(corrupted_directory_, noisy_name, width, height);
+
+  // Rows 34 to 58 and columns 11 to 35 of a 64x64 image, scaled to the
+  // dimensions of the network
+  auto scale = [](unsigned int index, unsigned int side) {
+    return std::max(1u, static_cast<unsigned int>(std::size_t{index} * side
+                                                  / 64));
+  };
   cut_pattern_ = original_pattern_;
-  cut_pattern_.cut(-1, 34, 58, 11, 35, 64, 64);
-  assert(cut_pattern_.size() == 4096);
-  assert(std::all_of(cut_pattern_.pattern().begin(),
-                     cut_pattern_.pattern().end(),
-                     [](int value) { return value == +1 || value == -1; }));
+  cut_pattern_.cut(-1, scale(34, height), scale(58, height), scale(11, width),
+                   scale(35, width), width, height);
+  assert(cut_pattern_.size() == neurons);
 
   auto cut_name = name.filename().replace_extension(".cut.txt");
-  cut_pattern_.save_to_file(corrupted_directory_, cut_name, 4096);
-  cut_pattern_.save_image(corrupted_directory_, cut_name, 64, 64);
+  cut_pattern_.save_to_file(corrupted_directory_, cut_name, dimensions_);
+  cut_pattern_.save_image(corrupted_directory_, cut_name, width, height);
 }
 
-bool Recall::single_network_update()
+void Recall::compute_local_fields_(std::vector<int> const& state,
+                                   std::span<double> local_fields) const
+{
+  if (backend_ == Recall_Backend::pattern_memory) {
+    auto fields = hopfield_local_fields(state, pattern_memory_);
+    std::copy(fields.begin(), fields.end(), local_fields.begin());
+  } else if (backend_ == Recall_Backend::tiled_weight_matrix) {
+    tiled_weight_matrix_->multiply(state, local_fields);
+  } else if (thread_pool_ == nullptr) {
+    network_->local_fields(state, local_fields);
+  } else {
+    hopfield_local_fields(state, *weight_matrix_, *thread_pool_, partitioning_,
+                          local_fields);
+  }
+}
+
+double Recall::compute_energy_(std::vector<int> const& state)
+{
+  // Same reduction as in hopfield_energy()
+  compute_local_fields_(state, scratch_fields_);
+  auto energy = std::inner_product(state.begin(), state.end(),
+                                   scratch_fields_.begin(), 0.);
+
+  return -energy / 2;
+}
+
+void Recall::apply_flips_()
+{
+  if (backend_ == Recall_Backend::pattern_memory) {
+    update_local_fields(local_fields_, flipped_, current_state_,
+                        pattern_memory_);
+  } else if (backend_ == Recall_Backend::tiled_weight_matrix) {
+    // A flip reads a row and a column of tiles, T tiles, and a new pass the
+    // T * (T + 1) / 2 tiles of the file once
+    auto tile_size = tiled_weight_matrix_->tile_size();
+    auto T         = (dimensions_.neurons() + tile_size - 1) / tile_size;
+    if (2 * flipped_.size() < T + 1) {
+      for (auto k : flipped_) {
+        tiled_weight_matrix_->accumulate_row(k, 2. * current_state_[k - 1],
+                                             local_fields_);
+      }
+    } else {
+      tiled_weight_matrix_->multiply(current_state_, local_fields_);
+    }
+  } else if (thread_pool_ == nullptr) {
+    network_->update_local_fields(local_fields_, flipped_, current_state_);
+  } else {
+    update_local_fields(local_fields_, flipped_, current_state_,
+                        *weight_matrix_, *thread_pool_, partitioning_);
+  }
+}
+
+void Recall::prepare_local_fields_()
+{
+  if (local_fields_ready_) {
+    return;
+  }
+
+  compute_local_fields_(current_state_, local_fields_);
+  auto energy = std::inner_product(current_state_.begin(), current_state_.end(),
+                                   local_fields_.begin(), 0.);
+  energy_ = -energy / 2;
+
+  state_hash_ = 0;
+  for (std::size_t i{1}; i <= current_state_.size(); ++i) {
+    if (current_state_[i - 1] == +1) {
+      state_hash_ ^= state_key(i);
+    }
+  }
+
+  local_fields_ready_ = true;
+}
+
+void Recall::refresh_borderline_fields_()
 {
-  assert(current_state_.size() == 4096);
+  // The exact local fields are integers divided by N, 1 / N apart. With N a
+  // power of two the weights are dyadic and the updated fields exact;
+  // otherwise their rounding errors, far below 1 / (2 * N), can only change
+  // the sign of a null field
+  auto N = dimensions_.neurons();
+  if (std::has_single_bit(N)) {
+    return;
+  }
+  auto borderline = 0.5 / static_cast<double>(N);
+  if (std::any_of(local_fields_.begin(), local_fields_.end(),
+                  [borderline](double field) {
+                    return std::abs(field) < borderline;
+                  })) {
+    compute_local_fields_(current_state_, local_fields_);
+  }
+}
+
+void Recall::reserve_buffers_()
+{
+  auto neurons = dimensions_.neurons();
+
+  std::iota(order_.begin(), order_.end(), std::size_t{1});
+  assert(order_.size() == neurons);
+
+  // At most every neuron flips in an update: no reallocation while iterating
+  flipped_.reserve(neurons);
+  flipped_fields_.reserve(neurons);
+  current_state_.reserve(neurons);
+}
+
+bool Recall::revisits_state_()
+{
+  // An update that changed the state cannot come back to the previous one
+  auto size    = recent_hashes_.size();
+  auto last    = std::min(current_iteration_, size);
+  auto visited = false;
+  for (std::size_t period{2}; period <= last; ++period) {
+    if (recent_hashes_[(current_iteration_ - period) % size] == state_hash_) {
+      visited = true;
+    }
+  }
+  recent_hashes_[current_iteration_ % size] = state_hash_;
+
+  return visited;
+}
+
+bool Recall::synchronous_update_()
+{
+  assert(current_state_.size() == dimensions_.neurons());
   assert(std::all_of(current_state_.begin(), current_state_.end(),
                      [](int value) { return value == +1 || value == -1; }));
 
-  std::vector<int> new_state;
-  std::size_t i{0};
-  std::generate_n(std::back_inserter(new_state), current_state_.size(), [&]() {
-    ++i;
-    auto local_field = hopfield_local_field(i, current_state_, weight_matrix_);
-    return sign(local_field);
-  });
+  if (local_fields_ready_) {
+    refresh_borderline_fields_();
+  }
+  prepare_local_fields_();
+  assert(local_fields_.size() == dimensions_.neurons());
+
+  // Every new value depends only on the local fields of the previous state,
+  // which are updated after all the neurons have been visited
+  flipped_.clear();
+  flipped_fields_.clear();
+  for (std::size_t i{1}; i <= current_state_.size(); ++i) {
+    auto new_value = sign(local_fields_[i - 1]);
+    if (new_value != current_state_[i - 1]) {
+      current_state_[i - 1] = new_value;
+      flipped_.push_back(i);
+      flipped_fields_.push_back(local_fields_[i - 1]);
+      state_hash_ ^= state_key(i);
+    }
+  }
 
-  assert(new_state.size() == 4096);
-  assert(std::all_of(new_state.begin(), new_state.end(),
-                     [](int value) { return value == +1 || value == -1; }));
+  apply_flips_();
+  assert(local_fields_.size() == dimensions_.neurons());
+
+  // With the flips ds_k = 2 * s'_k, E' - E = -ds . h - ds . W ds / 2 and
+  // W ds = h' - h
+  for (std::size_t f{0}; f != flipped_.size(); ++f) {
+    auto k = flipped_[f];
+    energy_ -=
+        current_state_[k - 1] * (flipped_fields_[f] + local_fields_[k - 1]);
+  }
 
-  auto has_converged = (new_state == current_state_);
+  assert(current_state_.size() == dimensions_.neurons());
+  assert(std::all_of(current_state_.begin(), current_state_.end(),
+                     [](int value) { return value == +1 || value == -1; }));
 
-  current_state_ = new_state;
   ++current_iteration_;
 
-  return !has_converged;
+  return !flipped_.empty();
 }
 
-void Recall::network_update_dynamics()
+bool Recall::asynchronous_sweep_()
 {
-  assert(weight_matrix_.neurons() == 4096);
-  assert(weight_matrix_.weights().size() == 8'386'560);
+  assert(current_state_.size() == dimensions_.neurons());
+  assert(order_.size() == dimensions_.neurons());
 
-  assert(noisy_pattern_.size() == 4096);
-  assert(std::all_of(noisy_pattern_.pattern().begin(),
-                     noisy_pattern_.pattern().end(),
-                     [](int value) { return value == +1 || value == -1; }));
-  assert(cut_pattern_.size() == 4096);
-  assert(std::all_of(cut_pattern_.pattern().begin(),
-                     cut_pattern_.pattern().end(),
+  prepare_local_fields_();
+  assert(local_fields_.size() == dimensions_.neurons());
+
+  if (neuron_order_ == Neuron_Order::random) {
+    std::shuffle(order_.begin(), order_.end(), engine_);
+  }
+
+  // Each neuron sees the flips of the neurons preceding it in the sweep: the
+  // null diagonal leaves its own local field unchanged by its flip
+  flipped_.clear();
+  for (auto i : order_) {
+    auto new_value = sign(local_fields_[i - 1]);
+    if (new_value != current_state_[i - 1]) {
+      current_state_[i - 1] = new_value;
+      flipped_.push_back(i);
+      state_hash_ ^= state_key(i);
+      // A single flip changes the energy by -2 * s'_i * h_i
+      energy_ -= 2. * new_value * local_fields_[i - 1];
+      if (backend_ == Recall_Backend::pattern_memory) {
+        pattern_memory_.accumulate_row(i, 2. * new_value, local_fields_);
+      } else if (backend_ == Recall_Backend::tiled_weight_matrix) {
+        tiled_weight_matrix_->accumulate_row(i, 2. * new_value,
+                                             local_fields_);
+      } else {
+        weight_matrix_->accumulate_row(i, 2. * new_value, local_fields_);
+      }
+    }
+  }
+
+  assert(std::all_of(current_state_.begin(), current_state_.end(),
                      [](int value) { return value == +1 || value == -1; }));
 
-  assert(current_state_.size() == 0);
+  ++current_iteration_;
 
-  // Choose between noisy_pattern_ and cut_pattern_
-  current_state_ = noisy_pattern_.pattern();
+  return !flipped_.empty();
+}
 
-  assert(current_state_.size() == 4096);
-  assert(current_state_ == noisy_pattern_.pattern());
+bool Recall::single_network_update()
+{
+  if (update_mode_ == Update_Mode::asynchronous) {
+    return asynchronous_sweep_();
+  } else {
+    return synchronous_update_();
+  }
+}
 
-  auto original_energy =
-      hopfield_energy(original_pattern_.pattern(), weight_matrix_);
-  std::cout << "Original pattern's energy: " << original_energy << '\n';
+Termination Recall::run_dynamics_(Observer& observer, Pattern const& original,
+                                  double original_energy)
+{
+  assert(current_state_.size() == dimensions_.neurons());
+  assert(!local_fields_ready_);
 
-  auto current_energy = hopfield_energy(current_state_, weight_matrix_);
-  std::cout << "Initial energy: " << current_energy << '\n';
+  prepare_local_fields_();
 
-  float scale = 3.f;
-  sf::RenderWindow window(
-      sf::VideoMode(2 * 64 * static_cast<unsigned int>(scale),
-                    64 * static_cast<unsigned int>(scale)),
-      "Network update dynamics");
+  // The energy is kept by the updates themselves, without any pass over the
+  // weights
+  auto current_energy = energy_;
+  assert(same_energy(current_energy, compute_energy_(current_state_),
+                     dimensions_.neurons()));
 
-  auto starting_image = create_image(64, 64, current_state_);
-  auto current_image  = starting_image;
+  observer.on_start(current_state_, current_energy, original_energy);
+
+  assert(current_iteration_ == 0);
+  recent_hashes_[0] = state_hash_;
+
+  // The budget is checked before every update, so that a worker given an
+  // adversarial state returns within one update of its limits
+  auto start = std::chrono::steady_clock::now();
+  Termination termination;
+  while (true) {
+    if (current_iteration_ >= max_iterations_) {
+      termination = Termination::iteration_budget;
+      break;
+    }
+    if (std::chrono::steady_clock::now() - start >= max_duration_) {
+      termination = Termination::time_budget;
+      break;
+    }
+    if (!single_network_update()) {
+      termination = Termination::fixed_point;
+      break;
+    }
+    current_energy = energy_;
+    observer.on_iteration(current_iteration_, current_state_, current_energy);
+    if (revisits_state_()) {
+      termination = Termination::cycle;
+      break;
+    }
+  }
 
-  assert(starting_image.getSize().x == 64 && starting_image.getSize().y == 64);
-  assert(current_image.getSize().x == 64 && current_image.getSize().y == 64);
+  assert(termination != Termination::fixed_point || flipped_.empty());
+  assert(same_energy(current_energy, compute_energy_(current_state_),
+                     dimensions_.neurons()));
 
-  sf::Texture starting_texture, current_texture;
+  auto overlap = original.overlap(Pattern{current_state_});
 
-  starting_texture.loadFromImage(starting_image);
-  sf::Sprite starting_sprite(starting_texture);
-  starting_sprite.setScale(scale, scale);
-  starting_sprite.setPosition(0, 0);
+  observer.on_finish(current_iteration_, current_state_, current_energy,
+                     overlap);
 
-  current_texture.loadFromImage(current_image);
-  sf::Sprite current_sprite(current_texture);
-  current_sprite.setScale(scale, scale);
-  current_sprite.setPosition(64 * scale, 0);
+  return termination;
+}
 
-  window.clear();
-  window.draw(starting_sprite);
-  window.draw(current_sprite);
-  window.display();
+Termination Recall::network_update_dynamics(Observer& observer)
+{
+  assert(backend_ != Recall_Backend::weight_matrix
+         || weight_matrix_->size() == dimensions_.weights());
 
-  assert(current_iteration_ == 0);
+  assert(noisy_pattern_.size() == dimensions_.neurons());
+  assert(cut_pattern_.size() == dimensions_.neurons());
 
-  while (single_network_update()) {
-    current_energy = hopfield_energy(current_state_, weight_matrix_);
-    std::cout << "Iteration " << current_iteration_
-              << ". Current energy: " << current_energy << '\n';
+  assert(current_state_.size() == 0);
 
-    current_image = create_image(64, 64, current_state_);
-    current_texture.update(current_image);
+  // Choose between noisy_pattern_ and cut_pattern_
+  current_state_ = noisy_pattern_.pattern();
 
-    window.clear();
-    window.draw(starting_sprite);
-    window.draw(current_sprite);
-    window.display();
+  assert(current_state_.size() == dimensions_.neurons());
+  assert(current_state_ == noisy_pattern_.pattern());
+
+  auto original_energy = compute_energy_(original_pattern_.pattern());
+  auto termination =
+      run_dynamics_(observer, original_pattern_, original_energy);
+
+  if (original_pattern_ == Pattern{current_state_}) {
+    assert(same_energy(energy_, original_energy, dimensions_.neurons()));
   }
 
-  assert(!single_network_update());
-  assert(current_energy == hopfield_energy(current_state_, weight_matrix_));
+  return termination;
+}
 
-  if (current_state_ == original_pattern_.pattern()) {
-    assert(current_energy == original_energy);
-    std::cout << "The original pattern has been restored." << '\n';
-  } else {
-    std::cout << "The original pattern has not been restored." << '\n';
+Termination Recall::network_update_dynamics()
+{
+  Null_Observer observer;
+  return network_update_dynamics(observer);
+}
+
+Recall_Result Recall::recall(Pattern const& probe,
+                             Recall_Options const& options)
+{
+  auto [width, height] = dimensions_;
+  auto neurons         = dimensions_.neurons();
+  if (probe.size() != neurons) {
+    throw std::runtime_error("The probe must have " + std::to_string(neurons)
+                             + " values.\nActual number of values: "
+                             + std::to_string(probe.size()));
   }
+
+  auto corrupted = probe;
+  if (options.corruption == Corruption::noise) {
+    if (!(options.noise >= 0. && options.noise <= 1.)) {
+      throw std::runtime_error("The noise must be in [0, 1].");
+    }
+    corrupted.add_noise(options.noise, neurons, options.seed);
+  } else if (options.corruption == Corruption::cut) {
+    if (options.from_row < 1 || options.from_row > options.to_row
+        || options.to_row > height || options.from_column < 1
+        || options.from_column > options.to_column
+        || options.to_column > width) {
+      throw std::runtime_error("The cut must lie in the "
+                               + std::to_string(width) + "x"
+                               + std::to_string(height) + " network.");
+    }
+    corrupted.cut(-1, options.from_row, options.to_row, options.from_column,
+                  options.to_column, width, height);
+  }
+
+  clear_state();
+  current_state_ = corrupted.pattern();
+
+  // The energy of the probe is only computed for an observer
+  Null_Observer none;
+  auto termination =
+      options.observer == nullptr
+          ? run_dynamics_(none, probe, 0.)
+          : run_dynamics_(*options.observer, probe,
+                          compute_energy_(probe.pattern()));
+
+  Recall_Result result{std::move(corrupted), Pattern{current_state_},
+                       termination, current_iteration_, energy_, 0.};
+  result.overlap = probe.overlap(result.state);
+
+  return result;
 }
 
 void Recall::save_current_state(std::filesystem::path const& original_name) const
@@ -386,8 +1182,9 @@ void Recall::save_current_state(std::filesystem::path const& original_name) cons
   auto name = original_name;
   name.replace_extension(".restored.txt");
   Pattern pattern{current_state_};
-  pattern.save_to_file(corrupted_directory_, name, 4096);
-  pattern.save_image(corrupted_directory_, name, 64, 64);
+  pattern.save_to_file(corrupted_directory_, name, dimensions_);
+  pattern.save_image(corrupted_directory_, name, dimensions_.width,
+                     dimensions_.height);
 }
 
 } // namespace nn
\ No newline at end of file
@@ -0,0 +1,695 @@
+// All relative paths are relative to the "build/" directory
+
+// This path is the only one relative to "recall_server.cpp"
+#include "../include/recall_server.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace nn {
+
+namespace {
+
+constexpr char request_magic[4]{'H', 'N', 'R', 'Q'};
+constexpr char response_magic[4]{'H', 'N', 'R', 'S'};
+constexpr std::uint32_t protocol_version{1};
+
+// Pause of the dispatcher before accepting again when the process or the
+// system is out of descriptors or memory
+constexpr std::chrono::milliseconds accept_backoff{100};
+
+using Deadline = std::chrono::steady_clock::time_point;
+
+// Deadline of the client, which waits for the server as long as needed
+constexpr Deadline no_deadline{Deadline::max()};
+
+// Waits with poll() until descriptor is ready for events, which include the
+// errors and the end of the connection; false once deadline has passed
+bool wait_ready(int descriptor, short events, Deadline deadline)
+{
+  while (true) {
+    int timeout{-1};
+    if (deadline != no_deadline) {
+      auto left = deadline - std::chrono::steady_clock::now();
+      if (left <= Deadline::duration::zero()) {
+        return false;
+      }
+      timeout = static_cast<int>(
+          std::chrono::ceil<std::chrono::milliseconds>(left).count());
+    }
+    pollfd watched{descriptor, events, 0};
+    auto ready = ::poll(&watched, 1, timeout);
+    if (ready == -1 && errno == EINTR) {
+      continue;
+    }
+    return ready > 0;
+  }
+}
+
+// recv() and send() of exactly bytes bytes, retried when interrupted or
+// partial, all of them before deadline, however slowly the peer reads or
+// writes; false on error, at the end of the connection or once deadline has
+// passed. send() does not raise SIGPIPE when the peer has gone.
+bool read_all(int descriptor, void* data, std::size_t bytes, Deadline deadline)
+{
+  auto position = static_cast<char*>(data);
+  while (bytes != 0) {
+    if (!wait_ready(descriptor, POLLIN, deadline)) {
+      return false;
+    }
+    auto done = ::recv(descriptor, position, bytes, MSG_DONTWAIT);
+    if (done == -1 && (errno == EINTR || errno == EAGAIN)) {
+      continue;
+    }
+    if (done <= 0) {
+      return false;
+    }
+    position += done;
+    bytes -= static_cast<std::size_t>(done);
+  }
+  return true;
+}
+
+bool write_all(int descriptor, const void* data, std::size_t bytes,
+               Deadline deadline)
+{
+  auto position = static_cast<const char*>(data);
+  while (bytes != 0) {
+    if (!wait_ready(descriptor, POLLOUT, deadline)) {
+      return false;
+    }
+    auto done =
+        ::send(descriptor, position, bytes, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (done == -1 && (errno == EINTR || errno == EAGAIN)) {
+      continue;
+    }
+    if (done <= 0) {
+      return false;
+    }
+    position += done;
+    bytes -= static_cast<std::size_t>(done);
+  }
+  return true;
+}
+
+// Reads a frame into frame, resized to the size of its header and payload;
+// false on error, at the end of the connection, once deadline has passed or
+// if the frame is larger than max_recall_frame_size
+bool read_frame(int descriptor, std::vector<char>& frame, Deadline deadline)
+{
+  std::uint32_t size;
+  if (!read_all(descriptor, &size, sizeof(size), deadline)
+      || size > max_recall_frame_size) {
+    return false;
+  }
+  frame.resize(size);
+  return read_all(descriptor, frame.data(), size, deadline);
+}
+
+bool write_frame(int descriptor, std::span<const char> frame,
+                 Deadline deadline)
+{
+  assert(frame.size() <= max_recall_frame_size);
+  auto size = static_cast<std::uint32_t>(frame.size());
+  return write_all(descriptor, &size, sizeof(size), deadline)
+      && write_all(descriptor, frame.data(), frame.size(), deadline);
+}
+
+// The header of frame, checked against magic; the payload must fill the rest
+// of the frame
+template<class Header>
+Header read_header(std::span<const char> frame, const char (&magic)[4])
+{
+  Header header;
+  if (frame.size() < sizeof(header)) {
+    throw std::runtime_error("Malformed recall frame.\nMissing header.");
+  }
+  std::memcpy(&header, frame.data(), sizeof(header));
+  if (std::memcmp(header.magic, magic, sizeof(header.magic)) != 0
+      || header.version != protocol_version) {
+    throw std::runtime_error(
+        "Malformed recall frame.\nInvalid magic number or version.");
+  }
+  if (header.payload_size != frame.size() - sizeof(header)) {
+    throw std::runtime_error("Malformed recall frame.\nPayload size "
+                             + std::to_string(header.payload_size)
+                             + ", actual size "
+                             + std::to_string(frame.size() - sizeof(header)));
+  }
+  return header;
+}
+
+// The values +1 and -1 as signed bytes, and back; other values are kept, to
+// be refused by Recall_Server::recall()
+void write_values(std::vector<int> const& values, char* payload)
+{
+  std::transform(values.begin(), values.end(), payload,
+                 [](int value) { return static_cast<char>(value); });
+}
+
+std::vector<int> read_values(std::span<const char> payload)
+{
+  std::vector<int> values(payload.size());
+  std::transform(payload.begin(), payload.end(), values.begin(), [](char c) {
+    return static_cast<int>(static_cast<signed char>(c));
+  });
+  return values;
+}
+
+} // namespace
+
+std::vector<char> encode_request(Recall_Request const& request)
+{
+  auto by_name = request.pattern.empty();
+
+  Recall_Request_Header header{};
+  std::memcpy(header.magic, request_magic, sizeof(header.magic));
+  header.version        = protocol_version;
+  header.source         = by_name ? 1 : 0;
+  header.corruption     = static_cast<std::uint8_t>(request.corruption);
+  header.mode           = static_cast<std::uint8_t>(request.mode);
+  header.seed           = request.seed;
+  header.noise          = request.noise;
+  header.from_row       = request.from_row;
+  header.to_row         = request.to_row;
+  header.from_column    = request.from_column;
+  header.to_column      = request.to_column;
+  header.max_iterations = request.max_iterations;
+  header.payload_size   = static_cast<std::uint32_t>(
+      by_name ? request.name.size() : request.pattern.size());
+
+  std::vector<char> frame(sizeof(header) + header.payload_size);
+  std::memcpy(frame.data(), &header, sizeof(header));
+  auto payload = frame.data() + sizeof(header);
+  if (by_name) {
+    std::copy(request.name.begin(), request.name.end(), payload);
+  } else {
+    write_values(request.pattern, payload);
+  }
+
+  return frame;
+}
+
+Recall_Request decode_request(std::span<const char> frame)
+{
+  auto header = read_header<Recall_Request_Header>(frame, request_magic);
+  if (header.source > 1 || header.corruption > 2 || header.mode > 1) {
+    throw std::runtime_error(
+        "Malformed recall frame.\nInvalid source, corruption or mode.");
+  }
+
+  Recall_Request request;
+  auto payload = frame.subspan(sizeof(header));
+  if (header.source == 1) {
+    request.name.assign(payload.begin(), payload.end());
+  } else {
+    request.pattern = read_values(payload);
+  }
+  request.corruption     = static_cast<Corruption>(header.corruption);
+  request.noise          = header.noise;
+  request.seed           = header.seed;
+  request.from_row       = header.from_row;
+  request.to_row         = header.to_row;
+  request.from_column    = header.from_column;
+  request.to_column      = header.to_column;
+  request.mode           = static_cast<Update_Mode>(header.mode);
+  request.max_iterations = header.max_iterations;
+
+  return request;
+}
+
+std::vector<char> encode_response(Recall_Response const& response)
+{
+  Recall_Response_Header header{};
+  std::memcpy(header.magic, response_magic, sizeof(header.magic));
+  header.version      = protocol_version;
+  header.status       = response.ok ? 0 : 1;
+  header.termination  = static_cast<std::uint8_t>(response.termination);
+  header.iterations   = response.iterations;
+  header.energy       = response.energy;
+  header.overlap      = response.overlap;
+  header.microseconds = response.microseconds;
+  header.payload_size = static_cast<std::uint32_t>(
+      response.ok ? response.state.size() : response.error.size());
+
+  std::vector<char> frame(sizeof(header) + header.payload_size);
+  std::memcpy(frame.data(), &header, sizeof(header));
+  auto payload = frame.data() + sizeof(header);
+  if (response.ok) {
+    write_values(response.state, payload);
+  } else {
+    std::copy(response.error.begin(), response.error.end(), payload);
+  }
+
+  return frame;
+}
+
+Recall_Response decode_response(std::span<const char> frame)
+{
+  auto header = read_header<Recall_Response_Header>(frame, response_magic);
+  if (header.status > 1 || header.termination > 3) {
+    throw std::runtime_error(
+        "Malformed recall frame.\nInvalid status or termination.");
+  }
+
+  Recall_Response response;
+  response.ok  = header.status == 0;
+  auto payload = frame.subspan(sizeof(header));
+  if (response.ok) {
+    response.state = read_values(payload);
+  } else {
+    response.error.assign(payload.begin(), payload.end());
+  }
+  response.termination  = static_cast<Termination>(header.termination);
+  response.iterations   = header.iterations;
+  response.energy       = header.energy;
+  response.overlap      = header.overlap;
+  response.microseconds = header.microseconds;
+
+  return response;
+}
+
+// base_directory can only be "" or "tests/"
+Recall_Server::Recall_Server(
+    std::filesystem::path const& base_directory,
+    std::filesystem::path const& socket_path, std::size_t workers,
+    std::size_t max_iterations,
+    std::chrono::steady_clock::duration max_duration,
+    std::chrono::steady_clock::duration request_timeout)
+    : patterns_directory_{"../" + base_directory.string() + "patterns/"}
+    , socket_path_{socket_path}
+    , dimensions_{read_weight_matrix_dimensions(
+          "../" + base_directory.string() + "weight_matrix/weight_matrix.bin")}
+    , weight_matrix_{load_shared_weight_matrix(
+          "../" + base_directory.string() + "weight_matrix/weight_matrix.bin",
+          dimensions_.neurons())}
+    , max_iterations_{max_iterations}
+    , max_duration_{max_duration}
+    , request_timeout_{request_timeout}
+    , patterns_mutex_{}
+    , patterns_{}
+    , recalls_mutex_{}
+    , idle_recalls_{}
+    , queue_mutex_{}
+    , request_ready_{}
+    , pending_connections_{}
+    , answered_connections_{}
+    , descriptor_{-1}
+    , wakeup_{-1, -1}
+    , stopping_{false}
+    , dispatcher_{}
+    , workers_{}
+{
+  // Without workers the connections would be accepted and never answered
+  if (workers == 0) {
+    throw std::runtime_error("A recall server needs at least one worker.");
+  }
+
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  auto path          = socket_path_.string();
+  if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+    throw std::runtime_error("Socket path \"" + path + "\" is invalid.");
+  }
+  std::copy(path.begin(), path.end(), address.sun_path);
+
+  // The socket of a previous server which has not been stopped is replaced
+  if (std::filesystem::is_socket(socket_path_)) {
+    std::filesystem::remove(socket_path_);
+  }
+
+  descriptor_ =
+      ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+  if (descriptor_ == -1
+      || ::bind(descriptor_, reinterpret_cast<sockaddr*>(&address),
+                sizeof(address))
+             == -1
+      || ::listen(descriptor_, SOMAXCONN) == -1
+      || ::pipe2(wakeup_, O_CLOEXEC | O_NONBLOCK) == -1) {
+    if (descriptor_ != -1) {
+      ::close(descriptor_);
+    }
+    throw std::runtime_error("Socket \"" + path
+                             + "\" not created successfully.");
+  }
+
+  dispatcher_ = std::thread{[this] { dispatch_(); }};
+  workers_.reserve(workers);
+  for (std::size_t w{0}; w != workers; ++w) {
+    workers_.emplace_back([this] { work_(); });
+  }
+
+  assert(weight_matrix_->size() == dimensions_.weights());
+}
+
+Recall_Server::~Recall_Server()
+{
+  stop();
+}
+
+Dimensions Recall_Server::dimensions() const
+{
+  return dimensions_;
+}
+
+std::size_t Recall_Server::workers() const
+{
+  return workers_.size();
+}
+
+Pattern Recall_Server::stored_pattern_(std::string const& name)
+{
+  // Only the files of the patterns directory can be requested
+  std::filesystem::path path{name};
+  if (name.empty() || path.filename() != path || path.extension() != ".txt") {
+    throw std::runtime_error("Pattern name \"" + name + "\" is invalid.");
+  }
+
+  {
+    std::lock_guard lock{patterns_mutex_};
+    auto found = patterns_.find(name);
+    if (found != patterns_.end()) {
+      return found->second;
+    }
+  }
+
+  if (!std::filesystem::is_regular_file(patterns_directory_ / path)) {
+    throw std::runtime_error("Pattern \"" + name + "\" does not exist.");
+  }
+  Pattern pattern;
+  pattern.load_from_file(patterns_directory_, path, dimensions_.neurons());
+
+  std::lock_guard lock{patterns_mutex_};
+  patterns_.emplace(name, pattern);
+  return pattern;
+}
+
+Recall_Response Recall_Server::recall(Recall_Request const& request)
+{
+  auto start = std::chrono::steady_clock::now();
+
+  std::unique_ptr<Recall> recall;
+  {
+    std::lock_guard lock{recalls_mutex_};
+    if (!idle_recalls_.empty()) {
+      recall = std::move(idle_recalls_.back());
+      idle_recalls_.pop_back();
+    }
+  }
+
+  Recall_Response response;
+  try {
+    if (recall == nullptr) {
+      recall = std::make_unique<Recall>(weight_matrix_, dimensions_);
+    }
+
+    // Pattern accepts only +1 and -1, the size being checked by recall()
+    if (!std::all_of(request.pattern.begin(), request.pattern.end(),
+                     [](int value) { return value == +1 || value == -1; })) {
+      throw std::runtime_error("The probe must have values +1 or -1.");
+    }
+    auto probe = request.pattern.empty() ? stored_pattern_(request.name)
+                                         : Pattern{request.pattern};
+
+    Recall_Options options;
+    options.corruption  = request.corruption;
+    options.noise       = request.noise;
+    options.seed        = request.seed;
+    options.from_row    = request.from_row;
+    options.to_row      = request.to_row;
+    options.from_column = request.from_column;
+    options.to_column   = request.to_column;
+
+    recall->set_update_mode(request.mode);
+    recall->set_budget(
+        request.max_iterations == 0
+            ? max_iterations_
+            : std::min<std::size_t>(request.max_iterations, max_iterations_),
+        max_duration_);
+    auto result = recall->recall(probe, options);
+
+    response.ok          = true;
+    response.state       = result.state.pattern();
+    response.termination = result.termination;
+    response.iterations  = static_cast<std::uint32_t>(result.iterations);
+    response.energy      = result.energy;
+    response.overlap     = result.overlap;
+  } catch (std::exception const& e) {
+    response       = Recall_Response{};
+    response.error = e.what();
+  }
+
+  if (recall != nullptr) {
+    std::lock_guard lock{recalls_mutex_};
+    idle_recalls_.push_back(std::move(recall));
+  }
+
+  response.microseconds = static_cast<std::uint64_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - start)
+          .count());
+  return response;
+}
+
+bool Recall_Server::serve_(int connection)
+{
+  // The whole request must arrive within request_timeout_ of its first byte,
+  // and the client must take the whole response within request_timeout_ of
+  // the end of the dynamics
+  std::vector<char> frame;
+  if (!read_frame(connection, frame,
+                  std::chrono::steady_clock::now() + request_timeout_)) {
+    return false;
+  }
+
+  Recall_Request request;
+  try {
+    request = decode_request(frame);
+  } catch (std::runtime_error const&) {
+    return false;
+  }
+
+  auto response = recall(request);
+  return write_frame(connection, encode_response(response),
+                     std::chrono::steady_clock::now() + request_timeout_);
+}
+
+void Recall_Server::wake_dispatcher_()
+{
+  // A full pipe already holds a pending wakeup
+  char byte{0};
+  [[maybe_unused]] auto written = ::write(wakeup_[1], &byte, 1);
+}
+
+void Recall_Server::dispatch_()
+{
+  // Connections waiting for their next request, and the descriptors given to
+  // poll(): the wakeup pipe, the listening socket and the idle connections
+  std::vector<int> idle;
+  std::vector<pollfd> watched;
+  std::chrono::steady_clock::time_point paused_until{};
+  auto listening = true;
+
+  while (true) {
+    {
+      std::lock_guard lock{queue_mutex_};
+      if (stopping_) {
+        break;
+      }
+      idle.insert(idle.end(), answered_connections_.begin(),
+                  answered_connections_.end());
+      answered_connections_.clear();
+    }
+
+    auto now       = std::chrono::steady_clock::now();
+    auto accepting = listening && now >= paused_until;
+    watched.clear();
+    watched.push_back({wakeup_[0], POLLIN, 0});
+    // poll() ignores negative descriptors
+    watched.push_back({accepting ? descriptor_ : -1, POLLIN, 0});
+    for (auto connection : idle) {
+      watched.push_back({connection, POLLIN, 0});
+    }
+    int timeout{-1};
+    if (listening && !accepting) {
+      timeout = static_cast<int>(
+          std::chrono::ceil<std::chrono::milliseconds>(paused_until - now)
+              .count());
+    }
+
+    if (::poll(watched.data(), watched.size(), timeout) == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+
+    if (watched[0].revents != 0) {
+      char bytes[64];
+      while (::read(wakeup_[0], bytes, sizeof(bytes)) > 0) {
+      }
+    }
+
+    // Readable or closed connections go to the workers, which find the end
+    // of the latter. Once stop() has been called the workers may have
+    // drained the queue and exited: the connections stay in idle, to be
+    // closed below.
+    std::size_t kept{0};
+    {
+      std::lock_guard lock{queue_mutex_};
+      if (stopping_) {
+        break;
+      }
+      for (std::size_t c{0}; c != idle.size(); ++c) {
+        if (watched[c + 2].revents != 0) {
+          pending_connections_.push_back(idle[c]);
+        } else {
+          idle[kept++] = idle[c];
+        }
+      }
+    }
+    if (kept != idle.size()) {
+      idle.resize(kept);
+      request_ready_.notify_all();
+    }
+
+    if (watched[1].revents == 0) {
+      continue;
+    }
+    while (true) {
+      auto connection = ::accept4(descriptor_, nullptr, nullptr, SOCK_CLOEXEC);
+      if (connection != -1) {
+        idle.push_back(connection);
+        continue;
+      }
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      // Out of descriptors or memory: the pending connections wait until
+      // some are released, instead of being retried at once
+      if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS
+          || errno == ENOMEM) {
+        paused_until = std::chrono::steady_clock::now() + accept_backoff;
+      } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        // The socket is unusable: the open connections are still served
+        listening = false;
+      }
+      break;
+    }
+  }
+
+  std::lock_guard lock{queue_mutex_};
+  for (auto connection : idle) {
+    ::close(connection);
+  }
+  for (auto connection : answered_connections_) {
+    ::close(connection);
+  }
+  answered_connections_.clear();
+}
+
+void Recall_Server::work_()
+{
+  std::unique_lock lock{queue_mutex_};
+  while (true) {
+    request_ready_.wait(
+        lock, [this] { return stopping_ || !pending_connections_.empty(); });
+    if (stopping_) {
+      // The requests not yet served are dropped with their connections
+      for (auto connection : pending_connections_) {
+        ::close(connection);
+      }
+      pending_connections_.clear();
+      return;
+    }
+
+    auto connection = pending_connections_.front();
+    pending_connections_.pop_front();
+    lock.unlock();
+    auto served = serve_(connection);
+    lock.lock();
+
+    if (served && !stopping_) {
+      answered_connections_.push_back(connection);
+      wake_dispatcher_();
+    } else {
+      ::close(connection);
+    }
+  }
+}
+
+void Recall_Server::stop()
+{
+  {
+    std::lock_guard lock{queue_mutex_};
+    if (stopping_) {
+      return;
+    }
+    stopping_ = true;
+  }
+  request_ready_.notify_all();
+  wake_dispatcher_();
+
+  dispatcher_.join();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+  ::close(descriptor_);
+  ::close(wakeup_[0]);
+  ::close(wakeup_[1]);
+
+  std::error_code error;
+  std::filesystem::remove(socket_path_, error);
+}
+
+Recall_Client::Recall_Client(std::filesystem::path const& socket_path)
+    : descriptor_{-1}
+    , frame_{}
+{
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  auto path          = socket_path.string();
+  if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+    throw std::runtime_error("Socket path \"" + path + "\" is invalid.");
+  }
+  std::copy(path.begin(), path.end(), address.sun_path);
+
+  descriptor_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (descriptor_ == -1
+      || ::connect(descriptor_, reinterpret_cast<sockaddr*>(&address),
+                   sizeof(address))
+             == -1) {
+    if (descriptor_ != -1) {
+      ::close(descriptor_);
+    }
+    throw std::runtime_error("Recall server at \"" + path
+                             + "\" not reached successfully.");
+  }
+}
+
+Recall_Client::~Recall_Client()
+{
+  ::close(descriptor_);
+}
+
+Recall_Response Recall_Client::recall(Recall_Request const& request)
+{
+  if (!write_frame(descriptor_, encode_request(request), no_deadline)
+      || !read_frame(descriptor_, frame_, no_deadline)) {
+    throw std::runtime_error("Connection to the recall server lost.");
+  }
+
+  return decode_response(frame_);
+}
+
+} // namespace nn
\ No newline at end of file
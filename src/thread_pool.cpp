@@ -0,0 +1,164 @@
+// All relative paths are relative to the "build/" directory
+
+// This path is the only one relative to "thread_pool.cpp"
+#include "../include/thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+
+namespace nn {
+
+void Thread_Pool::work_(std::size_t thread)
+{
+  std::size_t seen_generation{0};
+
+  while (true) {
+    Function_Ref<void(std::size_t)> const* task;
+    {
+      std::unique_lock lock{mutex_};
+      task_ready_.wait(lock, [&] {
+        return stopping_ || generation_ != seen_generation;
+      });
+      if (stopping_) {
+        return;
+      }
+      seen_generation = generation_;
+      task            = task_;
+    }
+
+    try {
+      (*task)(thread);
+    } catch (...) {
+      std::lock_guard lock{mutex_};
+      if (!exception_) {
+        exception_ = std::current_exception();
+      }
+    }
+
+    std::lock_guard lock{mutex_};
+    --running_;
+    if (running_ == 0) {
+      task_done_.notify_one();
+    }
+  }
+}
+
+void Thread_Pool::run_(Function_Ref<void(std::size_t)> task)
+{
+  {
+    std::lock_guard lock{mutex_};
+    assert(running_ == 0);
+    task_      = &task;
+    running_   = workers_.size();
+    exception_ = nullptr;
+    ++generation_;
+  }
+  task_ready_.notify_all();
+
+  std::exception_ptr exception;
+  try {
+    task(0);
+  } catch (...) {
+    exception = std::current_exception();
+  }
+
+  std::unique_lock lock{mutex_};
+  task_done_.wait(lock, [this] { return running_ == 0; });
+  task_ = nullptr;
+  lock.unlock();
+
+  if (exception) {
+    std::rethrow_exception(exception);
+  }
+  if (exception_) {
+    std::rethrow_exception(exception_);
+  }
+}
+
+Thread_Pool::Thread_Pool(std::size_t threads)
+    : workers_{}
+    , task_{nullptr}
+    , generation_{0}
+    , running_{0}
+    , stopping_{false}
+    , exception_{}
+{
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  workers_.reserve(threads - 1);
+  for (std::size_t thread{1}; thread != threads; ++thread) {
+    workers_.emplace_back([this, thread] { work_(thread); });
+  }
+
+  assert(this->threads() == threads);
+}
+
+Thread_Pool::Thread_Pool()
+    : Thread_Pool::Thread_Pool(0)
+{}
+
+Thread_Pool::~Thread_Pool()
+{
+  {
+    std::lock_guard lock{mutex_};
+    stopping_ = true;
+  }
+  task_ready_.notify_all();
+
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+std::size_t Thread_Pool::threads() const
+{
+  return workers_.size() + 1;
+}
+
+void Thread_Pool::parallel_for(
+    std::size_t first, std::size_t last, Partitioning partitioning,
+    Function_Ref<void(std::size_t, std::size_t)> body,
+    std::size_t chunk)
+{
+  assert(first <= last);
+  assert(chunk > 0);
+
+  auto size = last - first;
+  if (size == 0) {
+    return;
+  }
+
+  if (threads() == 1) {
+    body(first, last);
+    return;
+  }
+
+  if (partitioning == Partitioning::blocked) {
+    auto count = threads();
+    auto task = [&](std::size_t thread) {
+      auto begin = first + size * thread / count;
+      auto end   = first + size * (thread + 1) / count;
+      if (begin != end) {
+        body(begin, end);
+      }
+    };
+    run_(task);
+  } else {
+    std::atomic<std::size_t> next{first};
+    auto task = [&](std::size_t) {
+      while (true) {
+        auto begin = next.fetch_add(chunk);
+        if (begin >= last) {
+          return;
+        }
+        body(begin, std::min(begin + chunk, last));
+      }
+    };
+    run_(task);
+  }
+}
+
+} // namespace nn
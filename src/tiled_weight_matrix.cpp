@@ -0,0 +1,614 @@
+// All relative paths are relative to the "build/" directory
+
+// These three paths are the only ones relative to "tiled_weight_matrix.cpp"
+#include "../include/tiled_weight_matrix.hpp"
+#include "../include/binary_format.hpp"
+#include "../include/weight_matrix.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace nn {
+
+namespace {
+
+constexpr char tiled_magic[8]{'H', 'N', 'N', '-', 'W', 'T', '\0', '\0'};
+constexpr std::uint32_t tiled_version{1};
+constexpr char tiled_kind[]{"tiled weight matrix"};
+
+// pread() and pwrite() of exactly bytes bytes at offset, retried when
+// interrupted or partial; false on error or end of file
+bool read_at(int descriptor, void* data, std::size_t bytes, std::size_t offset)
+{
+  auto position = static_cast<char*>(data);
+  while (bytes != 0) {
+    auto done = ::pread(descriptor, position, bytes,
+                        static_cast<off_t>(offset));
+    if (done == -1 && errno == EINTR) {
+      continue;
+    }
+    if (done <= 0) {
+      return false;
+    }
+    position += done;
+    bytes -= static_cast<std::size_t>(done);
+    offset += static_cast<std::size_t>(done);
+  }
+  return true;
+}
+
+bool write_at(int descriptor, const void* data, std::size_t bytes,
+              std::size_t offset)
+{
+  auto position = static_cast<const char*>(data);
+  while (bytes != 0) {
+    auto done = ::pwrite(descriptor, position, bytes,
+                         static_cast<off_t>(offset));
+    if (done == -1 && errno == EINTR) {
+      continue;
+    }
+    if (done <= 0) {
+      return false;
+    }
+    position += done;
+    bytes -= static_cast<std::size_t>(done);
+    offset += static_cast<std::size_t>(done);
+  }
+  return true;
+}
+
+} // namespace
+
+Tiled_Weight_Matrix_Header
+read_tiled_weight_matrix_header(std::filesystem::path const& path)
+{
+  return read_binary_header<Tiled_Weight_Matrix_Header>(path, tiled_magic,
+                                                        tiled_kind);
+}
+
+Dimensions
+read_tiled_weight_matrix_dimensions(std::filesystem::path const& path)
+{
+  return binary_header_dimensions(read_tiled_weight_matrix_header(path), path);
+}
+
+Tiled_Weight_Matrix::Tiled_Weight_Matrix(std::size_t neurons,
+                                         std::size_t cache_bytes,
+                                         std::size_t tile_size)
+    : neurons_{neurons}
+    , tile_size_{tile_size}
+    , cache_tiles_{cache_bytes / (tile_size * tile_size * sizeof(double))}
+    , descriptor_{-1}
+    , cache_{}
+    , clock_{0}
+    , reader_mutex_{}
+    , reader_wakeup_{}
+    , requested_{none_requested}
+    , read_{}
+    , read_error_{}
+    , reader_stopping_{false}
+    , reader_{}
+{
+  assert(tile_size_ != 0);
+
+  // Started last, once the members it uses are initialized
+  reader_ = std::thread{[this] { read_ahead_(); }};
+}
+
+Tiled_Weight_Matrix::~Tiled_Weight_Matrix()
+{
+  {
+    std::lock_guard lock{reader_mutex_};
+    reader_stopping_ = true;
+  }
+  reader_wakeup_.notify_all();
+  reader_.join();
+
+  close_();
+}
+
+std::size_t Tiled_Weight_Matrix::tile_rows_() const
+{
+  return (neurons_ + tile_size_ - 1) / tile_size_;
+}
+
+std::size_t Tiled_Weight_Matrix::tile_index_(std::size_t row_tile,
+                                             std::size_t column_tile) const
+{
+  assert(row_tile <= column_tile && column_tile < tile_rows_());
+
+  // The rows of tiles before row_tile hold T + (T - 1) + ... + (T - row_tile
+  // + 1) tiles
+  auto T = tile_rows_();
+  return row_tile * T - row_tile * (row_tile - 1) / 2 + column_tile - row_tile;
+}
+
+std::size_t Tiled_Weight_Matrix::tile_bytes_() const
+{
+  return tile_size_ * tile_size_ * sizeof(double);
+}
+
+void Tiled_Weight_Matrix::close_()
+{
+  cache_.clear();
+  if (descriptor_ != -1) {
+    ::close(descriptor_);
+    descriptor_ = -1;
+  }
+}
+
+std::shared_ptr<const Tiled_Weight_Matrix::Tile>
+Tiled_Weight_Matrix::read_tile_(std::size_t index) const
+{
+  assert(descriptor_ != -1 && index < tiles());
+
+  auto tile = std::make_shared<Tile>(tile_size_ * tile_size_);
+  if (!read_at(descriptor_, tile->data(), tile_bytes_(),
+               sizeof(Tiled_Weight_Matrix_Header) + index * tile_bytes_())) {
+    throw std::runtime_error("Tile " + std::to_string(index)
+                             + " of the weight matrix not read successfully.");
+  }
+  return tile;
+}
+
+std::shared_ptr<const Tiled_Weight_Matrix::Tile>
+Tiled_Weight_Matrix::find_tile_(std::size_t index) const
+{
+  auto cached = std::find_if(
+      cache_.begin(), cache_.end(),
+      [index](Cached_Tile const& entry) { return entry.index == index; });
+  if (cached == cache_.end()) {
+    return nullptr;
+  }
+  cached->last_use = ++clock_;
+  return cached->tile;
+}
+
+std::shared_ptr<const Tiled_Weight_Matrix::Tile>
+Tiled_Weight_Matrix::tile_(std::size_t index) const
+{
+  auto tile = find_tile_(index);
+  if (tile == nullptr) {
+    tile = read_tile_(index);
+    cache_tile_(index, tile, true);
+  }
+  return tile;
+}
+
+void Tiled_Weight_Matrix::cache_tile_(std::size_t index,
+                                      std::shared_ptr<const Tile> tile,
+                                      bool evict) const
+{
+  if (cache_tiles_ == 0 || find_tile_(index) != nullptr) {
+    return;
+  }
+
+  if (cache_.size() == cache_tiles_) {
+    if (!evict) {
+      return;
+    }
+    auto oldest = std::min_element(
+        cache_.begin(), cache_.end(),
+        [](Cached_Tile const& left, Cached_Tile const& right) {
+          return left.last_use < right.last_use;
+        });
+    cache_.erase(oldest);
+  }
+  cache_.push_back({index, std::move(tile), ++clock_});
+
+  assert(cache_.size() <= cache_tiles_);
+}
+
+void Tiled_Weight_Matrix::fetch_tile_(std::size_t index) const
+{
+  auto tile = find_tile_(index);
+
+  std::lock_guard lock{reader_mutex_};
+  assert(requested_ == none_requested && read_ == nullptr
+         && read_error_ == nullptr);
+  if (tile != nullptr) {
+    read_ = std::move(tile);
+  } else {
+    requested_ = index;
+    reader_wakeup_.notify_all();
+  }
+}
+
+std::shared_ptr<const Tiled_Weight_Matrix::Tile>
+Tiled_Weight_Matrix::take_tile_() const
+{
+  std::unique_lock lock{reader_mutex_};
+  reader_wakeup_.wait(lock, [this] {
+    return read_ != nullptr || read_error_ != nullptr;
+  });
+
+  if (read_error_ != nullptr) {
+    std::rethrow_exception(std::exchange(read_error_, nullptr));
+  }
+  return std::exchange(read_, nullptr);
+}
+
+void Tiled_Weight_Matrix::read_ahead_()
+{
+  std::unique_lock lock{reader_mutex_};
+  while (true) {
+    reader_wakeup_.wait(lock, [this] {
+      return reader_stopping_ || requested_ != none_requested;
+    });
+    if (reader_stopping_) {
+      return;
+    }
+
+    // The file and the tile size do not change while a tile is requested
+    auto index = requested_;
+    lock.unlock();
+    std::shared_ptr<const Tile> tile;
+    std::exception_ptr error;
+    try {
+      tile = read_tile_(index);
+    } catch (...) {
+      error = std::current_exception();
+    }
+    lock.lock();
+
+    requested_  = none_requested;
+    read_       = std::move(tile);
+    read_error_ = error;
+    reader_wakeup_.notify_all();
+  }
+}
+
+void Tiled_Weight_Matrix::open_(std::filesystem::path const& path)
+{
+  close_();
+
+  descriptor_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (descriptor_ == -1) {
+    throw std::runtime_error("File \"" + path.string()
+                             + "\" not opened successfully.");
+  }
+
+  auto error = [&](std::string const& message) {
+    close_();
+    return std::runtime_error("Error in file \"" + path.string() + "\".\n"
+                              + message);
+  };
+
+  Tiled_Weight_Matrix_Header header;
+  if (!read_at(descriptor_, &header, sizeof(header), 0)) {
+    throw error("Missing tiled header.");
+  }
+  check_binary_header(header, tiled_magic, tiled_version, tiled_kind, error);
+  if (header.neurons != neurons_ || header.tile_size != tile_size_
+      || header.tiles != tiles()) {
+    throw error("Number of neurons and tile size must be: "
+                + std::to_string(neurons_) + ", " + std::to_string(tile_size_)
+                + "\nActual number of neurons and tile size: "
+                + std::to_string(header.neurons) + ", "
+                + std::to_string(header.tile_size));
+  }
+
+  struct stat status;
+  if (::fstat(descriptor_, &status) == -1
+      || static_cast<std::size_t>(status.st_size)
+             != sizeof(header) + tiles() * tile_bytes_()) {
+    throw error("Truncated file.");
+  }
+}
+
+std::size_t Tiled_Weight_Matrix::neurons() const
+{
+  return neurons_;
+}
+
+std::size_t Tiled_Weight_Matrix::tile_size() const
+{
+  return tile_size_;
+}
+
+std::size_t Tiled_Weight_Matrix::tiles() const
+{
+  return tile_rows_() * (tile_rows_() + 1) / 2;
+}
+
+std::size_t Tiled_Weight_Matrix::cached_tiles() const
+{
+  return cache_.size();
+}
+
+std::size_t Tiled_Weight_Matrix::max_resident_bytes() const
+{
+  return (cache_tiles_ + 2) * tile_bytes_();
+}
+
+bool Tiled_Weight_Matrix::is_open() const
+{
+  return descriptor_ != -1;
+}
+
+void Tiled_Weight_Matrix::fill_(std::vector<std::vector<int>> const& patterns,
+                                std::filesystem::path const& path,
+                                Dimensions dimensions, Thread_Pool* pool)
+{
+  assert(std::all_of(
+      patterns.begin(), patterns.end(),
+      [this](std::vector<int> const& pattern) {
+        return (pattern.size() == neurons_
+                && std::all_of(pattern.begin(), pattern.end(), [](int value) {
+                     return value == +1 || value == -1;
+                   }));
+      }));
+  assert(dimensions.neurons() == neurons_ || dimensions.neurons() == 0);
+
+  close_();
+
+  Tiled_Weight_Matrix_Header header{};
+  std::memcpy(header.magic, tiled_magic, sizeof(header.magic));
+  header.version   = tiled_version;
+  header.tile_size = static_cast<std::uint32_t>(tile_size_);
+  header.neurons   = neurons_;
+  header.tiles     = tiles();
+  header.width     = dimensions.width;
+  header.height    = dimensions.height;
+
+  // As Weight_Matrix::save_to_file(), the file is written under a temporary
+  // name and then renamed
+  auto temporary_path = path;
+  temporary_path += ".tmp";
+
+  auto descriptor = ::open(temporary_path.c_str(),
+                           O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (descriptor == -1) {
+    throw std::runtime_error("File \"" + path.string()
+                             + "\" not created successfully.");
+  }
+  // On any error the descriptor is closed and the temporary file removed
+  auto discard = [&] {
+    if (descriptor != -1) {
+      ::close(descriptor);
+    }
+    std::error_code ignored;
+    std::filesystem::remove(temporary_path, ignored);
+  };
+  try {
+    fill_file_(patterns, descriptor, header, pool);
+  } catch (std::runtime_error const&) {
+    discard();
+    throw std::runtime_error("File \"" + path.string()
+                             + "\" not written successfully.");
+  } catch (...) {
+    discard();
+    throw;
+  }
+
+  auto closed = ::close(descriptor);
+  descriptor  = -1;
+  if (closed == -1) {
+    discard();
+    throw std::runtime_error("File \"" + path.string()
+                             + "\" not written successfully.");
+  }
+  try {
+    std::filesystem::rename(temporary_path, path);
+  } catch (...) {
+    discard();
+    throw;
+  }
+
+  open_(path);
+
+  assert(std::filesystem::file_size(path)
+         == sizeof(header) + tiles() * tile_bytes_());
+}
+
+void Tiled_Weight_Matrix::fill_file_(
+    std::vector<std::vector<int>> const& patterns, int descriptor,
+    Tiled_Weight_Matrix_Header const& header, Thread_Pool* pool) const
+{
+  if (!write_at(descriptor, &header, sizeof(header), 0)) {
+    throw std::runtime_error("Header not written successfully.");
+  }
+
+  auto P      = patterns.size();
+  auto words  = (P + 63) / 64;
+  auto values = transpose_patterns(patterns, neurons_, words);
+  auto T      = tile_rows_();
+
+  // Pairs of tiles in file order
+  std::vector<std::pair<std::size_t, std::size_t>> tile_pairs;
+  tile_pairs.reserve(tiles());
+  for (std::size_t row_tile{0}; row_tile != T; ++row_tile) {
+    for (auto column_tile{row_tile}; column_tile != T; ++column_tile) {
+      tile_pairs.emplace_back(row_tile, column_tile);
+    }
+  }
+
+  // Each tile is computed in the buffers of its thread, written at its
+  // position and dropped; the diagonal tiles do half the work, hence the
+  // dynamic distribution
+  auto fill_tiles = [&](std::size_t begin, std::size_t end) {
+    std::vector<std::int64_t> sums(tile_size_ * tile_size_);
+    Tile tile(tile_size_ * tile_size_);
+    for (auto index{begin}; index != end; ++index) {
+      auto [row_tile, column_tile] = tile_pairs[index];
+      assert(tile_index_(row_tile, column_tile) == index);
+
+      auto i_begin = row_tile * tile_size_;
+      auto i_end   = std::min(i_begin + tile_size_, neurons_);
+      auto j_begin = column_tile * tile_size_;
+      auto j_end   = std::min(j_begin + tile_size_, neurons_);
+
+      std::fill(tile.begin(), tile.end(), 0.);
+      hebbian_sums(values, P, words, {i_begin, i_end}, {j_begin, j_end},
+                   std::span{sums}, tile_size_);
+
+      // Same division as in compute_weight_ij()
+      for (auto i{i_begin}; i != i_end; ++i) {
+        for (auto j{std::max(j_begin, i + 1)}; j < j_end; ++j) {
+          auto element  = (i - i_begin) * tile_size_ + j - j_begin;
+          tile[element] = static_cast<double>(sums[element])
+                        / static_cast<double>(neurons_);
+        }
+      }
+
+      if (!write_at(descriptor, tile.data(), tile_bytes_(),
+                    sizeof(header) + index * tile_bytes_())) {
+        throw std::runtime_error("Tile " + std::to_string(index)
+                                 + " not written successfully.");
+      }
+    }
+  };
+
+  if (pool == nullptr) {
+    fill_tiles(0, tiles());
+  } else {
+    pool->parallel_for(0, tiles(), Partitioning::dynamic, fill_tiles, 1);
+  }
+}
+
+void Tiled_Weight_Matrix::fill(std::vector<std::vector<int>> const& patterns,
+                               std::size_t neurons,
+                               std::filesystem::path const& matrix_directory,
+                               std::filesystem::path const& name,
+                               Dimensions dimensions)
+{
+  assert(neurons_ == neurons);
+  (void)neurons; // Prevent unused parameter warning
+  assert(std::filesystem::is_directory(matrix_directory));
+
+  auto path = matrix_directory;
+  path.replace_filename(name);
+  fill_(patterns, path, dimensions, nullptr);
+}
+
+void Tiled_Weight_Matrix::fill(std::vector<std::vector<int>> const& patterns,
+                               std::size_t neurons, Thread_Pool& pool,
+                               std::filesystem::path const& matrix_directory,
+                               std::filesystem::path const& name,
+                               Dimensions dimensions)
+{
+  assert(neurons_ == neurons);
+  (void)neurons; // Prevent unused parameter warning
+  assert(std::filesystem::is_directory(matrix_directory));
+
+  auto path = matrix_directory;
+  path.replace_filename(name);
+  fill_(patterns, path, dimensions, &pool);
+}
+
+void Tiled_Weight_Matrix::load_from_file(
+    std::filesystem::path const& matrix_directory,
+    std::filesystem::path const& name, std::size_t neurons)
+{
+  assert(neurons_ == neurons);
+  (void)neurons; // Prevent unused parameter warning
+  assert(std::filesystem::is_directory(matrix_directory));
+
+  auto path = matrix_directory;
+  path.replace_filename(name);
+
+  if (!std::filesystem::is_regular_file(path)) {
+    throw std::runtime_error("File \"" + path.string() + "\" not found.");
+  }
+
+  open_(path);
+}
+
+double Tiled_Weight_Matrix::at(std::size_t i, std::size_t j) const
+{
+  assert(is_open());
+  if (i < 1 || i > neurons_ || j < 1 || j > neurons_) {
+    throw std::runtime_error("Index i or j out of bounds.");
+  }
+  if (i == j) {
+    return 0.;
+  }
+  if (i > j) {
+    std::swap(i, j);
+  }
+
+  auto tile = tile_(tile_index_((i - 1) / tile_size_, (j - 1) / tile_size_));
+
+  return (*tile)[(i - 1) % tile_size_ * tile_size_ + (j - 1) % tile_size_];
+}
+
+void Tiled_Weight_Matrix::accumulate_row(std::size_t i, double factor,
+                                         std::span<double> target) const
+{
+  assert(is_open());
+  assert(i >= 1 && i <= neurons_ && target.size() == neurons_);
+
+  // 0-based position of the neuron, and its row or column in its tiles
+  auto k        = i - 1;
+  auto row_tile = k / tile_size_;
+  auto offset   = k % tile_size_;
+
+  for (std::size_t other_tile{0}; other_tile != tile_rows_(); ++other_tile) {
+    auto j_begin = other_tile * tile_size_;
+    auto j_end   = std::min(j_begin + tile_size_, neurons_);
+
+    // w_kj is in the row offset of the tiles on the right of the diagonal,
+    // and in the column offset of the ones above it
+    auto tile = tile_(other_tile < row_tile
+                          ? tile_index_(other_tile, row_tile)
+                          : tile_index_(row_tile, other_tile));
+    for (auto j{j_begin}; j != j_end; ++j) {
+      if (j < k) {
+        target[j] += factor * (*tile)[(j - j_begin) * tile_size_ + offset];
+      } else if (j > k) {
+        target[j] += factor * (*tile)[offset * tile_size_ + j - j_begin];
+      }
+    }
+  }
+}
+
+void Tiled_Weight_Matrix::multiply(std::vector<int> const& state,
+                                   std::span<double> result) const
+{
+  assert(is_open());
+  assert(state.size() == neurons_ && result.size() == neurons_);
+
+  std::fill(result.begin(), result.end(), 0.);
+
+  auto T = tile_rows_();
+  fetch_tile_(0);
+  for (std::size_t row_tile{0}; row_tile != T; ++row_tile) {
+    auto i_begin = row_tile * tile_size_;
+    auto i_end   = std::min(i_begin + tile_size_, neurons_);
+
+    for (auto column_tile{row_tile}; column_tile != T; ++column_tile) {
+      auto index = tile_index_(row_tile, column_tile);
+      auto tile  = take_tile_();
+      // Read-ahead: the next tile is read while this one is used
+      if (index + 1 != tiles()) {
+        fetch_tile_(index + 1);
+      }
+
+      auto j_begin = column_tile * tile_size_;
+      auto j_end   = std::min(j_begin + tile_size_, neurons_);
+      for (auto i{i_begin}; i != i_end; ++i) {
+        auto row = tile->data() + (i - i_begin) * tile_size_;
+        auto s_i = state[i];
+        auto h_i = result[i];
+        for (auto j{std::max(j_begin, i + 1)}; j < j_end; ++j) {
+          auto w_ij = row[j - j_begin];
+          h_i += w_ij * state[j];
+          result[j] += w_ij * s_i;
+        }
+        result[i] = h_i;
+      }
+
+      cache_tile_(index, std::move(tile), false);
+    }
+  }
+}
+
+} // namespace nn
\ No newline at end of file
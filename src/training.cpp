@@ -5,6 +5,7 @@
 #include "../include/pattern.hpp"
 
 #include <cassert>
+#include <optional>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -58,34 +59,101 @@ void Training::configure_weight_matrix_directory_() const
   }
 }
 
+void Training::validate_weight_matrix_directory_() const
+{
+  auto path = weight_matrix_directory_;
+  path.replace_filename("weight_matrix.bin");
+
+  if (!std::filesystem::is_directory(weight_matrix_directory_)) {
+    throw std::runtime_error("Directory \"" + weight_matrix_directory_.string()
+                             + "\" not found.");
+  }
+  if (!std::filesystem::is_regular_file(path)) {
+    throw std::runtime_error("File \"" + path.string() + "\" not found.");
+  }
+}
+
+Dimensions Training::acquire_dimensions_() const
+{
+  validate_patterns_directory_();
+
+  if (mode_ == Training_Mode::incremental) {
+    validate_weight_matrix_directory_();
+    return read_weight_matrix_dimensions(weight_matrix_directory_
+                                         / "weight_matrix.bin");
+  }
+
+  std::optional<Dimensions> dimensions;
+  for (auto const& file :
+       std::filesystem::directory_iterator(patterns_directory_)) {
+    auto file_dimensions = read_pattern_dimensions(file.path());
+    if (dimensions && file_dimensions != *dimensions) {
+      throw std::runtime_error(
+          "File \"" + patterns_directory_.string()
+          + file.path().filename().string()
+          + "\" has different dimensions.\nDimensions must be: "
+          + std::to_string(dimensions->width) + "x"
+          + std::to_string(dimensions->height) + "\nActual dimensions: "
+          + std::to_string(file_dimensions.width) + "x"
+          + std::to_string(file_dimensions.height));
+    }
+    dimensions = file_dimensions;
+  }
+  assert(dimensions.has_value());
+
+  return *dimensions;
+}
+
 // base_directory can only be "" or "tests/"
-Training::Training(std::filesystem::path const& base_directory)
-    : weight_matrix_{}
-    , patterns_directory_{"../" + base_directory.string() + "patterns/"}
+Training::Training(std::filesystem::path const& base_directory,
+                   Training_Mode mode)
+    : patterns_directory_{"../" + base_directory.string() + "patterns/"}
     , weight_matrix_directory_{"../" + base_directory.string()
                                + "weight_matrix/"}
+    , mode_{mode}
+    , dimensions_{acquire_dimensions_()}
+    , weight_matrix_{dimensions_.neurons()}
+    , pattern_memory_{dimensions_.neurons()}
 {
-  assert(weight_matrix_.neurons() == 4096);
+  assert(weight_matrix_.neurons() == dimensions_.neurons());
+  assert(pattern_memory_.neurons() == dimensions_.neurons());
 
-  validate_patterns_directory_();
-  configure_weight_matrix_directory_();
+  if (mode_ == Training_Mode::full) {
+    configure_weight_matrix_directory_();
+  }
 
   assert(std::filesystem::is_directory(patterns_directory_)
          && !std::filesystem::is_empty(patterns_directory_));
   assert(std::filesystem::is_directory(weight_matrix_directory_)
-         && std::filesystem::is_empty(weight_matrix_directory_));
+         && (mode_ == Training_Mode::incremental
+             || std::filesystem::is_empty(weight_matrix_directory_)));
 }
 
 Training::Training()
     : Training::Training("")
 {}
 
+Training_Mode Training::mode() const
+{
+  return mode_;
+}
+
+Dimensions Training::dimensions() const
+{
+  return dimensions_;
+}
+
 const Weight_Matrix& Training::weight_matrix() const
 {
   return weight_matrix_;
 }
 
-void Training::acquire_and_save_weight_matrix()
+const Pattern_Memory& Training::pattern_memory() const
+{
+  return pattern_memory_;
+}
+
+std::vector<std::vector<int>> Training::acquire_patterns_() const
 {
   std::vector<std::vector<int>> patterns;
 
@@ -95,17 +163,106 @@ void Training::acquire_and_save_weight_matrix()
     assert(file.path().extension() == ".txt");
 
     Pattern pattern;
-    pattern.load_from_file(patterns_directory_, file.path().filename(), 4096);
-    assert(pattern.size() == 4096);
+    pattern.load_from_file(patterns_directory_, file.path().filename(),
+                           dimensions_.neurons());
+    assert(pattern.size() == dimensions_.neurons());
     patterns.push_back(pattern.pattern());
   }
 
-  assert(weight_matrix_.neurons() == 4096);
-  weight_matrix_.fill(patterns, 4096);
-  assert(weight_matrix_.weights().size() == 4095 * 4096 / 2);
+  return patterns;
+}
+
+void Training::acquire_and_save_weight_matrix(Weight_Storage storage)
+{
+  auto patterns = acquire_patterns_();
+
+  Thread_Pool pool;
+  weight_matrix_.fill(patterns, dimensions_.neurons(), pool, storage);
+  assert(weight_matrix_.size() == dimensions_.weights());
+  assert(weight_matrix_.storage() == storage);
+
+  weight_matrix_.save_to_file(weight_matrix_directory_, "weight_matrix.bin",
+                              dimensions_);
+}
+
+void Training::acquire_and_save_pattern_memory()
+{
+  auto patterns = acquire_patterns_();
+
+  pattern_memory_.fill(patterns, dimensions_.neurons());
+  assert(pattern_memory_.size() == patterns.size());
+
+  pattern_memory_.save_to_file(weight_matrix_directory_, "pattern_memory.bin",
+                               dimensions_);
+}
+
+void Training::acquire_and_save_tiled_weight_matrix(std::size_t tile_size)
+{
+  if (tile_size == 0) {
+    throw std::runtime_error("The tiles must hold a weight.");
+  }
+
+  auto patterns = acquire_patterns_();
+
+  // No tile is cached: each one is written and dropped
+  Thread_Pool pool;
+  Tiled_Weight_Matrix tiled_weight_matrix(dimensions_.neurons(), 0, tile_size);
+  tiled_weight_matrix.fill(patterns, dimensions_.neurons(), pool,
+                           weight_matrix_directory_, "weight_matrix.tiles",
+                           dimensions_);
+  assert(tiled_weight_matrix.is_open());
+}
+
+void Training::update_and_save_weight_matrix(
+    std::vector<std::filesystem::path> const& added,
+    std::vector<std::filesystem::path> const& removed)
+{
+  assert(mode_ == Training_Mode::incremental);
+
+  // Every file is read before the matrix is modified
+  auto acquire = [this](std::vector<std::filesystem::path> const& paths) {
+    std::vector<std::vector<int>> patterns;
+    for (auto const& path : paths) {
+      if (!std::filesystem::is_regular_file(path)) {
+        throw std::runtime_error("File \"" + path.string() + "\" not found.");
+      }
+      if (path.extension() != ".txt") {
+        throw std::runtime_error("File \"" + path.string()
+                                 + "\" has an invalid extension.");
+      }
+
+      auto directory = path.has_parent_path() ? path.parent_path() / ""
+                                              : std::filesystem::path{"./"};
+      Pattern pattern;
+      pattern.load_from_file(directory, path.filename(),
+                             dimensions_.neurons());
+      assert(pattern.size() == dimensions_.neurons());
+      patterns.push_back(pattern.pattern());
+    }
+    return patterns;
+  };
+  auto added_patterns   = acquire(added);
+  auto removed_patterns = acquire(removed);
+
+  weight_matrix_.load_from_file(weight_matrix_directory_, "weight_matrix.bin",
+                                dimensions_.neurons());
+  auto storage = weight_matrix_.storage();
+
+  // Removing first keeps the counts as small as possible
+  for (auto const& pattern : removed_patterns) {
+    weight_matrix_.remove_pattern(pattern);
+  }
+  for (auto const& pattern : added_patterns) {
+    weight_matrix_.add_pattern(pattern);
+  }
+  assert(weight_matrix_.size() == dimensions_.weights());
+  assert(weight_matrix_.storage() == storage);
+  (void)storage; // Prevent unused variable warning
 
-  weight_matrix_.save_to_file(weight_matrix_directory_, "weight_matrix.txt",
-                              4096);
+  // The file is replaced, not modified in place, so that a mapped matrix
+  // stays consistent
+  weight_matrix_.save_to_file(weight_matrix_directory_, "weight_matrix.bin",
+                              dimensions_);
 }
 
 } // namespace nn
\ No newline at end of file
@@ -1,16 +1,466 @@
 // All relative paths are relative to the "build/" directory
 
-// This path is the only one relative to "weight_matrix.cpp"
+// These three paths are the only ones relative to "weight_matrix.cpp"
 #include "../include/weight_matrix.hpp"
+#include "../include/binary_format.hpp"
+#include "../include/weight_matrix_kernels.hpp"
 
 #include <algorithm>
+#include <array>
+#include <bit>
 #include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
 #include <fstream>
+#include <map>
+#include <mutex>
 #include <numeric>
 #include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__x86_64__)
+#  include <immintrin.h>
+#endif
 
 namespace nn {
 
+namespace {
+
+constexpr char binary_magic[8]{'H', 'N', 'N', '-', 'W', 'M', '\0', '\0'};
+constexpr std::uint32_t binary_version{1};
+constexpr char binary_kind[]{"binary weight matrix"};
+constexpr std::uint32_t binary_element_double{1};
+constexpr std::uint32_t binary_element_int8{2};
+constexpr std::uint32_t binary_element_int16{3};
+constexpr std::uint32_t binary_layout_packed{1};
+
+// Side of the square tiles of weights computed by fill() and number of 64-bit
+// words of patterns read per pass over a tile: the two slices of rows of a
+// tile take 2 * 64 * 32 * 8 bytes
+constexpr std::size_t tile_size{64};
+constexpr std::size_t tile_depth{32};
+
+// Largest number of patterns whose counts fit in 8-bit and 16-bit integers
+constexpr std::size_t max_patterns_int8{127};
+constexpr std::size_t max_patterns_int16{32'767};
+
+std::uint32_t binary_element_type(std::size_t element_size)
+{
+  switch (element_size) {
+  case sizeof(std::int8_t):
+    return binary_element_int8;
+  case sizeof(std::int16_t):
+    return binary_element_int16;
+  default:
+    assert(element_size == sizeof(double));
+    return binary_element_double;
+  }
+}
+
+template<class Count>
+std::uint64_t compute_counts_checksum(std::span<const Count> counts)
+{
+  return fnv1a_checksum(
+      counts, [](Count count) { return static_cast<std::int64_t>(count); });
+}
+
+// Weight of a stored element, the division being the one of
+// compute_weight_ij() for the counts
+template<class Element>
+double to_weight(Element element, double divisor)
+{
+  if constexpr (std::is_same_v<Element, double>) {
+    return element;
+  } else {
+    return static_cast<double>(element) / divisor;
+  }
+}
+
+// Calls function(i, j, index, product) for every weight of the packed upper
+// triangle, with 0-based i < j, index the position of w_(i+1)(j+1) in the
+// triangle and product = sign * pattern[i] * pattern[j]
+template<class Function>
+void for_each_product(std::vector<int> const& pattern, int sign,
+                      Function&& function)
+{
+  std::size_t index{0};
+  for (std::size_t i{0}; i != pattern.size(); ++i) {
+    auto factor = sign * pattern[i];
+    for (auto j{i + 1}; j != pattern.size(); ++j, ++index) {
+      function(i, j, index, factor * pattern[j]);
+    }
+  }
+}
+
+// Adds sign * pattern[i] * pattern[j] to the counts, unless one of them would
+// leave [-limit, limit]: then the counts are left unchanged and false is
+// returned
+template<class Count>
+bool update_counts(std::span<Count> counts, std::vector<int> const& pattern,
+                   int sign, int limit)
+{
+  bool fits{true};
+  for_each_product(pattern, sign,
+                   [&](std::size_t, std::size_t, std::size_t index,
+                       int product) {
+                     fits = fits && std::abs(counts[index] + product) <= limit;
+                   });
+  if (!fits) {
+    return false;
+  }
+
+  for_each_product(
+      pattern, sign,
+      [&](std::size_t, std::size_t, std::size_t index, int product) {
+        counts[index] = static_cast<Count>(counts[index] + product);
+      });
+  return true;
+}
+
+// Kernels of different_bits_kernels(). The portable version is inlined in
+// different_bits_popcnt(), where std::popcount compiles to the POPCNT
+// instruction.
+[[gnu::always_inline]] inline std::int64_t
+different_bits(const std::uint64_t* first, const std::uint64_t* second,
+               std::size_t words)
+{
+  std::int64_t different{0};
+  for (std::size_t w{0}; w != words; ++w) {
+    different += std::popcount(first[w] ^ second[w]);
+  }
+  return different;
+}
+
+#if defined(__x86_64__)
+
+[[gnu::target("popcnt")]] std::int64_t
+different_bits_popcnt(const std::uint64_t* first, const std::uint64_t* second,
+                      std::size_t words)
+{
+  return different_bits(first, second, words);
+}
+
+// Bytes are counted by looking up their two nibbles in a 16-entry table and
+// summed into 64-bit lanes by _mm256_sad_epu8; the last words % 4 words are
+// left to the portable version
+[[gnu::target("avx2,popcnt")]] std::int64_t
+different_bits_avx2(const std::uint64_t* first, const std::uint64_t* second,
+                    std::size_t words)
+{
+  const auto lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2,
+                                       3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1, 2,
+                                       2, 3, 2, 3, 3, 4);
+  const auto low_nibbles = _mm256_set1_epi8(0x0f);
+
+  auto totals = _mm256_setzero_si256();
+  std::size_t w{0};
+  for (; w + 4 <= words; w += 4) {
+    auto x = _mm256_xor_si256(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first + w)),
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(second + w)));
+    auto low  = _mm256_and_si256(x, low_nibbles);
+    auto high = _mm256_and_si256(_mm256_srli_epi16(x, 4), low_nibbles);
+    auto counts = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, low),
+                                  _mm256_shuffle_epi8(lookup, high));
+    totals      = _mm256_add_epi64(
+        totals, _mm256_sad_epu8(counts, _mm256_setzero_si256()));
+  }
+
+  return _mm256_extract_epi64(totals, 0) + _mm256_extract_epi64(totals, 1)
+       + _mm256_extract_epi64(totals, 2) + _mm256_extract_epi64(totals, 3)
+       + different_bits(first + w, second + w, words - w);
+}
+
+#endif
+
+// Kernels of count_products_kernels(). Row i of the triangle holds c_ij for
+// j > i, which gives sums[i] += sum_j c_ij * s_j and sums[j] += c_ij * s_i,
+// so every count is read once.
+template<class Count>
+void count_products(std::span<const Count> counts,
+                    std::span<const std::int16_t> state,
+                    std::span<std::int32_t> sums)
+{
+  auto N = state.size();
+  std::size_t index{0};
+  for (std::size_t i{0}; i + 1 < N; ++i) {
+    std::int32_t sum_i{0};
+    std::int32_t s_i{state[i]};
+    for (auto j{i + 1}; j != N; ++j, ++index) {
+      std::int32_t c_ij{counts[index]};
+      sum_i += c_ij * state[j];
+      sums[j] += c_ij * s_i;
+    }
+    sums[i] += sum_i;
+  }
+  assert(index == counts.size());
+}
+
+#if defined(__x86_64__)
+
+// 8 counts widened to 16 bits
+[[gnu::target("sse4.1")]] inline __m128i load_counts_sse(const std::int8_t* p)
+{
+  return _mm_cvtepi8_epi16(
+      _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+}
+
+[[gnu::target("sse4.1")]] inline __m128i
+load_counts_sse(const std::int16_t* p)
+{
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+// _mm_madd_epi16 multiplies the 16-bit counts by the +1 or -1 values and adds
+// adjacent products into 32-bit lanes; the counts added to sums[j] are negated
+// when s_i is -1 and widened to 32 bits
+template<class Count>
+[[gnu::target("sse4.1")]] void
+count_products_sse(std::span<const Count> counts,
+                   std::span<const std::int16_t> state,
+                   std::span<std::int32_t> sums)
+{
+  auto N = state.size();
+  std::size_t index{0};
+  for (std::size_t i{0}; i + 1 < N; ++i) {
+    auto negate = _mm_set1_epi16(static_cast<std::int16_t>(state[i]));
+    auto dot    = _mm_setzero_si128();
+    auto j      = i + 1;
+    for (; j + 8 <= N; j += 8, index += 8) {
+      auto c = load_counts_sse(counts.data() + index);
+      dot    = _mm_add_epi32(
+          dot, _mm_madd_epi16(
+                   c, _mm_loadu_si128(
+                          reinterpret_cast<const __m128i*>(&state[j]))));
+      auto signed_c = _mm_sign_epi16(c, negate);
+      auto low      = reinterpret_cast<__m128i*>(&sums[j]);
+      auto high     = reinterpret_cast<__m128i*>(&sums[j + 4]);
+      _mm_storeu_si128(low, _mm_add_epi32(_mm_loadu_si128(low),
+                                          _mm_cvtepi16_epi32(signed_c)));
+      _mm_storeu_si128(
+          high, _mm_add_epi32(_mm_loadu_si128(high),
+                              _mm_cvtepi16_epi32(_mm_srli_si128(signed_c, 8))));
+    }
+    dot = _mm_hadd_epi32(dot, dot);
+    dot = _mm_hadd_epi32(dot, dot);
+    auto sum_i = _mm_cvtsi128_si32(dot);
+    for (; j != N; ++j, ++index) {
+      std::int32_t c_ij{counts[index]};
+      sum_i += c_ij * state[j];
+      sums[j] += c_ij * state[i];
+    }
+    sums[i] += sum_i;
+  }
+  assert(index == counts.size());
+}
+
+// 16 counts widened to 16 bits
+[[gnu::target("avx2")]] inline __m256i load_counts_avx2(const std::int8_t* p)
+{
+  return _mm256_cvtepi8_epi16(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+}
+
+[[gnu::target("avx2")]] inline __m256i
+load_counts_avx2(const std::int16_t* p)
+{
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+// As count_products_sse() with 256-bit registers
+template<class Count>
+[[gnu::target("avx2")]] void
+count_products_avx2(std::span<const Count> counts,
+                    std::span<const std::int16_t> state,
+                    std::span<std::int32_t> sums)
+{
+  auto N = state.size();
+  std::size_t index{0};
+  for (std::size_t i{0}; i + 1 < N; ++i) {
+    auto negate = _mm256_set1_epi16(static_cast<std::int16_t>(state[i]));
+    auto dot    = _mm256_setzero_si256();
+    auto j      = i + 1;
+    for (; j + 16 <= N; j += 16, index += 16) {
+      auto c = load_counts_avx2(counts.data() + index);
+      dot    = _mm256_add_epi32(
+          dot, _mm256_madd_epi16(
+                   c, _mm256_loadu_si256(
+                          reinterpret_cast<const __m256i*>(&state[j]))));
+      auto signed_c = _mm256_sign_epi16(c, negate);
+      auto low      = reinterpret_cast<__m256i*>(&sums[j]);
+      auto high     = reinterpret_cast<__m256i*>(&sums[j + 8]);
+      _mm256_storeu_si256(
+          low, _mm256_add_epi32(
+                   _mm256_loadu_si256(low),
+                   _mm256_cvtepi16_epi32(_mm256_castsi256_si128(signed_c))));
+      _mm256_storeu_si256(
+          high,
+          _mm256_add_epi32(
+              _mm256_loadu_si256(high),
+              _mm256_cvtepi16_epi32(_mm256_extracti128_si256(signed_c, 1))));
+    }
+    auto half = _mm_add_epi32(_mm256_castsi256_si128(dot),
+                              _mm256_extracti128_si256(dot, 1));
+    half      = _mm_hadd_epi32(half, half);
+    half      = _mm_hadd_epi32(half, half);
+    auto sum_i = _mm_cvtsi128_si32(half);
+    for (; j != N; ++j, ++index) {
+      std::int32_t c_ij{counts[index]};
+      sum_i += c_ij * state[j];
+      sums[j] += c_ij * state[i];
+    }
+    sums[i] += sum_i;
+  }
+  assert(index == counts.size());
+}
+
+#endif
+
+// Computes the weights w_ij with i in the row_tile-th tile of neurons and
+// j > i in the column_tile-th one (row_tile <= column_tile). Element is
+// double for the weights, an integer type for the counts.
+template<class Element>
+void fill_tile(std::span<Element> weights,
+               std::vector<std::uint64_t> const& values, std::size_t P,
+               std::size_t words, std::size_t N, std::size_t row_tile,
+               std::size_t column_tile)
+{
+  assert(row_tile <= column_tile);
+
+  auto i_begin = row_tile * tile_size;
+  auto i_end   = std::min(i_begin + tile_size, N);
+  auto j_begin = column_tile * tile_size;
+  auto j_end   = std::min(j_begin + tile_size, N);
+
+  std::array<std::int64_t, tile_size * tile_size> sums{};
+  hebbian_sums(values, P, words, {i_begin, i_end}, {j_begin, j_end},
+               std::span{sums}, tile_size);
+
+  // Same division as in compute_weight_ij()
+  for (auto i{i_begin}; i != i_end; ++i) {
+    auto j = std::max(j_begin, i + 1);
+    if (j >= j_end) {
+      continue;
+    }
+    auto index = matrix_to_vector_index(i + 1, j + 1, N);
+    for (; j != j_end; ++j, ++index) {
+      auto sum_ij = sums[(i - i_begin) * tile_size + j - j_begin];
+      if constexpr (std::is_same_v<Element, double>) {
+        weights[index] = static_cast<double>(sum_ij) / static_cast<double>(N);
+      } else {
+        weights[index] = static_cast<Element>(sum_ij);
+      }
+    }
+  }
+}
+
+} // namespace
+
+std::vector<Kernel<Different_Bits>> different_bits_kernels()
+{
+  std::vector<Kernel<Different_Bits>> kernels{{"portable", different_bits}};
+#if defined(__x86_64__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("popcnt")) {
+    kernels.push_back({"popcnt", different_bits_popcnt});
+    if (__builtin_cpu_supports("avx2")) {
+      kernels.push_back({"avx2", different_bits_avx2});
+    }
+  }
+#endif
+  return kernels;
+}
+
+template<class Count>
+std::vector<Kernel<Count_Products<Count>>> count_products_kernels()
+{
+  std::vector<Kernel<Count_Products<Count>>> kernels{
+      {"portable", count_products<Count>}};
+#if defined(__x86_64__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse4.1")) {
+    kernels.push_back({"sse4.1", count_products_sse<Count>});
+    if (__builtin_cpu_supports("avx2")) {
+      kernels.push_back({"avx2", count_products_avx2<Count>});
+    }
+  }
+#endif
+  return kernels;
+}
+
+template std::vector<Kernel<Count_Products<std::int8_t>>>
+count_products_kernels<std::int8_t>();
+
+template std::vector<Kernel<Count_Products<std::int16_t>>>
+count_products_kernels<std::int16_t>();
+
+std::vector<std::uint64_t>
+transpose_patterns(std::vector<std::vector<int>> const& patterns,
+                   std::size_t neurons, std::size_t words)
+{
+  std::vector<std::uint64_t> values(neurons * words, 0);
+  for (std::size_t mu{0}; mu != patterns.size(); ++mu) {
+    auto bit = std::uint64_t{1} << (mu % 64);
+    for (std::size_t i{0}; i != neurons; ++i) {
+      if (patterns[mu][i] == +1) {
+        values[i * words + mu / 64] |= bit;
+      }
+    }
+  }
+  return values;
+}
+
+// sum_mu p_i^mu * p_j^mu = P - 2 * (number of patterns in which they differ),
+// the bitsets being read in slices of tile_depth words so that the rows of a
+// block stay in cache while they are compared
+void hebbian_sums(std::vector<std::uint64_t> const& values, std::size_t P,
+                  std::size_t words,
+                  std::pair<std::size_t, std::size_t> rows,
+                  std::pair<std::size_t, std::size_t> columns,
+                  std::span<std::int64_t> sums, std::size_t stride)
+{
+  auto [i_begin, i_end] = rows;
+  auto [j_begin, j_end] = columns;
+  assert(i_begin <= i_end && j_begin <= j_end);
+  assert(j_end - j_begin <= stride);
+  assert((i_end - i_begin) * stride <= sums.size());
+
+  static const auto count = different_bits_kernels().back().function;
+
+  for (auto i{i_begin}; i != i_end; ++i) {
+    for (auto j{std::max(j_begin, i + 1)}; j < j_end; ++j) {
+      sums[(i - i_begin) * stride + j - j_begin] = 0;
+    }
+  }
+
+  for (std::size_t w_begin{0}; w_begin < words; w_begin += tile_depth) {
+    auto slice = std::min(tile_depth, words - w_begin);
+    for (auto i{i_begin}; i != i_end; ++i) {
+      auto row_i = &values[i * words + w_begin];
+      for (auto j{std::max(j_begin, i + 1)}; j < j_end; ++j) {
+        sums[(i - i_begin) * stride + j - j_begin] +=
+            count(row_i, &values[j * words + w_begin], slice);
+      }
+    }
+  }
+
+  for (auto i{i_begin}; i != i_end; ++i) {
+    for (auto j{std::max(j_begin, i + 1)}; j < j_end; ++j) {
+      auto& sum_ij = sums[(i - i_begin) * stride + j - j_begin];
+      sum_ij       = static_cast<std::int64_t>(P) - 2 * sum_ij;
+      assert(std::abs(sum_ij) <= static_cast<std::int64_t>(P));
+    }
+  }
+}
+
 std::size_t matrix_to_vector_index(std::size_t i, std::size_t j, std::size_t N)
 {
   assert(i >= 1 && i <= N);
@@ -73,43 +523,343 @@ double compute_weight_ij(std::size_t i, std::size_t j, std::size_t N,
   return weight_ij;
 }
 
+std::uint64_t compute_checksum(std::span<const double> weights)
+{
+  return fnv1a_checksum(weights, [](double weight) {
+    return std::bit_cast<std::uint64_t>(weight);
+  });
+}
+
+std::uint64_t compute_checksum(std::span<const std::int8_t> counts)
+{
+  return compute_counts_checksum(counts);
+}
+
+std::uint64_t compute_checksum(std::span<const std::int16_t> counts)
+{
+  return compute_counts_checksum(counts);
+}
+
+Dimensions read_weight_matrix_dimensions(std::filesystem::path const& path)
+{
+  auto header = read_binary_header<Weight_Matrix_Header>(path, binary_magic,
+                                                         binary_kind);
+
+  return binary_header_dimensions(header, path);
+}
+
 Weight_Matrix::Weight_Matrix(std::size_t neurons)
     : neurons_{neurons}
+    , storage_{Weight_Storage::real}
+    , weights_{}
+    , counts8_{}
+    , counts16_{}
+    , layout_{Weight_Layout::packed}
+    , dense_{}
+    , stride_{(neurons + 7) / 8 * 8}
+    , element_size_{sizeof(double)}
+    , mapping_{}
+    , mapped_data_{nullptr}
 {
   assert(neurons_ == neurons);
-  assert(weights_.size() == 0);
+  assert(size() == 0);
+  assert(!is_mapped());
 }
 
 Weight_Matrix::Weight_Matrix()
-    : Weight_Matrix::Weight_Matrix(4096)
+    : Weight_Matrix::Weight_Matrix(default_dimensions.neurons())
 {}
 
-const std::vector<double>& Weight_Matrix::weights() const
+std::span<const double> Weight_Matrix::weights() const
 {
+  assert(storage_ == Weight_Storage::real);
+  assert(layout_ == Weight_Layout::packed);
+
+  if (is_mapped()) {
+    return {static_cast<const double*>(mapped_data_),
+            neurons_ * (neurons_ - 1) / 2};
+  }
   return weights_;
 }
 
+std::size_t Weight_Matrix::size() const
+{
+  if (is_mapped() || !dense_.empty()) {
+    return neurons_ * (neurons_ - 1) / 2;
+  }
+  // At most one of the containers is not empty
+  return weights_.size() + counts8_.size() + counts16_.size();
+}
+
 std::size_t Weight_Matrix::neurons() const
 {
   return neurons_;
 }
 
+Weight_Storage Weight_Matrix::storage() const
+{
+  return storage_;
+}
+
+Weight_Layout Weight_Matrix::layout() const
+{
+  return layout_;
+}
+
+void Weight_Matrix::set_layout(Weight_Layout layout)
+{
+  if (layout == layout_) {
+    return;
+  }
+  if (layout == Weight_Layout::dense && storage_ != Weight_Storage::real) {
+    throw std::runtime_error(
+        "The dense layout is available with the real storage only.");
+  }
+
+  auto filled = size() == neurons_ * (neurons_ - 1) / 2;
+
+  if (layout == Weight_Layout::dense) {
+    decltype(dense_) dense;
+    if (filled) {
+      dense.assign(neurons_ * stride_, 0.);
+      auto weights = this->weights();
+      std::size_t index{0};
+      for (std::size_t i{0}; i != neurons_; ++i) {
+        for (auto j{i + 1}; j != neurons_; ++j, ++index) {
+          dense[i * stride_ + j] = weights[index];
+          dense[j * stride_ + i] = weights[index];
+        }
+      }
+      assert(index == weights.size());
+    }
+    clear_();
+    dense_ = std::move(dense);
+  } else {
+    std::vector<double> weights;
+    if (filled) {
+      weights.reserve(neurons_ * (neurons_ - 1) / 2);
+      for (std::size_t i{1}; i <= neurons_; ++i) {
+        auto row_i = row(i);
+        weights.insert(weights.end(), row_i.begin() + static_cast<long>(i),
+                       row_i.end());
+      }
+    }
+    clear_();
+    weights_ = std::move(weights);
+  }
+  layout_ = layout;
+
+  assert(!filled || size() == neurons_ * (neurons_ - 1) / 2);
+}
+
+std::span<const double> Weight_Matrix::row(std::size_t i) const
+{
+  assert(layout_ == Weight_Layout::dense);
+  assert(dense_.size() == neurons_ * stride_);
+  assert(i >= 1 && i <= neurons_);
+
+  return std::span<const double>{dense_}.subspan((i - 1) * stride_, neurons_);
+}
+
+bool Weight_Matrix::is_mapped() const
+{
+  return mapping_ != nullptr;
+}
+
 double Weight_Matrix::at(std::size_t i, std::size_t j) const
 {
-  assert(weights_.size() == neurons_ * (neurons_ - 1) / 2);
+  assert(size() == neurons_ * (neurons_ - 1) / 2);
 
   assert(i >= 1 && i <= neurons_);
   assert(j >= 1 && j <= neurons_);
 
-  if (i != j) {
-    return weights_[matrix_to_vector_index(i, j, neurons_)];
+  if (layout_ == Weight_Layout::dense) {
+    return row(i)[j - 1];
+  } else if (i != j) {
+    // Same division as in compute_weight_ij() with Weight_Storage::counts
+    return visit([index = matrix_to_vector_index(i, j, neurons_)](
+                     auto elements, double divisor) {
+      return to_weight(elements[index], divisor);
+    });
   } else {
     return 0.;
   }
 }
 
-void Weight_Matrix::fill(std::vector<std::vector<int>> const& patterns,
-                         std::size_t neurons)
+void Weight_Matrix::accumulate_row(std::size_t i, double factor,
+                                   std::span<double> target) const
+{
+  accumulate_row(i, factor, target, 0, neurons_);
+}
+
+void Weight_Matrix::accumulate_row(std::size_t i, double factor,
+                                   std::span<double> target, std::size_t begin,
+                                   std::size_t end) const
+{
+  assert(size() == neurons_ * (neurons_ - 1) / 2);
+  assert(target.size() == neurons_);
+  assert(i >= 1 && i <= neurons_);
+  assert(begin <= end && end <= neurons_);
+
+  if (layout_ == Weight_Layout::dense) {
+    // The diagonal is skipped, as with the packed layout
+    auto row_i = row(i);
+    for (auto j{begin}; j < end; ++j) {
+      if (j != i - 1) {
+        target[j] += factor * row_i[j];
+      }
+    }
+    return;
+  }
+
+  // With Weight_Storage::counts the 1 / N is folded into the factor: for N a
+  // power of two the products are exactly the ones of Weight_Storage::real
+  visit([&](auto elements, double divisor) {
+    auto scale = factor / divisor;
+
+    // w_ji with j < i lies in the j-th row of the packed triangle, the
+    // distance between w_ji and w_(j+1)i being N - j - 1
+    auto j = begin + 1;
+    if (j < i && j <= end) {
+      auto index = matrix_to_vector_index(j, i, neurons_);
+      for (; j < i && j <= end; ++j) {
+        assert(index == matrix_to_vector_index(j, i, neurons_));
+        target[j - 1] += scale * elements[index];
+        index += neurons_ - j - 1;
+      }
+    }
+
+    // w_ij with j > i are contiguous
+    j = std::max(j, i + 1);
+    if (j <= end) {
+      auto row = elements.subspan(matrix_to_vector_index(i, j, neurons_),
+                                  end - j + 1);
+      for (std::size_t k{0}; k != row.size(); ++k) {
+        target[j - 1 + k] += scale * row[k];
+      }
+    }
+  });
+}
+
+double Weight_Matrix::row_product(std::size_t i,
+                                  std::vector<int> const& state) const
+{
+  assert(size() == neurons_ * (neurons_ - 1) / 2);
+  assert(state.size() <= neurons_);
+  assert(i >= 1 && i <= neurons_);
+
+  auto end = state.size();
+
+  // Adding the null diagonal would leave the sum unchanged
+  if (layout_ == Weight_Layout::dense) {
+    auto row_i = row(i);
+    double product{0.};
+    for (std::size_t j{0}; j != end; ++j) {
+      product += row_i[j] * state[j];
+    }
+    return product;
+  }
+
+  return visit([&](auto elements, double divisor) {
+    double product{0.};
+    if (i > 1 && end >= 1) {
+      // w_ji with j < i, at distance N - j - 1 from w_(j+1)i
+      auto index = matrix_to_vector_index(1, i, neurons_);
+      for (std::size_t j{1}; j < i && j <= end; ++j) {
+        product += to_weight(elements[index], divisor) * state[j - 1];
+        index += neurons_ - j - 1;
+      }
+    }
+
+    // w_ij with j > i are contiguous
+    if (i < end) {
+      auto index = matrix_to_vector_index(i, i + 1, neurons_);
+      for (auto j{i + 1}; j <= end; ++j, ++index) {
+        product += to_weight(elements[index], divisor) * state[j - 1];
+      }
+    }
+    return product;
+  });
+}
+
+void Weight_Matrix::multiply(std::vector<int> const& state,
+                             std::span<double> result) const
+{
+  assert(size() == neurons_ * (neurons_ - 1) / 2);
+  assert(state.size() == neurons_);
+  assert(result.size() == neurons_);
+
+  if (layout_ == Weight_Layout::dense) {
+    for (std::size_t i{1}; i <= neurons_; ++i) {
+      result[i - 1] = row_product(i, state);
+    }
+    return;
+  }
+
+  std::fill(result.begin(), result.end(), 0.);
+
+  // When row i is reached result[i - 1] already holds the products with the
+  // weights w_ki, k < i, of the previous rows: the products with w_ij, j > i,
+  // follow in increasing j
+  visit([&](auto elements, double divisor) {
+    std::size_t index{0};
+    for (std::size_t i{1}; i <= neurons_; ++i) {
+      auto s_i = state[i - 1];
+      auto h_i = result[i - 1];
+      for (auto j{i + 1}; j <= neurons_; ++j, ++index) {
+        auto w_ij = to_weight(elements[index], divisor);
+        h_i += w_ij * state[j - 1];
+        result[j - 1] += w_ij * s_i;
+      }
+      result[i - 1] = h_i;
+    }
+    assert(index == elements.size());
+  });
+}
+
+void Weight_Matrix::count_products(std::vector<int> const& state,
+                                   std::span<std::int16_t> values,
+                                   std::span<std::int32_t> sums) const
+{
+  assert(storage_ == Weight_Storage::counts);
+  assert(size() == neurons_ * (neurons_ - 1) / 2);
+  assert(neurons_ <= max_count_products_neurons);
+  assert(state.size() == neurons_);
+  assert(values.size() == neurons_);
+  assert(sums.size() == neurons_);
+
+  std::copy(state.begin(), state.end(), values.begin());
+  std::fill(sums.begin(), sums.end(), 0);
+
+  static const auto products8 =
+      count_products_kernels<std::int8_t>().back().function;
+  static const auto products16 =
+      count_products_kernels<std::int16_t>().back().function;
+  visit([&](auto counts, double) {
+    using Count = typename decltype(counts)::element_type;
+    if constexpr (std::is_same_v<Count, const std::int8_t>) {
+      products8(counts, values, sums);
+    } else if constexpr (std::is_same_v<Count, const std::int16_t>) {
+      products16(counts, values, sums);
+    }
+  });
+}
+
+void Weight_Matrix::clear_()
+{
+  mapping_.reset();
+  mapped_data_ = nullptr;
+  weights_.clear();
+  counts8_.clear();
+  counts16_.clear();
+  dense_.clear();
+  storage_      = Weight_Storage::real;
+  layout_       = Weight_Layout::packed;
+  element_size_ = sizeof(double);
+}
+
+void Weight_Matrix::fill_(std::vector<std::vector<int>> const& patterns,
+                          Weight_Storage storage, Thread_Pool* pool)
 {
   assert(std::all_of(
       patterns.begin(), patterns.end(),
@@ -120,34 +870,187 @@ void Weight_Matrix::fill(std::vector<std::vector<int>> const& patterns,
                    }));
       }));
 
+  if (storage == Weight_Storage::counts
+      && patterns.size() > max_patterns_int16) {
+    throw std::runtime_error(
+        "Too many patterns for the count storage.\nMaximum number of "
+        "patterns: "
+        + std::to_string(max_patterns_int16)
+        + "\nActual number of patterns: " + std::to_string(patterns.size()));
+  }
+
+  clear_();
+  storage_ = storage;
+  if (storage_ == Weight_Storage::real) {
+    weights_.assign((neurons_ - 1) * neurons_ / 2, 0.);
+  } else if (patterns.size() <= max_patterns_int8) {
+    element_size_ = sizeof(std::int8_t);
+    counts8_.assign((neurons_ - 1) * neurons_ / 2, 0);
+  } else {
+    element_size_ = sizeof(std::int16_t);
+    counts16_.assign((neurons_ - 1) * neurons_ / 2, 0);
+  }
+
+  auto words  = (patterns.size() + 63) / 64;
+  auto values = transpose_patterns(patterns, neurons_, words);
+  // Pairs of tiles of the upper triangle, the diagonal ones included
+  auto tiles = (neurons_ + tile_size - 1) / tile_size;
+  std::vector<std::pair<std::size_t, std::size_t>> tile_pairs;
+  tile_pairs.reserve(tiles * (tiles + 1) / 2);
+  for (std::size_t row_tile{0}; row_tile != tiles; ++row_tile) {
+    for (auto column_tile{row_tile}; column_tile != tiles; ++column_tile) {
+      tile_pairs.emplace_back(row_tile, column_tile);
+    }
+  }
+
+  // Tiles write disjoint weights; the diagonal ones do half the work, hence
+  // the dynamic distribution
+  auto fill_tiles = [&](std::size_t begin, std::size_t end) {
+    for (auto t{begin}; t != end; ++t) {
+      auto [row_tile, column_tile] = tile_pairs[t];
+      if (storage_ == Weight_Storage::real) {
+        fill_tile(std::span{weights_}, values, patterns.size(), words,
+                  neurons_, row_tile, column_tile);
+      } else if (element_size_ == sizeof(std::int8_t)) {
+        fill_tile(std::span{counts8_}, values, patterns.size(), words,
+                  neurons_, row_tile, column_tile);
+      } else {
+        fill_tile(std::span{counts16_}, values, patterns.size(), words,
+                  neurons_, row_tile, column_tile);
+      }
+    }
+  };
+  if (pool == nullptr) {
+    fill_tiles(0, tile_pairs.size());
+  } else {
+    pool->parallel_for(0, tile_pairs.size(), Partitioning::dynamic,
+                       fill_tiles, 1);
+  }
+
+  assert(size() == (neurons_ - 1) * neurons_ / 2);
+}
+
+void Weight_Matrix::fill(std::vector<std::vector<int>> const& patterns,
+                         std::size_t neurons, Weight_Storage storage)
+{
   assert(neurons_ == neurons);
+  (void)neurons; // Prevent unused parameter warning
 
-  weights_.clear();
-  assert(weights_.size() == 0);
+  fill_(patterns, storage, nullptr);
+}
 
-  std::size_t i{1};
-  std::size_t j{2};
-  std::generate_n(std::back_inserter(weights_), (neurons - 1) * neurons / 2,
-                  [&i, &j, this, &patterns]() {
-                    auto w = compute_weight_ij(i, j, neurons_, patterns);
-                    increment_ij(i, j, neurons_);
-                    return w;
-                  });
+void Weight_Matrix::fill(std::vector<std::vector<int>> const& patterns,
+                         std::size_t neurons, Thread_Pool& pool,
+                         Weight_Storage storage)
+{
+  assert(neurons_ == neurons);
+  (void)neurons; // Prevent unused parameter warning
 
-  assert(i == neurons_ && j == neurons_ + 1);
-  assert(weights_.size() == (neurons_ - 1) * neurons_ / 2);
+  fill_(patterns, storage, &pool);
 }
 
-void Weight_Matrix::save_to_file(std::filesystem::path const& matrix_directory,
-                                 std::filesystem::path const& name,
-                                 std::size_t neurons) const
+void Weight_Matrix::update_pattern_(std::vector<int> const& pattern,
+                                    int sign)
 {
-  assert(std::filesystem::is_directory(matrix_directory));
+  assert(pattern.size() == neurons_);
+  assert(std::all_of(pattern.begin(), pattern.end(), [](int value) {
+    return value == +1 || value == -1;
+  }));
+  assert(sign == +1 || sign == -1);
 
-  auto path = matrix_directory;
-  path.replace_filename(name);
-  assert(path.extension() == ".txt");
+  if (neurons_ < 2) {
+    return;
+  }
+
+  // The elements are modified in memory, never in the mapped file
+  if (is_mapped()) {
+    visit([this](auto elements, double) {
+      using Element =
+          std::remove_const_t<typename decltype(elements)::element_type>;
+      if constexpr (std::is_same_v<Element, double>) {
+        weights_.assign(elements.begin(), elements.end());
+      } else if constexpr (std::is_same_v<Element, std::int8_t>) {
+        counts8_.assign(elements.begin(), elements.end());
+      } else {
+        counts16_.assign(elements.begin(), elements.end());
+      }
+    });
+    mapping_.reset();
+    mapped_data_ = nullptr;
+  }
+
+  if (size() == 0) {
+    assert(storage_ == Weight_Storage::real);
+    if (layout_ == Weight_Layout::dense) {
+      dense_.assign(neurons_ * stride_, 0.);
+    } else {
+      weights_.assign(neurons_ * (neurons_ - 1) / 2, 0.);
+    }
+  }
+
+  if (storage_ == Weight_Storage::real) {
+    // w_ij * N rounds to the count, which is then divided by N as in
+    // compute_weight_ij()
+    auto divisor = static_cast<double>(neurons_);
+    auto update  = [divisor](double weight, int product) {
+      return (std::round(weight * divisor) + product) / divisor;
+    };
+    if (layout_ == Weight_Layout::dense) {
+      for_each_product(
+          pattern, sign,
+          [&](std::size_t i, std::size_t j, std::size_t, int product) {
+            auto weight = update(dense_[i * stride_ + j], product);
+            dense_[i * stride_ + j] = weight;
+            dense_[j * stride_ + i] = weight;
+          });
+    } else {
+      for_each_product(
+          pattern, sign,
+          [&](std::size_t, std::size_t, std::size_t index, int product) {
+            weights_[index] = update(weights_[index], product);
+          });
+    }
+    return;
+  }
+
+  if (element_size_ == sizeof(std::int8_t)) {
+    if (update_counts(std::span{counts8_}, pattern, sign,
+                      static_cast<int>(max_patterns_int8))) {
+      return;
+    }
+    counts16_.assign(counts8_.begin(), counts8_.end());
+    counts8_.clear();
+    element_size_ = sizeof(std::int16_t);
+  }
+
+  assert(element_size_ == sizeof(std::int16_t));
+  if (!update_counts(std::span{counts16_}, pattern, sign,
+                     static_cast<int>(max_patterns_int16))) {
+    throw std::runtime_error(
+        "Too many patterns for the count storage.\nMaximum number of "
+        "patterns: "
+        + std::to_string(max_patterns_int16));
+  }
+}
+
+void Weight_Matrix::add_pattern(std::vector<int> const& pattern)
+{
+  update_pattern_(pattern, +1);
+
+  assert(size() == neurons_ * (neurons_ - 1) / 2);
+  assert(!is_mapped());
+}
+
+void Weight_Matrix::remove_pattern(std::vector<int> const& pattern)
+{
+  update_pattern_(pattern, -1);
 
+  assert(size() == neurons_ * (neurons_ - 1) / 2);
+  assert(!is_mapped());
+}
+
+void Weight_Matrix::save_to_text_file_(std::filesystem::path const& path) const
+{
   std::ofstream outfile{path};
 
   if (!outfile) {
@@ -157,42 +1060,128 @@ void Weight_Matrix::save_to_file(std::filesystem::path const& matrix_directory,
 
   assert(std::filesystem::is_regular_file(path));
 
-  assert(neurons_ == neurons);
-  assert(weights_.size() == (neurons_ - 1) * neurons_ / 2);
-
-  for (auto weight : weights_) {
-    if (!(outfile << weight << ' ')) {
-      throw std::runtime_error("File \"" + path.string()
-                               + "\" not written successfully.");
+  visit([&](auto elements, double divisor) {
+    for (auto element : elements) {
+      if (!(outfile << static_cast<double>(element) / divisor << ' ')) {
+        throw std::runtime_error("File \"" + path.string()
+                                 + "\" not written successfully.");
+      }
     }
-  }
+  });
 
   // If outfile is not closed here, file at path could be written after the
   // is_empty() check
   outfile.close();
 
-  if (neurons != 0 && neurons != 1) {
+  if (neurons_ != 0 && neurons_ != 1) {
     assert(!std::filesystem::is_empty(path));
   } else {
     assert(std::filesystem::is_empty(path));
   }
 }
 
-void Weight_Matrix::load_from_file(
-    std::filesystem::path const& matrix_directory,
-    std::filesystem::path const& name, std::size_t neurons)
+std::tuple<Weight_Matrix_Header, const void*, std::size_t>
+Weight_Matrix::binary_contents_(Dimensions dimensions) const
 {
-  assert(neurons_ == neurons);
-  weights_.clear();
+  assert(dimensions.neurons() == neurons_ || dimensions.neurons() == 0);
+
+  // The elements are written as stored, doubles or counts
+  auto [data, bytes, checksum] = visit([](auto elements, double) {
+    return std::tuple{static_cast<const void*>(elements.data()),
+                      elements.size_bytes(), compute_checksum(elements)};
+  });
+
+  Weight_Matrix_Header header{};
+  std::memcpy(header.magic, binary_magic, sizeof(header.magic));
+  header.version      = binary_version;
+  header.element_type = binary_element_type(element_size_);
+  header.layout       = binary_layout_packed;
+  header.neurons      = neurons_;
+  header.entries      = size();
+  header.checksum     = checksum;
+  header.width        = dimensions.width;
+  header.height       = dimensions.height;
+
+  return {header, data, bytes};
+}
+
+void Weight_Matrix::save_to_binary_file_(std::filesystem::path const& path,
+                                         Dimensions dimensions) const
+{
+  auto [header, data, bytes] = binary_contents_(dimensions);
+
+  // The matrix is written to a temporary file and then renamed, so that a
+  // process which has the old file mapped keeps reading consistent weights
+  auto temporary_path = path;
+  temporary_path += ".tmp";
+
+  std::ofstream outfile{temporary_path, std::ios::binary};
 
+  if (!outfile) {
+    throw std::runtime_error("File \"" + path.string()
+                             + "\" not created successfully.");
+  }
+
+  if (!outfile.write(reinterpret_cast<const char*>(&header), sizeof(header))
+      || !outfile.write(static_cast<const char*>(data),
+                        static_cast<std::streamsize>(bytes))) {
+    throw std::runtime_error("File \"" + path.string()
+                             + "\" not written successfully.");
+  }
+
+  outfile.close();
+  std::filesystem::rename(temporary_path, path);
+
+  assert(std::filesystem::is_regular_file(path));
+  assert(std::filesystem::file_size(path) == sizeof(header) + bytes);
+}
+
+void Weight_Matrix::save_(std::filesystem::path const& matrix_directory,
+                          std::filesystem::path const& name,
+                          Dimensions dimensions) const
+{
   assert(std::filesystem::is_directory(matrix_directory));
 
   auto path = matrix_directory;
   path.replace_filename(name);
+  assert(path.extension() == ".txt" || path.extension() == ".bin");
 
-  assert(std::filesystem::is_regular_file(path));
-  assert(path.extension() == ".txt");
-  if (neurons != 0 && neurons != 1) {
+  assert(size() == (neurons_ - 1) * neurons_ / 2);
+
+  // Files always store the packed layout
+  if (layout_ == Weight_Layout::dense) {
+    auto packed = *this;
+    packed.set_layout(Weight_Layout::packed);
+    packed.save_(matrix_directory, name, dimensions);
+  } else if (path.extension() == ".bin") {
+    save_to_binary_file_(path, dimensions);
+  } else {
+    save_to_text_file_(path);
+  }
+}
+
+void Weight_Matrix::save_to_file(std::filesystem::path const& matrix_directory,
+                                 std::filesystem::path const& name,
+                                 std::size_t neurons) const
+{
+  assert(neurons_ == neurons);
+  (void)neurons; // Prevent unused parameter warning
+
+  save_(matrix_directory, name, Dimensions{0, 0});
+}
+
+void Weight_Matrix::save_to_file(std::filesystem::path const& matrix_directory,
+                                 std::filesystem::path const& name,
+                                 Dimensions dimensions) const
+{
+  assert(neurons_ == dimensions.neurons());
+
+  save_(matrix_directory, name, dimensions);
+}
+
+void Weight_Matrix::load_from_text_file_(std::filesystem::path const& path)
+{
+  if (neurons_ != 0 && neurons_ != 1) {
     assert(!std::filesystem::is_empty(path));
   } else {
     assert(std::filesystem::is_empty(path));
@@ -216,8 +1205,275 @@ void Weight_Matrix::load_from_file(
         + std::to_string((neurons_ - 1) * neurons_ / 2)
         + "\nActual number of entries: " + std::to_string(weights_.size()));
   }
+}
+
+void Weight_Matrix::load_from_binary_file_(std::filesystem::path const& path)
+{
+  auto descriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (descriptor == -1) {
+    throw std::runtime_error("File \"" + path.string()
+                             + "\" not opened successfully.");
+  }
+
+  map_binary_(descriptor, path.string());
+}
+
+void Weight_Matrix::map_binary_(int descriptor, std::string const& source)
+{
+  struct stat status;
+  if (::fstat(descriptor, &status) == -1) {
+    ::close(descriptor);
+    throw std::runtime_error("File \"" + source
+                             + "\" not opened successfully.");
+  }
+  auto file_size = static_cast<std::size_t>(status.st_size);
+
+  if (file_size < sizeof(Weight_Matrix_Header)) {
+    ::close(descriptor);
+    throw std::runtime_error("Error in file \"" + source
+                             + "\".\nMissing binary header.");
+  }
+
+  auto address =
+      ::mmap(nullptr, file_size, PROT_READ, MAP_SHARED, descriptor, 0);
+  // The mapping stays valid after the file descriptor is closed
+  ::close(descriptor);
+  if (address == MAP_FAILED) {
+    throw std::runtime_error("File \"" + source
+                             + "\" not mapped successfully.");
+  }
+
+  std::shared_ptr<const void> mapping{
+      address, [file_size](const void* mapped) {
+        ::munmap(const_cast<void*>(mapped), file_size);
+      }};
+
+  Weight_Matrix_Header header;
+  std::memcpy(&header, address, sizeof(header));
+
+  auto error = [&source](std::string const& message) {
+    return std::runtime_error("Error in file \"" + source + "\".\n"
+                              + message);
+  };
+
+  check_binary_header(header, binary_magic, binary_version, binary_kind,
+                      error);
+  std::size_t element_size;
+  switch (header.element_type) {
+  case binary_element_double:
+    element_size = sizeof(double);
+    break;
+  case binary_element_int8:
+    element_size = sizeof(std::int8_t);
+    break;
+  case binary_element_int16:
+    element_size = sizeof(std::int16_t);
+    break;
+  default:
+    throw error("Unsupported element type: "
+                + std::to_string(header.element_type));
+  }
+  if (header.layout != binary_layout_packed) {
+    throw error("Unsupported layout: " + std::to_string(header.layout));
+  }
+  if (header.neurons != neurons_
+      || header.entries != (neurons_ - 1) * neurons_ / 2) {
+    throw error("Number of neurons must be: " + std::to_string(neurons_)
+                + "\nActual number of neurons: "
+                + std::to_string(header.neurons));
+  }
+  if (file_size != sizeof(header) + header.entries * element_size) {
+    throw error("File size does not match the number of entries.");
+  }
+
+  auto data = static_cast<const char*>(address) + sizeof(header);
+  std::uint64_t checksum;
+  if (element_size == sizeof(double)) {
+    checksum = compute_checksum(std::span<const double>{
+        reinterpret_cast<const double*>(data), header.entries});
+  } else if (element_size == sizeof(std::int8_t)) {
+    checksum = compute_checksum(std::span<const std::int8_t>{
+        reinterpret_cast<const std::int8_t*>(data), header.entries});
+  } else {
+    checksum = compute_checksum(std::span<const std::int16_t>{
+        reinterpret_cast<const std::int16_t*>(data), header.entries});
+  }
+
+  if (checksum != header.checksum) {
+    throw error("Checksum mismatch.");
+  }
+
+  mapping_      = std::move(mapping);
+  mapped_data_  = data;
+  element_size_ = element_size;
+  storage_      = element_size == sizeof(double) ? Weight_Storage::real
+                                                 : Weight_Storage::counts;
+}
+
+void Weight_Matrix::load_from_file(
+    std::filesystem::path const& matrix_directory,
+    std::filesystem::path const& name, std::size_t neurons,
+    Weight_Layout layout)
+{
+  assert(neurons_ == neurons);
+  (void)neurons; // Prevent unused parameter warning
+  clear_();
+
+  assert(std::filesystem::is_directory(matrix_directory));
+
+  auto path = matrix_directory;
+  path.replace_filename(name);
+
+  assert(std::filesystem::is_regular_file(path));
+  assert(path.extension() == ".txt" || path.extension() == ".bin");
+
+  if (path.extension() == ".bin") {
+    load_from_binary_file_(path);
+  } else {
+    load_from_text_file_(path);
+  }
+  set_layout(layout);
+
+  assert(size() == (neurons_ - 1) * neurons_ / 2);
+  assert(layout_ == layout);
+}
+
+void Weight_Matrix::save_to_shared_memory(std::string const& name,
+                                          Dimensions dimensions) const
+{
+  assert(size() == (neurons_ - 1) * neurons_ / 2);
+
+  // Files and shared memory objects always store the packed layout
+  if (layout_ == Weight_Layout::dense) {
+    auto packed = *this;
+    packed.set_layout(Weight_Layout::packed);
+    packed.save_to_shared_memory(name, dimensions);
+    return;
+  }
+
+  auto [header, data, bytes] = binary_contents_(dimensions);
+
+  // The previous object is unlinked rather than overwritten, so that a
+  // process which has it mapped keeps reading consistent weights
+  ::shm_unlink(name.c_str());
+  auto descriptor = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (descriptor == -1) {
+    throw std::runtime_error("Shared memory object \"" + name
+                             + "\" not created successfully.");
+  }
+
+  auto total = sizeof(header) + bytes;
+  auto address =
+      ::ftruncate(descriptor, static_cast<off_t>(total)) == -1
+          ? MAP_FAILED
+          : ::mmap(nullptr, total, PROT_WRITE, MAP_SHARED, descriptor, 0);
+  ::close(descriptor);
+  if (address == MAP_FAILED) {
+    ::shm_unlink(name.c_str());
+    throw std::runtime_error("Shared memory object \"" + name
+                             + "\" not written successfully.");
+  }
+
+  std::memcpy(address, &header, sizeof(header));
+  if (bytes != 0) {
+    std::memcpy(static_cast<char*>(address) + sizeof(header), data, bytes);
+  }
+  ::munmap(address, total);
+}
+
+void Weight_Matrix::load_from_shared_memory(std::string const& name,
+                                            std::size_t neurons)
+{
+  assert(neurons_ == neurons);
+  (void)neurons; // Prevent unused parameter warning
+  clear_();
+
+  auto descriptor = ::shm_open(name.c_str(), O_RDONLY, 0);
+  if (descriptor == -1) {
+    throw std::runtime_error("Shared memory object \"" + name
+                             + "\" not opened successfully.");
+  }
+
+  map_binary_(descriptor, name);
+
+  assert(is_mapped() && layout_ == Weight_Layout::packed);
+  assert(size() == (neurons_ - 1) * neurons_ / 2);
+}
+
+void remove_shared_weight_matrix(std::string const& name)
+{
+  ::shm_unlink(name.c_str());
+}
+
+Shared_Weight_Matrix
+load_shared_weight_matrix(std::filesystem::path const& path,
+                          std::size_t neurons)
+{
+  // A file is identified by its device, inode and modification time, so that
+  // a matrix saved again, i.e. renamed over the old file, is loaded again
+  struct Entry
+  {
+    dev_t device;
+    ino_t inode;
+    std::int64_t modified;
+    std::size_t neurons;
+    std::weak_ptr<const Weight_Matrix> matrix;
+  };
+  static std::mutex mutex;
+  static std::map<std::string, Entry> entries;
+
+  struct stat status;
+  if (::stat(path.c_str(), &status) == -1) {
+    throw std::runtime_error("File \"" + path.string() + "\" not found.");
+  }
+  auto modified = std::int64_t{status.st_mtim.tv_sec} * 1'000'000'000
+                + status.st_mtim.tv_nsec;
+  auto key = std::filesystem::weakly_canonical(path).string();
+
+  // Must be called with mutex locked
+  auto cached = [&]() -> Shared_Weight_Matrix {
+    auto found = entries.find(key);
+    if (found == entries.end()) {
+      return nullptr;
+    }
+    auto const& entry = found->second;
+    if (entry.device != status.st_dev || entry.inode != status.st_ino
+        || entry.modified != modified || entry.neurons != neurons) {
+      return nullptr;
+    }
+    return entry.matrix.lock();
+  };
+
+  {
+    std::lock_guard lock{mutex};
+    if (auto matrix = cached()) {
+      return matrix;
+    }
+  }
+
+  // The file is loaded without the lock, so that loading a large matrix does
+  // not hold up the users of the other files
+  auto matrix = std::make_shared<Weight_Matrix>(neurons);
+  auto directory = path;
+  directory.remove_filename();
+  matrix->load_from_file(directory, path.filename(), neurons);
+
+  std::lock_guard lock{mutex};
+
+  // Another thread may have loaded the same file meanwhile: its matrix is
+  // kept, so that every handle shares one copy
+  if (auto loaded = cached()) {
+    return loaded;
+  }
+
+  entries[key] = {status.st_dev, status.st_ino, modified, neurons, matrix};
+
+  // Entries whose matrix has been released are dropped
+  std::erase_if(entries, [](auto const& item) {
+    return item.second.matrix.expired();
+  });
 
-  assert(weights_.size() == (neurons_ - 1) * neurons_ / 2);
+  return matrix;
 }
 
 } // namespace nn
\ No newline at end of file
@@ -20,7 +20,9 @@
 #include "../../include/acquisition.hpp"
 #include "../doctest.h"
 
+#include <filesystem>
 #include <fstream>
+#include <iterator>
 #include <string>
 
 TEST_CASE("Testing load, resize and binarize functions on single images")
@@ -179,6 +181,24 @@ TEST_CASE("Testing acquire_and_save_patterns()")
   SUBCASE("Acquiring an under-sized image \"(under_sized.jpg)\"")
   {
     CHECK_THROWS(acq.acquire_and_save_patterns());
+    // The patterns of the images before it, in the order of the names
+    CHECK(acq.patterns().size() == 4);
+
+    // An image after the failed one, which the threads may acquire before
+    // the failure is known
+    std::filesystem::copy_file("../tests/images/source_images/1.jpg",
+                               "../tests/images/source_images/zz.jpg");
+    nn::Acquisition parallel{"tests/"};
+    nn::Thread_Pool pool{3};
+    CHECK_THROWS(parallel.acquire_and_save_patterns(pool, 2));
+    CHECK(parallel.patterns() == acq.patterns());
+    for (auto const& directory :
+         {"../tests/patterns/", "../tests/images/binarized_images/"}) {
+      CHECK(std::distance(std::filesystem::directory_iterator{directory},
+                          std::filesystem::directory_iterator{})
+            == 4);
+    }
+    std::filesystem::remove("../tests/images/source_images/zz.jpg");
     std::filesystem::remove("../tests/images/source_images/under_sized.jpg");
     REQUIRE(!std::filesystem::exists(
         "../tests/images/source_images/under_sized.jpg"));
@@ -198,12 +218,48 @@ TEST_CASE("Testing acquire_and_save_patterns()")
       nn::Pattern pattern;
       pattern.load_from_file("../tests/patterns/", name, 64 * 64);
       CHECK(pattern.size() == 64 * 64);
+      CHECK(nn::read_pattern_dimensions("../tests/patterns/" + name.string())
+            == nn::Dimensions{64, 64});
+      CHECK(pattern == acq.patterns()[static_cast<std::size_t>(i - 1)]);
+      CHECK(std::filesystem::is_regular_file(
+          "../tests/images/binarized_images/" + std::to_string(i) + ".png"));
+    }
+  }
+
+  SUBCASE("Acquiring in parallel")
+  {
+    acq.acquire_and_save_patterns();
+    auto serial = acq.patterns();
+    REQUIRE(serial.size() == 4);
+
+    // Whatever the number of threads and the size of the queues
+    for (auto threads : {1u, 2u, 4u, 8u}) {
+      for (auto capacity : {1u, 3u}) {
+        nn::Acquisition parallel{"tests/"};
+        nn::Thread_Pool pool{threads};
+        parallel.acquire_and_save_patterns(pool, capacity);
+        CHECK(parallel.patterns() == serial);
+
+        for (int i{1}; i != 5; ++i) {
+          nn::Pattern pattern;
+          pattern.load_from_file("../tests/patterns/",
+                                 std::to_string(i) + ".txt", 64 * 64);
+          CHECK(pattern == serial[static_cast<std::size_t>(i - 1)]);
+        }
+      }
     }
+
+    nn::Thread_Pool pool{2};
+    CHECK_THROWS(acq.acquire_and_save_patterns(pool, 0));
   }
 
   SUBCASE("Saving multiple binarized images")
   {
     acq.acquire_and_save_patterns();
+    for (auto const& file : std::filesystem::directory_iterator(
+             "../tests/images/binarized_images/")) {
+      std::filesystem::remove(file.path());
+    }
     acq.save_binarized_images();
 
     for (int i{1}; i != 5; ++i) {
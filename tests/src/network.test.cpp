@@ -0,0 +1,125 @@
+// All relative paths are relative to the "build/" directory
+
+/*
+ * This test does not read or write any file.
+ */
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+
+// These three paths are the only ones relative to "network.test.cpp"
+#include "../../include/network.hpp"
+#include "../doctest.h"
+#include "random_patterns.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+// Checks that Network<Width, Height> gives exactly the results of
+// Generic_Network on probes against weight_matrix
+template<unsigned int Width, unsigned int Height>
+void check_same_results(nn::Weight_Matrix const& weight_matrix,
+                        std::vector<std::vector<int>> const& probes)
+{
+  nn::Network<Width, Height> network{weight_matrix};
+  nn::Generic_Network generic{weight_matrix, {Width, Height}};
+  CHECK(network.dimensions() == nn::Dimensions{Width, Height});
+
+  for (auto const& probe : probes) {
+    CHECK(network.local_fields(probe) == generic.local_fields(probe));
+    CHECK(network.energy(probe) == generic.energy(probe));
+
+    auto state          = probe;
+    auto expected_state = probe;
+    auto iterations     = network.update_dynamics(state, 100);
+    CHECK(iterations == generic.update_dynamics(expected_state, 100));
+    CHECK(state == expected_state);
+
+    // Typed interface
+    typename nn::Network<Width, Height>::State array_state;
+    std::copy(probe.begin(), probe.end(), array_state.begin());
+    CHECK(network.update_dynamics(array_state, 100) == iterations);
+    CHECK(std::equal(array_state.begin(), array_state.end(), state.begin()));
+  }
+}
+
+} // namespace
+
+TEST_CASE("Testing the specialized networks against the generic one")
+{
+  SUBCASE("8x8 network")
+  {
+    auto patterns = random_patterns(5, 64, 1);
+    nn::Weight_Matrix weight_matrix(64);
+    weight_matrix.fill(patterns, 64);
+    check_same_results<8, 8>(weight_matrix, random_patterns(10, 64, 2));
+
+    // Same dynamics as the batch one
+    auto probes   = random_patterns(10, 64, 3);
+    auto expected = probes;
+    auto iterations =
+        nn::batch_network_update_dynamics(expected, weight_matrix, 100);
+    nn::Network<8, 8> network{weight_matrix};
+    for (std::size_t b{0}; b != probes.size(); ++b) {
+      CHECK(network.update_dynamics(probes[b], 100) == iterations[b]);
+      CHECK(probes[b] == expected[b]);
+    }
+  }
+
+  SUBCASE("5x7 network, whose weights are not dyadic")
+  {
+    auto patterns = random_patterns(4, 35, 4);
+    nn::Weight_Matrix weight_matrix(35);
+    weight_matrix.fill(patterns, 35);
+    check_same_results<5, 7>(weight_matrix, random_patterns(10, 35, 5));
+  }
+
+  SUBCASE("Bounded number of iterations")
+  {
+    auto patterns = random_patterns(3, 64, 6);
+    nn::Weight_Matrix weight_matrix(64);
+    weight_matrix.fill(patterns, 64);
+    nn::Network<8, 8> network{weight_matrix};
+    auto state = random_patterns(1, 64, 7).front();
+    CHECK(network.update_dynamics(state, 0) == 0);
+    CHECK(network.update_dynamics(state, 1) == 1);
+  }
+}
+
+TEST_CASE("Testing make_network()")
+{
+  auto patterns = random_patterns(3, 4096, 8);
+  nn::Weight_Matrix weight_matrix;
+  weight_matrix.fill(patterns, 4096);
+
+  auto network = nn::make_network(weight_matrix, {64, 64});
+  CHECK(dynamic_cast<nn::Network<64, 64>*>(network.get()) != nullptr);
+  CHECK(network->dimensions() == nn::Dimensions{64, 64});
+
+  // Other shapes, storages and layouts use the generic path
+  network = nn::make_network(weight_matrix, {128, 32});
+  CHECK(dynamic_cast<nn::Generic_Network*>(network.get()) != nullptr);
+
+  nn::Weight_Matrix counts;
+  counts.fill(patterns, 4096, nn::Weight_Storage::counts);
+  network = nn::make_network(counts, {64, 64});
+  CHECK(dynamic_cast<nn::Generic_Network*>(network.get()) != nullptr);
+  CHECK_THROWS(nn::Network<64, 64>{counts});
+
+  auto dense = weight_matrix;
+  dense.set_layout(nn::Weight_Layout::dense);
+  network = nn::make_network(dense, {64, 64});
+  CHECK(dynamic_cast<nn::Generic_Network*>(network.get()) != nullptr);
+
+  // Same dynamics whatever the path
+  auto probe    = random_patterns(1, 4096, 9).front();
+  auto state    = probe;
+  auto expected = probe;
+  auto iterations =
+      nn::make_network(weight_matrix, {64, 64})->update_dynamics(state, 100);
+  CHECK(network->update_dynamics(expected, 100) == iterations);
+  CHECK(state == expected);
+
+  CHECK_THROWS(nn::make_network(weight_matrix, {32, 32}));
+}
\ No newline at end of file
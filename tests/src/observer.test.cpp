@@ -0,0 +1,118 @@
+// All relative paths are relative to the "build/" directory
+
+/*
+ * This test generates the file "observer.txt" and the patterns and images
+ * "sink.corrupted" and "sink.restored" in "../tests/corrupted_files/", which
+ * are removed during the construction of the nn::Recall object in
+ * "recall.test.cpp".
+ *
+ * Window_Observer is not tested since it requires a display.
+ */
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+
+// These three paths are the only ones relative to "observer.test.cpp"
+#include "../../include/observer.hpp"
+#include "../../include/pattern.hpp"
+#include "../doctest.h"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+TEST_CASE("Testing the console observer")
+{
+  std::ostringstream os;
+  nn::Console_Observer observer{os};
+
+  observer.on_start({+1, -1}, -1.5, -3.);
+  CHECK(os.str() == "Original pattern's energy: -3\nInitial energy: -1.5\n");
+
+  os.str("");
+  observer.on_iteration(1, {+1, +1}, -2.5);
+  CHECK(os.str() == "Iteration 1. Current energy: -2.5\n");
+
+  SUBCASE("Restored pattern")
+  {
+    os.str("");
+    observer.on_finish(1, {+1, +1}, -2.5, 1.);
+    CHECK(os.str()
+          == "Overlap with the original pattern: 1\n"
+             "The original pattern has been restored.\n");
+  }
+
+  SUBCASE("Not restored pattern")
+  {
+    os.str("");
+    observer.on_finish(1, {+1, +1}, -2.5, 0.);
+    CHECK(os.str()
+          == "Overlap with the original pattern: 0\n"
+             "The original pattern has not been restored.\n");
+  }
+}
+
+TEST_CASE("Testing the file observer")
+{
+  {
+    nn::File_Observer observer{"../tests/corrupted_files/observer.txt"};
+    observer.on_start({+1, -1, -1}, 0.5, -1.);
+    observer.on_iteration(1, {+1, +1, -1}, -0.5);
+    observer.on_iteration(2, {+1, +1, +1}, -1.);
+    observer.on_finish(2, {+1, +1, +1}, -1., 1.);
+  }
+
+  std::ifstream infile{"../tests/corrupted_files/observer.txt"};
+  REQUIRE(infile);
+
+  std::string line;
+  REQUIRE(std::getline(infile, line));
+  CHECK(line == "0 0.5 1 -1 -1");
+  REQUIRE(std::getline(infile, line));
+  CHECK(line == "1 -0.5 1 1 -1");
+  REQUIRE(std::getline(infile, line));
+  CHECK(line == "2 -1 1 1 1");
+  CHECK(!std::getline(infile, line));
+
+  CHECK_THROWS(nn::File_Observer{"../non_existing/observer.txt"});
+}
+
+TEST_CASE("Testing the pattern file observer")
+{
+  nn::Pattern_File_Observer observer{"../tests/corrupted_files/", "sink.txt",
+                                     {3, 2}};
+  observer.on_start({+1, -1, -1, +1, +1, -1}, 0., 0.);
+  observer.on_iteration(1, {+1, +1, -1, +1, +1, -1}, 0.);
+  observer.on_finish(1, {+1, +1, +1, +1, +1, +1}, 0., 1.);
+
+  nn::Pattern corrupted;
+  corrupted.load_from_file("../tests/corrupted_files/", "sink.corrupted.txt",
+                           6);
+  CHECK(corrupted.pattern() == std::vector<int>{+1, -1, -1, +1, +1, -1});
+  nn::Pattern restored;
+  restored.load_from_file("../tests/corrupted_files/", "sink.restored.txt", 6);
+  CHECK(restored.pattern() == std::vector<int>(6, +1));
+  CHECK(std::filesystem::is_regular_file(
+      "../tests/corrupted_files/sink.corrupted.png"));
+  CHECK(std::filesystem::is_regular_file(
+      "../tests/corrupted_files/sink.restored.png"));
+
+  CHECK_THROWS(
+      nn::Pattern_File_Observer{"../non_existing/", "sink.txt", {3, 2}});
+}
+
+TEST_CASE("Testing the null observer and the observer list")
+{
+  std::ostringstream first_os;
+  std::ostringstream second_os;
+  nn::Console_Observer first{first_os};
+  nn::Null_Observer null;
+  nn::Console_Observer second{second_os};
+
+  nn::Observer_List observers({&first, &null, &second});
+  observers.on_start({+1}, 0., 0.);
+  observers.on_iteration(1, {-1}, 0.);
+  observers.on_finish(1, {-1}, 0., -1.);
+
+  CHECK(!first_os.str().empty());
+  CHECK(first_os.str() == second_os.str());
+}
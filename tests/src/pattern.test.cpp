@@ -31,11 +31,13 @@ TEST_CASE("Testing the conversion from int to sf::Color")
 
 TEST_CASE("Testing construction")
 {
-  std::vector<int> v{1, 2, 1, -4, -33, 100};
+  std::vector<int> v{1, -1, 1, 1, -1, -1};
 
   nn::Pattern pattern{v};
   CHECK(pattern.size() == v.size());
   CHECK(pattern.pattern() == v);
+  CHECK(pattern.words().size() == 1);
+  CHECK(pattern.words()[0] == 0b001101);
 
   std::vector<int> v1{};
 
@@ -79,10 +81,61 @@ TEST_CASE("Testing the add method")
   {
     pattern = pattern1;
     CHECK(pattern.size() == 7);
-    CHECK(std::count(pattern.pattern().begin(), pattern.pattern().end(), +1)
-          == 5);
-    CHECK(std::count(pattern.pattern().begin(), pattern.pattern().end(), -1)
-          == 2);
+    auto values = pattern.pattern();
+    CHECK(std::count(values.begin(), values.end(), +1) == 5);
+    CHECK(std::count(values.begin(), values.end(), -1) == 2);
+  }
+}
+
+TEST_CASE("Testing the bit-packed representation")
+{
+  std::vector<int> values(130);
+  for (std::size_t k{0}; k != values.size(); ++k) {
+    values[k] = (k % 3 == 0) ? -1 : +1;
+  }
+
+  nn::Pattern pattern{values};
+  REQUIRE(pattern.size() == 130);
+  CHECK(pattern.words().size() == 3);
+  CHECK(pattern.pattern() == values);
+  CHECK(pattern.at(0) == -1);
+  CHECK(pattern.at(128) == +1);
+  CHECK(pattern.at(129) == -1);
+  // Unused bits of the last word are cleared
+  CHECK(pattern.words()[2] == 0b01);
+
+  SUBCASE("Setting single values")
+  {
+    pattern.set(0, +1);
+    pattern.set(64, -1);
+    pattern.set(129, -1);
+    CHECK(pattern.at(0) == +1);
+    CHECK(pattern.at(64) == -1);
+    CHECK(pattern.at(129) == -1);
+    CHECK(pattern.size() == 130);
+  }
+
+  SUBCASE("Computing overlap, Hamming distance and flip count")
+  {
+    auto other = pattern;
+    CHECK(other == pattern);
+    CHECK(pattern.hamming_distance(other) == 0);
+    CHECK(pattern.overlap(other) == 1.);
+
+    other.set(1, -1);
+    other.set(70, -other.at(70));
+    other.set(129, +1);
+    CHECK(!(other == pattern));
+    CHECK(pattern.hamming_distance(other) == 3);
+    CHECK(other.hamming_distance(pattern) == 3);
+    CHECK(nn::flip_count(pattern.words(), other.words()) == 3);
+    CHECK(pattern.overlap(other) == doctest::Approx((130. - 6.) / 130.));
+
+    std::vector<int> inverted(130);
+    std::transform(values.begin(), values.end(), inverted.begin(),
+                   [](int value) { return -value; });
+    CHECK(pattern.hamming_distance(nn::Pattern{inverted}) == 130);
+    CHECK(pattern.overlap(nn::Pattern{inverted}) == -1.);
   }
 }
 
@@ -154,6 +207,44 @@ TEST_CASE("Testing input and output")
   }
 }
 
+TEST_CASE("Testing the dimensions")
+{
+  CHECK(nn::Dimensions{256, 256}.neurons() == 65'536);
+  CHECK(nn::Dimensions{256, 256}.weights() == 2'147'450'880);
+  CHECK(nn::square_dimensions(4096) == nn::Dimensions{64, 64});
+  CHECK_THROWS(nn::square_dimensions(10));
+  CHECK_THROWS(nn::square_dimensions(0));
+
+  nn::Pattern pattern{std::vector<int>(10, -1)};
+  pattern.set(3, +1);
+
+  SUBCASE("Saving and loading a pattern with a header")
+  {
+    pattern.save_to_file("../tests/patterns/", "header.txt",
+                         nn::Dimensions{5, 2});
+    CHECK(nn::read_pattern_dimensions("../tests/patterns/header.txt")
+          == nn::Dimensions{5, 2});
+
+    nn::Pattern loaded;
+    loaded.load_from_file("../tests/patterns/", "header.txt", 10);
+    CHECK(loaded == pattern);
+    CHECK_THROWS(loaded.load_from_file("../tests/patterns/", "header.txt", 9));
+  }
+
+  SUBCASE("Files without header")
+  {
+    pattern.save_to_file("../tests/patterns/", "header.txt", 10);
+    CHECK_THROWS(nn::read_pattern_dimensions("../tests/patterns/header.txt"));
+
+    nn::Pattern square{std::vector<int>(16, +1)};
+    square.save_to_file("../tests/patterns/", "header.txt", 16);
+    CHECK(nn::read_pattern_dimensions("../tests/patterns/header.txt")
+          == nn::Dimensions{4, 4});
+  }
+
+  std::filesystem::remove("../tests/patterns/header.txt");
+}
+
 TEST_CASE("Testing creation of images")
 {
   nn::Pattern pattern;
@@ -210,6 +301,18 @@ TEST_CASE("Testing pattern corruption methods")
     });
   }
 
+  SUBCASE("Adding noise with a seed")
+  {
+    auto first  = pattern;
+    auto second = pattern;
+    first.add_noise(0.5, 10, 42);
+    second.add_noise(0.5, 10, 42);
+    CHECK(first == second);
+
+    second.add_noise(0., 10, 7);
+    CHECK(first == second);
+  }
+
   SUBCASE("Cutting pattern")
   {
     pattern.cut(-1, 1, 3, 1, 1, 2, 5);
@@ -0,0 +1,192 @@
+// All relative paths used at runtime are relative to the "build/" directory
+
+/*
+ * This test generates the files "memory.bin", "empty_memory.bin" and
+ * "corrupted_memory.bin" in "../tests/weight_matrix/".
+ * These files are implicitly removed in "training.test.cpp".
+ *
+ * This test does not use the patterns in "../tests/patterns/".
+ */
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+
+// These four paths are the only ones relative to "pattern_memory.test.cpp"
+#include "../../include/pattern_memory.hpp"
+#include "../../include/weight_matrix.hpp"
+#include "../doctest.h"
+#include "random_patterns.hpp"
+
+#include <algorithm>
+#include <fstream>
+
+TEST_CASE("Testing construction")
+{
+  nn::Pattern_Memory pattern_memory;
+  CHECK(pattern_memory.neurons() == 4096);
+  CHECK(pattern_memory.size() == 0);
+
+  nn::Pattern_Memory pattern_memory_1(5);
+  CHECK(pattern_memory_1.neurons() == 5);
+  CHECK(pattern_memory_1.size() == 0);
+}
+
+TEST_CASE("Testing the fill method")
+{
+  SUBCASE("Five neurons and six patterns")
+  {
+    std::vector<std::vector<int>> patterns{
+        {1, -1, 1, 1, 1},   {-1, -1, 1, 1, -1},   {-1, 1, 1, -1, -1},
+        {1, 1, -1, -1, -1}, {-1, -1, -1, -1, -1}, {1, 1, 1, 1, -1}};
+
+    nn::Pattern_Memory pattern_memory(5);
+    pattern_memory.fill(patterns, 5);
+    CHECK(pattern_memory.size() == 6);
+    CHECK(pattern_memory.words(0).size() == 1);
+    CHECK(pattern_memory.words(0)[0] == 0b11101);
+    CHECK(pattern_memory.words(4)[0] == 0);
+
+    // Filling again replaces the patterns
+    pattern_memory.fill({patterns[5]}, 5);
+    CHECK(pattern_memory.size() == 1);
+    CHECK(pattern_memory.words(0)[0] == 0b01111);
+  }
+
+  SUBCASE("Equivalence with the weight matrix")
+  {
+    for (std::size_t neurons : {5u, 64u, 100u}) {
+      auto patterns = random_patterns(7, neurons, 1);
+
+      nn::Pattern_Memory pattern_memory(neurons);
+      pattern_memory.fill(patterns, neurons);
+      nn::Weight_Matrix weight_matrix(neurons);
+      weight_matrix.fill(patterns, neurons);
+
+      for (std::size_t i{1}; i <= neurons; ++i) {
+        for (std::size_t j{1}; j <= neurons; ++j) {
+          REQUIRE(pattern_memory.at(i, j) == weight_matrix.at(i, j));
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE("Testing the overlaps")
+{
+  auto patterns = random_patterns(5, 100, 2);
+  nn::Pattern_Memory pattern_memory(100);
+  pattern_memory.fill(patterns, 100);
+
+  auto state    = random_patterns(1, 100, 3)[0];
+  auto overlaps = pattern_memory.overlaps(nn::Pattern{state});
+  REQUIRE(overlaps.size() == 5);
+  for (std::size_t mu{0}; mu != 5; ++mu) {
+    std::int64_t overlap{0};
+    for (std::size_t i{0}; i != 100; ++i) {
+      overlap += patterns[mu][i] * state[i];
+    }
+    CHECK(overlaps[mu] == overlap);
+  }
+
+  CHECK(pattern_memory.overlaps(nn::Pattern{patterns[2]})[2] == 100);
+}
+
+TEST_CASE("Testing the accumulate methods")
+{
+  auto patterns = random_patterns(6, 64, 4);
+  nn::Pattern_Memory pattern_memory(64);
+  pattern_memory.fill(patterns, 64);
+  nn::Weight_Matrix weight_matrix(64);
+  weight_matrix.fill(patterns, 64);
+
+  SUBCASE("Accumulating a pattern")
+  {
+    std::vector<double> target(64, 1.);
+    pattern_memory.accumulate_pattern(3, .5, target);
+    for (std::size_t j{0}; j != 64; ++j) {
+      CHECK(target[j] == 1. + .5 * patterns[3][j]);
+    }
+  }
+
+  SUBCASE("Accumulating a row")
+  {
+    for (std::size_t i{1}; i <= 64; ++i) {
+      std::vector<double> target(64, 1.);
+      std::vector<double> expected(64, 1.);
+      pattern_memory.accumulate_row(i, -2., target);
+      weight_matrix.accumulate_row(i, -2., expected);
+      REQUIRE(target == expected);
+    }
+  }
+}
+
+TEST_CASE("Testing input and output")
+{
+  auto patterns = random_patterns(3, 100, 5);
+  nn::Pattern_Memory pattern_memory(100);
+  pattern_memory.fill(patterns, 100);
+
+  pattern_memory.save_to_file("../tests/weight_matrix/", "memory.bin", 100);
+  REQUIRE(
+      std::filesystem::is_regular_file("../tests/weight_matrix/memory.bin"));
+  CHECK(std::filesystem::file_size("../tests/weight_matrix/memory.bin")
+        == sizeof(nn::Pattern_Memory_Header) + 3 * 2 * 8);
+
+  SUBCASE("Saving and loading the same patterns")
+  {
+    nn::Pattern_Memory loaded(100);
+    loaded.load_from_file("../tests/weight_matrix/", "memory.bin", 100);
+    REQUIRE(loaded.size() == 3);
+    for (std::size_t mu{0}; mu != 3; ++mu) {
+      CHECK(std::ranges::equal(loaded.words(mu), pattern_memory.words(mu)));
+    }
+  }
+
+  SUBCASE("Saving and loading an empty pattern memory")
+  {
+    nn::Pattern_Memory empty(100);
+    empty.save_to_file("../tests/weight_matrix/", "empty_memory.bin", 100);
+    nn::Pattern_Memory loaded(100);
+    loaded.fill(patterns, 100);
+    loaded.load_from_file("../tests/weight_matrix/", "empty_memory.bin", 100);
+    CHECK(loaded.size() == 0);
+  }
+
+  SUBCASE("Loading with a different number of neurons")
+  {
+    nn::Pattern_Memory loaded(64);
+    CHECK_THROWS(
+        loaded.load_from_file("../tests/weight_matrix/", "memory.bin", 64));
+    CHECK(loaded.size() == 0);
+  }
+
+  SUBCASE("Loading a non existing file")
+  {
+    nn::Pattern_Memory loaded(100);
+    CHECK_THROWS(
+        loaded.load_from_file("../tests/weight_matrix/", "missing.bin", 100));
+  }
+
+  SUBCASE("Loading a corrupted file")
+  {
+    std::filesystem::copy_file(
+        "../tests/weight_matrix/memory.bin",
+        "../tests/weight_matrix/corrupted_memory.bin",
+        std::filesystem::copy_options::overwrite_existing);
+    std::fstream corrupted{"../tests/weight_matrix/corrupted_memory.bin",
+                           std::ios::in | std::ios::out | std::ios::binary};
+    corrupted.seekp(sizeof(nn::Pattern_Memory_Header) + 3);
+    corrupted.put('\x7f');
+    corrupted.close();
+
+    nn::Pattern_Memory loaded(100);
+    CHECK_THROWS(loaded.load_from_file("../tests/weight_matrix/",
+                                       "corrupted_memory.bin", 100));
+    CHECK(loaded.size() == 0);
+
+    // Truncated file
+    std::filesystem::resize_file("../tests/weight_matrix/corrupted_memory.bin",
+                                 sizeof(nn::Pattern_Memory_Header) + 8);
+    CHECK_THROWS(loaded.load_from_file("../tests/weight_matrix/",
+                                       "corrupted_memory.bin", 100));
+  }
+}
@@ -0,0 +1,26 @@
+// All relative paths are relative to the "build/" directory
+
+#ifndef NN_TESTS_RANDOM_PATTERNS_HPP
+#define NN_TESTS_RANDOM_PATTERNS_HPP
+
+#include <cstddef>
+#include <random>
+#include <vector>
+
+// count patterns, or states, of neurons values +1 or -1 drawn with a fixed
+// seed, so that the tests are reproducible
+inline std::vector<std::vector<int>>
+random_patterns(std::size_t count, std::size_t neurons, unsigned int seed)
+{
+  std::default_random_engine engine{seed};
+  std::bernoulli_distribution dist{0.5};
+  std::vector<std::vector<int>> patterns(count, std::vector<int>(neurons));
+  for (auto& pattern : patterns) {
+    for (auto& value : pattern) {
+      value = dist(engine) ? +1 : -1;
+    }
+  }
+  return patterns;
+}
+
+#endif
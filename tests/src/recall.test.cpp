@@ -2,11 +2,14 @@
 
 /*
  * This test takes as input the patterns "1.txt", "2.txt", "3.txt", "4.txt" in
- * "../tests/patterns/" the weight matrix "weight_matrix.txt" in
- * "../tests/weight_matrix/" and generates the output files in
+ * "../tests/patterns/" the weight matrix "weight_matrix.bin", the pattern
+ * memory "pattern_memory.bin" and the tiled weight matrix "weight_matrix.tiles"
+ * in "../tests/weight_matrix/" and generates the output files in
  * "../tests/corrupted_files/".
  *
- * This test writes temporary files to perform the necessary checks.
+ * This test writes temporary files to perform the necessary checks, and the
+ * files "in_memory.corrupted.*" and "in_memory.restored.*" of the
+ * nn::Pattern_File_Observer in "../tests/corrupted_files/".
  *
  * This test uses implicitly output files of the test in "pattern.test.cpp"
  * controlling their actual removal during the construction of the nn::Recall
@@ -15,14 +18,47 @@
 
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 
-// These two paths are the only ones relative to "recall.test.cpp"
+// These three paths are the only ones relative to "recall.test.cpp"
 #include "../../include/recall.hpp"
 #include "../doctest.h"
+#include "random_patterns.hpp"
 
 #include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
 #include <fstream>
+#include <limits>
+#include <new>
 #include <string>
 
+// Every allocation made through operator new is counted, to check that the
+// iterations of the dynamics allocate nothing
+namespace {
+std::atomic<std::size_t> allocations{0};
+}
+
+// The replacements are not inlined, so that the compiler does not pair the
+// std::malloc() and std::free() they call with the operators of the callers
+[[gnu::noinline]] void* operator new(std::size_t size)
+{
+  ++allocations;
+  if (auto pointer = std::malloc(size == 0 ? 1 : size)) {
+    return pointer;
+  }
+  throw std::bad_alloc{};
+}
+
+[[gnu::noinline]] void operator delete(void* pointer) noexcept
+{
+  std::free(pointer);
+}
+
+[[gnu::noinline]] void operator delete(void* pointer, std::size_t) noexcept
+{
+  std::free(pointer);
+}
+
 TEST_CASE("Testing the free functions")
 {
   nn::Weight_Matrix weight_matrix(4);
@@ -70,6 +106,24 @@ TEST_CASE("Testing the free functions")
     CHECK(nn::hopfield_local_fields(state, weight_matrix) == fields);
   }
 
+  SUBCASE("Checking the incremental update of the local fields")
+  {
+    auto local_fields = nn::hopfield_local_fields(current_state, weight_matrix);
+
+    // current_state -> state flips only the first neuron
+    nn::update_local_fields(local_fields, {1}, state, weight_matrix);
+    CHECK(local_fields == nn::hopfield_local_fields(state, weight_matrix));
+
+    // state -> patterns[1] flips the third and the fourth neuron
+    nn::update_local_fields(local_fields, {3, 4}, patterns[1], weight_matrix);
+    CHECK(local_fields
+          == nn::hopfield_local_fields(patterns[1], weight_matrix));
+
+    nn::update_local_fields(local_fields, {}, patterns[1], weight_matrix);
+    CHECK(local_fields
+          == nn::hopfield_local_fields(patterns[1], weight_matrix));
+  }
+
   SUBCASE("Checking the energy computation")
   {
     CHECK(nn::hopfield_energy(current_state, weight_matrix) == 0.);
@@ -79,6 +133,230 @@ TEST_CASE("Testing the free functions")
   }
 }
 
+// Synchronous dynamics computed from scratch at every iteration
+std::size_t reference_dynamics(std::vector<int>& state,
+                               nn::Weight_Matrix const& weight_matrix,
+                               std::size_t max_iterations)
+{
+  std::size_t iteration{0};
+  while (iteration != max_iterations) {
+    ++iteration;
+    auto fields = nn::hopfield_local_fields(state, weight_matrix);
+    std::vector<int> new_state(state.size());
+    std::transform(fields.begin(), fields.end(), new_state.begin(),
+                   [](double field) { return nn::sign(field); });
+    if (new_state == state) {
+      break;
+    }
+    state = new_state;
+  }
+  return iteration;
+}
+
+TEST_CASE("Testing the batch dynamics")
+{
+  nn::Weight_Matrix weight_matrix(64);
+  weight_matrix.fill(random_patterns(5, 64, 1), 64);
+
+  auto probes = random_patterns(12, 64, 2);
+  // Two probes which are already fixed points
+  auto stored = random_patterns(5, 64, 1);
+  probes.push_back(stored[0]);
+  probes.push_back(stored[3]);
+
+  SUBCASE("Checking the batch local fields")
+  {
+    std::vector<int> batch_states(64 * probes.size());
+    for (std::size_t b{0}; b != probes.size(); ++b) {
+      for (std::size_t i{0}; i != 64; ++i) {
+        batch_states[i * probes.size() + b] = probes[b][i];
+      }
+    }
+
+    std::vector<double> local_fields;
+    nn::hopfield_local_fields(batch_states, probes.size(), weight_matrix,
+                              local_fields);
+    REQUIRE(local_fields.size() == 64 * probes.size());
+
+    for (std::size_t b{0}; b != probes.size(); ++b) {
+      auto fields = nn::hopfield_local_fields(probes[b], weight_matrix);
+      for (std::size_t i{0}; i != 64; ++i) {
+        CHECK(local_fields[i * probes.size() + b] == fields[i]);
+      }
+    }
+  }
+
+  SUBCASE("Checking the batch dynamics against the single-state one")
+  {
+    auto states     = probes;
+    auto iterations = nn::batch_network_update_dynamics(states, weight_matrix,
+                                                        100);
+    REQUIRE(iterations.size() == probes.size());
+
+    for (std::size_t b{0}; b != probes.size(); ++b) {
+      auto state = probes[b];
+      CHECK(iterations[b] == reference_dynamics(state, weight_matrix, 100));
+      CHECK(states[b] == state);
+    }
+    CHECK(iterations[probes.size() - 1] == 1);
+    CHECK(iterations[probes.size() - 2] == 1);
+  }
+
+  SUBCASE("Checking the iteration budget")
+  {
+    auto states     = probes;
+    auto iterations = nn::batch_network_update_dynamics(states, weight_matrix,
+                                                        1);
+    CHECK(std::all_of(iterations.begin(), iterations.end(),
+                      [](std::size_t iteration) { return iteration == 1; }));
+
+    std::vector<std::vector<int>> no_states;
+    CHECK(nn::batch_network_update_dynamics(no_states, weight_matrix, 10)
+              .empty());
+  }
+}
+
+TEST_CASE("Testing the parallel free functions")
+{
+  nn::Weight_Matrix weight_matrix(100);
+  weight_matrix.fill(random_patterns(7, 100, 3), 100);
+
+  auto state      = random_patterns(1, 100, 4)[0];
+  auto new_state  = random_patterns(1, 100, 5)[0];
+  auto fields     = nn::hopfield_local_fields(state, weight_matrix);
+  auto energy     = nn::hopfield_energy(state, weight_matrix);
+  auto new_fields = fields;
+  std::vector<std::size_t> flipped;
+  for (std::size_t i{1}; i <= 100; ++i) {
+    if (state[i - 1] != new_state[i - 1]) {
+      flipped.push_back(i);
+    }
+  }
+  nn::update_local_fields(new_fields, flipped, new_state, weight_matrix);
+
+  for (std::size_t threads : {1u, 2u, 3u, 5u}) {
+    nn::Thread_Pool pool(threads);
+    for (auto partitioning :
+         {nn::Partitioning::blocked, nn::Partitioning::dynamic}) {
+      CHECK(nn::hopfield_local_fields(state, weight_matrix, pool, partitioning)
+            == fields);
+      CHECK(nn::hopfield_energy(state, weight_matrix, pool, partitioning)
+            == energy);
+
+      auto updated = fields;
+      nn::update_local_fields(updated, flipped, new_state, weight_matrix, pool,
+                              partitioning);
+      CHECK(updated == new_fields);
+    }
+  }
+}
+
+TEST_CASE("Testing the pattern memory free functions")
+{
+  auto patterns = random_patterns(5, 64, 6);
+  nn::Weight_Matrix weight_matrix(64);
+  weight_matrix.fill(patterns, 64);
+  nn::Pattern_Memory pattern_memory(64);
+  pattern_memory.fill(patterns, 64);
+
+  for (auto const& state : random_patterns(10, 64, 7)) {
+    auto fields = nn::hopfield_local_fields(state, pattern_memory);
+    CHECK(fields == nn::hopfield_local_fields(state, weight_matrix));
+    CHECK(nn::hopfield_energy(state, pattern_memory)
+          == nn::hopfield_energy(state, weight_matrix));
+
+    // Flipping the neurons towards the first pattern
+    std::vector<std::size_t> flipped;
+    for (std::size_t i{1}; i <= 64; ++i) {
+      if (state[i - 1] != patterns[0][i - 1]) {
+        flipped.push_back(i);
+      }
+    }
+    nn::update_local_fields(fields, flipped, patterns[0], pattern_memory);
+    CHECK(fields == nn::hopfield_local_fields(patterns[0], weight_matrix));
+  }
+
+  CHECK(nn::hopfield_energy(patterns[0], pattern_memory)
+        == nn::hopfield_energy(patterns[0], weight_matrix));
+}
+
+TEST_CASE("Testing the free functions with the count storage")
+{
+  auto patterns = random_patterns(5, 64, 8);
+  nn::Weight_Matrix weight_matrix(64);
+  weight_matrix.fill(patterns, 64);
+  nn::Weight_Matrix counts(64);
+  counts.fill(patterns, 64, nn::Weight_Storage::counts);
+  REQUIRE(counts.storage() == nn::Weight_Storage::counts);
+
+  // N is a power of two: the results are bit-identical
+  auto probes = random_patterns(10, 64, 9);
+  for (auto const& state : probes) {
+    CHECK(nn::hopfield_local_fields(state, counts)
+          == nn::hopfield_local_fields(state, weight_matrix));
+    CHECK(nn::hopfield_energy(state, counts)
+          == nn::hopfield_energy(state, weight_matrix));
+
+    auto fields = nn::hopfield_local_fields(state, counts);
+    std::vector<std::size_t> flipped;
+    for (std::size_t i{1}; i <= 64; ++i) {
+      if (state[i - 1] != patterns[0][i - 1]) {
+        flipped.push_back(i);
+      }
+    }
+    nn::update_local_fields(fields, flipped, patterns[0], counts);
+    CHECK(fields == nn::hopfield_local_fields(patterns[0], weight_matrix));
+  }
+
+  auto states     = probes;
+  auto iterations = nn::batch_network_update_dynamics(states, counts, 100);
+  auto expected   = probes;
+  CHECK(iterations
+        == nn::batch_network_update_dynamics(expected, weight_matrix, 100));
+  CHECK(states == expected);
+}
+
+TEST_CASE("Testing the free functions with the dense layout")
+{
+  auto patterns = random_patterns(5, 60, 10);
+  nn::Weight_Matrix weight_matrix(60);
+  weight_matrix.fill(patterns, 60);
+  nn::Weight_Matrix dense = weight_matrix;
+  dense.set_layout(nn::Weight_Layout::dense);
+
+  // The additions are the same with both layouts, for any N
+  auto probes = random_patterns(6, 60, 11);
+  nn::Thread_Pool pool(3);
+  for (auto const& state : probes) {
+    auto fields = nn::hopfield_local_fields(state, weight_matrix);
+    CHECK(nn::hopfield_local_fields(state, dense) == fields);
+    CHECK(nn::hopfield_local_fields(state, dense, pool,
+                                    nn::Partitioning::blocked)
+          == fields);
+    CHECK(nn::hopfield_energy(state, dense)
+          == nn::hopfield_energy(state, weight_matrix));
+
+    std::vector<std::size_t> flipped;
+    for (std::size_t i{1}; i <= 60; ++i) {
+      if (state[i - 1] != patterns[0][i - 1]) {
+        flipped.push_back(i);
+      }
+    }
+    auto updated = fields;
+    nn::update_local_fields(fields, flipped, patterns[0], weight_matrix);
+    nn::update_local_fields(updated, flipped, patterns[0], dense, pool,
+                            nn::Partitioning::dynamic);
+    CHECK(updated == fields);
+  }
+
+  auto states     = probes;
+  auto iterations = nn::batch_network_update_dynamics(states, dense, 100);
+  auto expected   = probes;
+  CHECK(iterations
+        == nn::batch_network_update_dynamics(expected, weight_matrix, 100));
+  CHECK(states == expected);
+}
+
 TEST_CASE("Testing the Recall class on invalid directories")
 {
   SUBCASE("Non existing patterns and weight matrix directory "
@@ -100,7 +378,8 @@ TEST_CASE("Testing the Recall class on invalid directories")
   }
 
   SUBCASE("Weight matrix directory with a file different from "
-          "\"weight_matrix.txt\"")
+          "\"weight_matrix.bin\", \"weight_matrix.txt\", "
+          "\"pattern_memory.bin\" and \"weight_matrix.tiles\"")
   {
     std::ofstream other{"../tests/weight_matrix/other.txt"};
     CHECK_THROWS(nn::Recall("tests/"));
@@ -167,6 +446,7 @@ TEST_CASE("Testing corrupt_pattern()")
 
   SUBCASE("Corrupting and saving all the patterns in the directory")
   {
+    REQUIRE(recall.dimensions() == nn::Dimensions{64, 64});
     for (int i{1}; i != 5; ++i) {
       std::filesystem::path name{std::to_string(i) + ".txt"};
 
@@ -250,6 +530,435 @@ TEST_CASE("Testing network_update_dynamics()")
   }
 }
 
+// Checks the sequence of calls made by network_update_dynamics()
+class Checking_Observer : public nn::Observer
+{
+ public:
+  std::size_t starts{0};
+  std::size_t iterations{0};
+  std::size_t finishes{0};
+  std::vector<int> last_state{};
+  double last_energy{0.};
+
+  void on_start(std::vector<int> const& state, double energy,
+                double) override
+  {
+    CHECK(starts == 0);
+    CHECK(state.size() == 4096);
+    CHECK(energy == doctest::Approx(nn::hopfield_energy(
+                        state, recall.weight_matrix())));
+    ++starts;
+  }
+
+  void on_iteration(std::size_t iteration, std::vector<int> const& state,
+                    double energy) override
+  {
+    CHECK(starts == 1);
+    CHECK(iteration == iterations + 1);
+    CHECK(energy == doctest::Approx(nn::hopfield_energy(
+                        state, recall.weight_matrix())));
+    ++iterations;
+    last_state  = state;
+    last_energy = energy;
+  }
+
+  void on_finish(std::size_t, std::vector<int> const& state, double energy,
+                 double overlap) override
+  {
+    CHECK(finishes == 0);
+    CHECK(overlap >= -1.);
+    CHECK(overlap <= +1.);
+    if (iterations != 0) {
+      CHECK(state == last_state);
+      CHECK(energy == last_energy);
+    }
+    ++finishes;
+  }
+};
+
+TEST_CASE("Testing network_update_dynamics() with an observer")
+{
+  recall.clear_state();
+  recall.corrupt_pattern("3.txt");
+
+  Checking_Observer observer;
+  recall.network_update_dynamics(observer);
+
+  CHECK(observer.starts == 1);
+  CHECK(observer.finishes == 1);
+  CHECK(observer.iterations < recall.current_iteration());
+  CHECK(observer.last_state == recall.current_state());
+}
+
+// Checks that the energies passed by network_update_dynamics() are exactly
+// the recomputed ones: N = 4096 is a power of two, so the energy kept from the
+// flipped neurons is exact
+class Energy_Observer : public nn::Observer
+{
+ public:
+  std::size_t iterations{0};
+
+  void on_start(std::vector<int> const& state, double energy,
+                double) override
+  {
+    CHECK(energy == nn::hopfield_energy(state, recall.weight_matrix()));
+  }
+
+  void on_iteration(std::size_t, std::vector<int> const& state,
+                    double energy) override
+  {
+    CHECK(energy == nn::hopfield_energy(state, recall.weight_matrix()));
+    CHECK(energy == recall.current_energy());
+    ++iterations;
+  }
+
+  void on_finish(std::size_t, std::vector<int> const& state, double energy,
+                 double) override
+  {
+    CHECK(energy == nn::hopfield_energy(state, recall.weight_matrix()));
+  }
+};
+
+TEST_CASE("Testing the energy kept by the updates")
+{
+  SUBCASE("Synchronous dynamics")
+  {
+    recall.clear_state();
+    recall.corrupt_pattern("1.txt");
+    Energy_Observer observer;
+    recall.network_update_dynamics(observer);
+    CHECK(observer.iterations > 0);
+  }
+
+  SUBCASE("Asynchronous dynamics")
+  {
+    recall.set_update_mode(nn::Update_Mode::asynchronous,
+                           nn::Neuron_Order::random, 5);
+    recall.clear_state();
+    recall.corrupt_pattern("3.txt");
+    Energy_Observer observer;
+    recall.network_update_dynamics(observer);
+    CHECK(observer.iterations > 0);
+    recall.set_update_mode(nn::Update_Mode::synchronous);
+  }
+}
+
+TEST_CASE("Testing the termination of the dynamics")
+{
+  SUBCASE("Fixed point")
+  {
+    recall.clear_state();
+    recall.corrupt_pattern("2.txt");
+    CHECK(recall.network_update_dynamics() == nn::Termination::fixed_point);
+  }
+
+  SUBCASE("Cycle of the synchronous dynamics")
+  {
+    // With w_ij = -p_i * p_j / N every update maps a state close to p to -p
+    // and -p to p, an oscillation of period 2
+    nn::Pattern pattern;
+    pattern.load_from_file("../tests/patterns/", "1.txt", 4096);
+    auto weight_matrix = std::make_shared<nn::Weight_Matrix>(4096);
+    weight_matrix->remove_pattern(pattern.pattern());
+
+    nn::Recall cycling{"tests/", weight_matrix};
+    cycling.corrupt_pattern("1.txt");
+    CHECK(cycling.network_update_dynamics() == nn::Termination::cycle);
+
+    // -p, p and -p again
+    auto negated = pattern.pattern();
+    for (auto& value : negated) {
+      value = -value;
+    }
+    CHECK(cycling.current_iteration() == 3);
+    CHECK(cycling.current_state() == negated);
+    CHECK(cycling.current_energy()
+          == nn::hopfield_energy(negated, *weight_matrix));
+  }
+
+  SUBCASE("Iteration budget")
+  {
+    recall.set_budget(1);
+    recall.clear_state();
+    recall.corrupt_pattern("3.txt");
+    CHECK(recall.network_update_dynamics()
+          == nn::Termination::iteration_budget);
+    CHECK(recall.current_iteration() == 1);
+    recall.set_budget(std::numeric_limits<std::size_t>::max());
+  }
+
+  SUBCASE("Time budget")
+  {
+    recall.set_budget(std::numeric_limits<std::size_t>::max(),
+                      std::chrono::steady_clock::duration::zero());
+    recall.clear_state();
+    recall.corrupt_pattern("3.txt");
+    CHECK(recall.network_update_dynamics() == nn::Termination::time_budget);
+    CHECK(recall.current_iteration() == 0);
+    CHECK(recall.current_state() == recall.noisy_pattern().pattern());
+    recall.set_budget(std::numeric_limits<std::size_t>::max());
+  }
+}
+
+TEST_CASE("Testing the parallel synchronous dynamics")
+{
+  recall.clear_state();
+  recall.corrupt_pattern("4.txt");
+  recall.network_update_dynamics();
+  auto iterations = recall.current_iteration();
+  auto state      = recall.current_state();
+
+  nn::Thread_Pool pool(3);
+  for (auto partitioning :
+       {nn::Partitioning::blocked, nn::Partitioning::dynamic}) {
+    recall.set_thread_pool(&pool, partitioning);
+    recall.clear_state();
+    recall.network_update_dynamics();
+    CHECK(recall.current_iteration() == iterations);
+    CHECK(recall.current_state() == state);
+  }
+
+  recall.set_thread_pool(nullptr);
+}
+
+// Records the number of allocations made so far when the dynamics starts and
+// after every iteration
+class Allocation_Observer : public nn::Observer
+{
+ public:
+  std::size_t at_start{0};
+  std::vector<std::size_t> at_iterations{};
+
+  void on_start(std::vector<int> const&, double, double) override
+  {
+    at_iterations.clear();
+    at_iterations.reserve(1000);
+    at_start = allocations;
+  }
+
+  void on_iteration(std::size_t, std::vector<int> const&, double) override
+  {
+    at_iterations.push_back(allocations);
+  }
+
+  void on_finish(std::size_t, std::vector<int> const&, double,
+                 double) override
+  {}
+};
+
+TEST_CASE("Testing the allocations of the dynamics")
+{
+  nn::Thread_Pool pool(3);
+
+  auto check_no_allocation = [&] {
+    recall.clear_state();
+    recall.corrupt_pattern("2.txt");
+
+    Allocation_Observer observer;
+    recall.network_update_dynamics(observer);
+    CHECK(recall.current_iteration() > 1);
+    for (auto count : observer.at_iterations) {
+      CHECK(count == observer.at_start);
+    }
+
+    // Further updates of the stable state still visit every neuron
+    auto before = allocations.load();
+    for (int update{0}; update != 5; ++update) {
+      CHECK(!recall.single_network_update());
+    }
+    CHECK(allocations == before);
+  };
+
+  SUBCASE("Synchronous dynamics")
+  {
+    check_no_allocation();
+  }
+
+  SUBCASE("Parallel synchronous dynamics")
+  {
+    for (auto partitioning :
+         {nn::Partitioning::blocked, nn::Partitioning::dynamic}) {
+      recall.set_thread_pool(&pool, partitioning);
+      check_no_allocation();
+    }
+    recall.set_thread_pool(nullptr);
+  }
+
+  SUBCASE("Asynchronous dynamics")
+  {
+    recall.set_update_mode(nn::Update_Mode::asynchronous,
+                           nn::Neuron_Order::random, 3);
+    check_no_allocation();
+    recall.set_update_mode(nn::Update_Mode::synchronous);
+  }
+
+  SUBCASE("Energy into a caller's buffer")
+  {
+    std::vector<double> fields(recall.dimensions().neurons());
+    auto expected =
+        nn::hopfield_energy(recall.current_state(), recall.weight_matrix());
+
+    auto before = allocations.load();
+    auto energy = nn::hopfield_energy(recall.current_state(),
+                                      recall.weight_matrix(), fields);
+    CHECK(allocations == before);
+    CHECK(energy == expected);
+  }
+}
+
+TEST_CASE("Testing the pattern memory backend")
+{
+  REQUIRE(recall.backend() == nn::Recall_Backend::weight_matrix);
+
+  nn::Recall pattern_recall{"tests/", nn::Recall_Backend::pattern_memory};
+  REQUIRE(pattern_recall.backend() == nn::Recall_Backend::pattern_memory);
+  CHECK(pattern_recall.pattern_memory().size() == 4);
+  CHECK(pattern_recall.weight_matrix().weights().size() == 0);
+
+  SUBCASE("Synchronous dynamics")
+  {
+    pattern_recall.corrupt_pattern("3.txt");
+    pattern_recall.network_update_dynamics();
+
+    // Same dynamics with the weight matrix, from the same noisy pattern
+    std::vector<std::vector<int>> states{
+        pattern_recall.noisy_pattern().pattern()};
+    auto iterations =
+        nn::batch_network_update_dynamics(states, recall.weight_matrix(), 100);
+    CHECK(pattern_recall.current_state() == states[0]);
+    // The assertions of network_update_dynamics() perform one more update
+    // in Debug builds
+    CHECK(pattern_recall.current_iteration() >= iterations[0]);
+  }
+
+  SUBCASE("Asynchronous dynamics")
+  {
+    pattern_recall.set_update_mode(nn::Update_Mode::asynchronous,
+                                   nn::Neuron_Order::random, 7);
+    pattern_recall.corrupt_pattern("1.txt");
+    pattern_recall.network_update_dynamics();
+    CHECK(pattern_recall.current_iteration() > 0);
+
+    pattern_recall.set_update_mode(nn::Update_Mode::synchronous);
+    CHECK(!pattern_recall.single_network_update());
+  }
+}
+
+TEST_CASE("Testing the shared weight matrix")
+{
+  REQUIRE(recall.weight_matrix().is_mapped());
+
+  // A second Recall object on the same file maps nothing new
+  nn::Recall second{"tests/"};
+  CHECK(second.shared_weight_matrix() == recall.shared_weight_matrix());
+  CHECK(second.weight_matrix().weights().data()
+        == recall.weight_matrix().weights().data());
+
+  // A Recall object built on a handle uses it, whatever the files
+  nn::Recall third{"tests/", recall.shared_weight_matrix()};
+  CHECK(third.shared_weight_matrix() == recall.shared_weight_matrix());
+
+  second.corrupt_pattern("2.txt");
+  second.network_update_dynamics();
+  third.corrupt_pattern("2.txt");
+  third.network_update_dynamics();
+  CHECK(third.current_state() == second.current_state());
+
+  // A handle with another number of neurons is refused
+  auto other = std::make_shared<nn::Weight_Matrix>(4);
+  other->fill({{1, -1, 1, -1}}, 4);
+  CHECK_THROWS(nn::Recall{"tests/", other});
+
+  // Changing the layout copies the matrix and leaves the shared one as it is
+  third.set_weight_layout(nn::Weight_Layout::dense);
+  CHECK(third.shared_weight_matrix() != recall.shared_weight_matrix());
+  CHECK(recall.weight_matrix().layout() == nn::Weight_Layout::packed);
+  third.clear_state();
+  third.network_update_dynamics();
+  CHECK(third.current_state() == second.current_state());
+}
+
+TEST_CASE("Testing the asynchronous update mode")
+{
+  REQUIRE(recall.update_mode() == nn::Update_Mode::synchronous);
+
+  recall.clear_state();
+  recall.corrupt_pattern("2.txt");
+  recall.network_update_dynamics();
+  CHECK(recall.current_iteration() > 0);
+
+  SUBCASE("Fixed neuron order")
+  {
+    recall.set_update_mode(nn::Update_Mode::asynchronous);
+    REQUIRE(recall.update_mode() == nn::Update_Mode::asynchronous);
+    recall.clear_state();
+    recall.network_update_dynamics();
+    CHECK(recall.current_iteration() > 0);
+    CHECK(recall.current_state().size() == 4096);
+
+    // An asynchronous fixed point is a synchronous fixed point as well
+    recall.set_update_mode(nn::Update_Mode::synchronous);
+    auto state = recall.current_state();
+    CHECK(!recall.single_network_update());
+    CHECK(recall.current_state() == state);
+  }
+
+  SUBCASE("Random neuron order with a fixed seed")
+  {
+    recall.set_update_mode(nn::Update_Mode::asynchronous,
+                           nn::Neuron_Order::random, 42);
+    recall.clear_state();
+    recall.network_update_dynamics();
+    auto sweeps = recall.current_iteration();
+    auto state  = recall.current_state();
+    CHECK(sweeps > 0);
+
+    // The same seed reproduces the same dynamics
+    recall.set_update_mode(nn::Update_Mode::asynchronous,
+                           nn::Neuron_Order::random, 42);
+    recall.clear_state();
+    recall.network_update_dynamics();
+    CHECK(recall.current_iteration() == sweeps);
+    CHECK(recall.current_state() == state);
+
+    recall.set_update_mode(nn::Update_Mode::synchronous);
+    CHECK(!recall.single_network_update());
+  }
+
+  recall.set_update_mode(nn::Update_Mode::synchronous);
+}
+
+TEST_CASE("Testing the tiled weight matrix backend")
+{
+  nn::Recall tiled{"tests/", nn::Recall_Backend::tiled_weight_matrix};
+  CHECK(tiled.backend() == nn::Recall_Backend::tiled_weight_matrix);
+  REQUIRE(tiled.dimensions() == nn::Dimensions{64, 64});
+
+  // N is a power of two: the fields streamed from the tiles are exactly the
+  // ones of the weight matrix, in both update modes
+  nn::Pattern probe;
+  probe.load_from_file("../tests/patterns/", "3.txt", 4096);
+  nn::Recall_Options options;
+  options.corruption = nn::Corruption::noise;
+  options.noise      = 0.2;
+  options.seed       = 11;
+  for (auto mode :
+       {nn::Update_Mode::synchronous, nn::Update_Mode::asynchronous}) {
+    tiled.set_update_mode(mode);
+    recall.set_update_mode(mode);
+    auto expected = recall.recall(probe, options);
+    auto result   = tiled.recall(probe, options);
+    CHECK(result.state == expected.state);
+    CHECK(result.iterations == expected.iterations);
+    CHECK(result.energy == expected.energy);
+  }
+  recall.set_update_mode(nn::Update_Mode::synchronous);
+
+  tiled.clear_state();
+  tiled.corrupt_pattern("2.txt");
+  CHECK(tiled.network_update_dynamics() == nn::Termination::fixed_point);
+}
+
 TEST_CASE("Testing the correct saving of the recomposed images")
 {
   for (int i{1}; i != 5; ++i) {
@@ -260,4 +969,142 @@ TEST_CASE("Testing the correct saving of the recomposed images")
     recall.network_update_dynamics();
     recall.save_current_state(name);
   }
-}
\ No newline at end of file
+}
+
+TEST_CASE("Testing the in-memory recall")
+{
+  nn::Recall in_memory{recall.shared_weight_matrix(), {64, 64}};
+  CHECK_THROWS(nn::Recall{recall.shared_weight_matrix(), {64, 32}});
+
+  nn::Pattern probe;
+  probe.load_from_file("../tests/patterns/", "1.txt", 4096);
+
+  SUBCASE("A stored pattern is a fixed point")
+  {
+    auto result = in_memory.recall(probe);
+    CHECK(result.corrupted == probe);
+    CHECK(result.state == probe);
+    CHECK(result.termination == nn::Termination::fixed_point);
+    CHECK(result.iterations == 1);
+    CHECK(result.overlap == 1.);
+  }
+
+  SUBCASE("The same seed gives the same result")
+  {
+    nn::Recall_Options options;
+    options.corruption = nn::Corruption::noise;
+    options.noise      = 0.1;
+    options.seed       = 7;
+
+    auto first  = in_memory.recall(probe, options);
+    auto second = in_memory.recall(probe, options);
+    CHECK(first.corrupted == second.corrupted);
+    CHECK(first.state == second.state);
+    CHECK(first.iterations == second.iterations);
+    CHECK(first.overlap == probe.overlap(first.state));
+    CHECK(first.energy
+          == nn::hopfield_energy(first.state.pattern(),
+                                 *recall.shared_weight_matrix()));
+
+    // The corruption of corrupt_pattern() with the same seed
+    auto noisy = probe;
+    noisy.add_noise(0.1, 4096, 7);
+    CHECK(first.corrupted == noisy);
+  }
+
+  SUBCASE("Saving the probe and the recalled pattern through an observer")
+  {
+    nn::Pattern_File_Observer sink{"../tests/corrupted_files/", "in_memory",
+                                   {64, 64}};
+    nn::Recall_Options options;
+    options.corruption  = nn::Corruption::cut;
+    options.from_row    = 1;
+    options.to_row      = 32;
+    options.from_column = 1;
+    options.to_column   = 64;
+    options.observer    = &sink;
+
+    auto result = in_memory.recall(probe, options);
+    nn::Pattern saved;
+    saved.load_from_file("../tests/corrupted_files/", "in_memory.restored.txt",
+                         4096);
+    CHECK(saved == result.state);
+    saved.load_from_file("../tests/corrupted_files/",
+                         "in_memory.corrupted.txt", 4096);
+    CHECK(saved == result.corrupted);
+  }
+
+  SUBCASE("Invalid probes and corruptions")
+  {
+    nn::Recall_Options options;
+    CHECK_THROWS(in_memory.recall(nn::Pattern{std::vector<int>(100, 1)}));
+
+    options.corruption = nn::Corruption::noise;
+    options.noise      = 1.5;
+    CHECK_THROWS(in_memory.recall(probe, options));
+
+    options.corruption = nn::Corruption::cut;
+    options.from_row   = 0;
+    options.to_row     = 10;
+    options.to_column  = 10;
+    CHECK_THROWS(in_memory.recall(probe, options));
+  }
+}
+
+TEST_CASE("Testing the synchronous dynamics of non-power-of-two size")
+{
+  // An even number of patterns leaves null local fields, whose sign the
+  // rounding of the kept fields could change: every step must follow a full
+  // recompute
+  nn::Dimensions dimensions{10, 10};
+  auto N             = dimensions.neurons();
+  auto patterns      = random_patterns(6, N, 1);
+  auto weight_matrix = std::make_shared<nn::Weight_Matrix>(N);
+  weight_matrix->fill(patterns, N);
+
+  nn::Recall network{weight_matrix, dimensions};
+  nn::Recall_Options options;
+  options.corruption = nn::Corruption::noise;
+  options.noise      = 0.4;
+  for (unsigned int seed{0}; seed != 16; ++seed) {
+    options.seed = seed;
+    network.set_budget(std::numeric_limits<std::size_t>::max());
+    auto result = network.recall(nn::Pattern{patterns[seed % 6]}, options);
+    for (std::size_t budget{1}; budget <= result.iterations; ++budget) {
+      network.set_budget(budget);
+      auto state = result.corrupted.pattern();
+      reference_dynamics(state, *weight_matrix, budget);
+      CHECK(network.recall(nn::Pattern{patterns[seed % 6]}, options)
+                .state.pattern()
+            == state);
+    }
+  }
+}
+
+TEST_CASE("Testing the energy on networks of non-power-of-two size")
+{
+  // The weights c / N are not exact doubles: the energy kept from the flips
+  // is only close to the recomputed one
+  for (auto dimensions : {nn::Dimensions{10, 10}, nn::Dimensions{15, 7}}) {
+    auto N             = dimensions.neurons();
+    auto patterns      = random_patterns(3, N, 31);
+    auto weight_matrix = std::make_shared<nn::Weight_Matrix>(N);
+    weight_matrix->fill(patterns, N);
+
+    nn::Recall network{weight_matrix, dimensions};
+    nn::Recall_Options options;
+    options.corruption = nn::Corruption::noise;
+    options.noise      = 0.3;
+    for (auto mode :
+         {nn::Update_Mode::synchronous, nn::Update_Mode::asynchronous}) {
+      network.set_update_mode(mode);
+      for (unsigned int seed{0}; seed != 8; ++seed) {
+        options.seed = seed;
+        auto result  = network.recall(nn::Pattern{patterns[seed % 3]}, options);
+        CHECK(result.energy
+              == doctest::Approx(nn::hopfield_energy(result.state.pattern(),
+                                                     *weight_matrix)));
+      }
+    }
+  }
+}
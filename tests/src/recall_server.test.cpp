@@ -0,0 +1,330 @@
+// All relative paths are relative to the "build/" directory
+
+/*
+ * This test takes as input the patterns "1.txt", "2.txt", "3.txt", "4.txt" in
+ * "../tests/patterns/" and the weight matrix "weight_matrix.bin" in
+ * "../tests/weight_matrix/", generated by the test in "training.test.cpp".
+ *
+ * The servers listen on sockets created in the temporary directory and
+ * removed by the servers when they stop.
+ */
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+
+// These two paths are the only ones relative to "recall_server.test.cpp"
+#include "../../include/recall_server.hpp"
+#include "../doctest.h"
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+const auto socket_path =
+    std::filesystem::temp_directory_path() / "recall_server.test.sock";
+const auto hurried_socket_path =
+    std::filesystem::temp_directory_path() / "recall_server_hurried.test.sock";
+const auto trickled_socket_path =
+    std::filesystem::temp_directory_path() / "recall_server_trickled.test.sock";
+
+nn::Recall_Request noisy_request(std::string const& name, unsigned int seed)
+{
+  nn::Recall_Request request;
+  request.name       = name;
+  request.corruption = nn::Corruption::noise;
+  request.noise      = 0.1;
+  request.seed       = seed;
+  return request;
+}
+
+// A connection without the framing of Recall_Client, to send partial frames
+int connect_raw(std::filesystem::path const& path)
+{
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  auto name          = path.string();
+  std::copy(name.begin(), name.end(), address.sun_path);
+
+  auto descriptor = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  REQUIRE(descriptor != -1);
+  REQUIRE(::connect(descriptor, reinterpret_cast<sockaddr*>(&address),
+                    sizeof(address))
+          == 0);
+  return descriptor;
+}
+
+} // namespace
+
+TEST_CASE("Testing the encoding of the frames")
+{
+  SUBCASE("Requests")
+  {
+    nn::Recall_Request request;
+    request.pattern        = {1, -1, -1, 1, 1};
+    request.corruption     = nn::Corruption::cut;
+    request.from_row       = 1;
+    request.to_row         = 2;
+    request.from_column    = 3;
+    request.to_column      = 4;
+    request.mode           = nn::Update_Mode::asynchronous;
+    request.max_iterations = 7;
+
+    auto frame = nn::encode_request(request);
+    CHECK(frame.size() == sizeof(nn::Recall_Request_Header) + 5);
+    auto decoded = nn::decode_request(frame);
+    CHECK(decoded.name.empty());
+    CHECK(decoded.pattern == request.pattern);
+    CHECK(decoded.corruption == nn::Corruption::cut);
+    CHECK(decoded.to_column == 4);
+    CHECK(decoded.mode == nn::Update_Mode::asynchronous);
+    CHECK(decoded.max_iterations == 7);
+
+    auto named =
+        nn::decode_request(nn::encode_request(noisy_request("3.txt", 9)));
+    CHECK(named.name == "3.txt");
+    CHECK(named.pattern.empty());
+    CHECK(named.noise == 0.1);
+    CHECK(named.seed == 9);
+  }
+
+  SUBCASE("Responses")
+  {
+    nn::Recall_Response response;
+    response.ok          = true;
+    response.state       = {-1, 1};
+    response.termination = nn::Termination::cycle;
+    response.iterations  = 3;
+    response.energy      = -12.5;
+    response.overlap     = 0.5;
+
+    auto decoded = nn::decode_response(nn::encode_response(response));
+    CHECK(decoded.ok);
+    CHECK(decoded.state == response.state);
+    CHECK(decoded.termination == nn::Termination::cycle);
+    CHECK(decoded.iterations == 3);
+    CHECK(decoded.energy == -12.5);
+    CHECK(decoded.overlap == 0.5);
+
+    nn::Recall_Response error;
+    error.error  = "Refused.";
+    auto refused = nn::decode_response(nn::encode_response(error));
+    CHECK(!refused.ok);
+    CHECK(refused.error == "Refused.");
+  }
+
+  SUBCASE("Malformed frames")
+  {
+    auto frame = nn::encode_request(noisy_request("1.txt", 0));
+    CHECK_THROWS(nn::decode_request(std::span{frame}.first(10)));
+    CHECK_THROWS(nn::decode_request(std::span{frame}.first(frame.size() - 1)));
+    CHECK_THROWS(nn::decode_response(frame));
+
+    auto corrupted = frame;
+    corrupted[0]   = 'X';
+    CHECK_THROWS(nn::decode_request(corrupted));
+
+    // Mode 2 does not exist
+    corrupted     = frame;
+    corrupted[10] = 2;
+    CHECK_THROWS(nn::decode_request(corrupted));
+  }
+}
+
+TEST_CASE("Testing the recall server")
+{
+  nn::Recall_Server server{"tests/", socket_path, 4};
+  REQUIRE(server.dimensions().neurons() == 4096);
+  CHECK(server.workers() == 4);
+  CHECK(std::filesystem::is_socket(socket_path));
+  CHECK_THROWS_AS(nn::Recall_Server("tests/", hurried_socket_path, 0),
+                  std::runtime_error);
+
+  nn::Pattern original;
+  original.load_from_file("../tests/patterns/", "1.txt", 4096);
+
+  SUBCASE("Recalling a stored pattern")
+  {
+    nn::Recall_Client client{socket_path};
+    auto response = client.recall(noisy_request("1.txt", 3));
+    REQUIRE(response.ok);
+    CHECK(response.state.size() == 4096);
+    CHECK(response.termination == nn::Termination::fixed_point);
+    CHECK(response.iterations > 1);
+    CHECK(response.overlap == original.overlap(nn::Pattern{response.state}));
+    CHECK(response.energy
+          == nn::hopfield_energy(response.state, *nn::load_shared_weight_matrix(
+                                     "../tests/weight_matrix/weight_matrix.bin",
+                                     4096)));
+
+    // The same seed gives the same noise, and the same dynamics
+    auto direct = server.recall(noisy_request("1.txt", 3));
+    CHECK(direct.state == response.state);
+    CHECK(direct.iterations == response.iterations);
+  }
+
+  SUBCASE("Recalling a probe")
+  {
+    nn::Recall_Request request;
+    request.pattern     = original.pattern();
+    request.corruption  = nn::Corruption::cut;
+    request.from_row    = 34;
+    request.to_row      = 58;
+    request.from_column = 11;
+    request.to_column   = 35;
+
+    nn::Recall_Client client{socket_path};
+    for (auto mode :
+         {nn::Update_Mode::synchronous, nn::Update_Mode::asynchronous}) {
+      request.mode  = mode;
+      auto response = client.recall(request);
+      REQUIRE(response.ok);
+      CHECK(response.termination == nn::Termination::fixed_point);
+      CHECK(response.overlap > 0.);
+    }
+  }
+
+  SUBCASE("Refusing invalid requests")
+  {
+    nn::Recall_Client client{socket_path};
+    auto bad_value = noisy_request("", 0);
+    bad_value.pattern.assign(4096, 1);
+    bad_value.pattern[5] = 3;
+    auto short_probe     = noisy_request("", 0);
+    short_probe.pattern.assign(100, 1);
+    auto bad_noise  = noisy_request("1.txt", 0);
+    bad_noise.noise = 2.;
+    auto bad_cut    = noisy_request("1.txt", 0);
+    bad_cut.corruption = nn::Corruption::cut;
+    bad_cut.from_row   = 0;
+
+    for (auto const& request :
+         {noisy_request("missing.txt", 0),
+          noisy_request("../patterns/1.txt", 0), noisy_request("1.png", 0),
+          bad_value, short_probe, bad_noise, bad_cut}) {
+      auto response = client.recall(request);
+      CHECK(!response.ok);
+      CHECK(!response.error.empty());
+    }
+
+    // The connection is still usable
+    CHECK(client.recall(noisy_request("2.txt", 1)).ok);
+  }
+
+  SUBCASE("Bounding the dynamics")
+  {
+    auto request           = noisy_request("4.txt", 5);
+    request.max_iterations = 1;
+    auto response          = server.recall(request);
+    REQUIRE(response.ok);
+    CHECK(response.termination == nn::Termination::iteration_budget);
+    CHECK(response.iterations == 1);
+
+    nn::Recall_Server hurried{"tests/", hurried_socket_path, 1, 1000,
+                              std::chrono::steady_clock::duration::zero()};
+    response = hurried.recall(noisy_request("4.txt", 5));
+    REQUIRE(response.ok);
+    CHECK(response.termination == nn::Termination::time_budget);
+    CHECK(response.iterations == 0);
+  }
+
+  SUBCASE("Serving concurrent clients")
+  {
+    constexpr std::size_t clients{8};
+    constexpr std::size_t requests{4};
+    std::vector<std::vector<nn::Recall_Response>> responses(clients);
+    std::vector<std::thread> threads;
+    for (std::size_t c{0}; c != clients; ++c) {
+      threads.emplace_back([&, c] {
+        nn::Recall_Client client{socket_path};
+        for (std::size_t r{0}; r != requests; ++r) {
+          auto name = std::to_string(r + 1) + ".txt";
+          responses[c].push_back(client.recall(
+              noisy_request(name, static_cast<unsigned int>(c))));
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    // Every response is the one of the same request served alone
+    for (std::size_t c{0}; c != clients; ++c) {
+      REQUIRE(responses[c].size() == requests);
+      for (std::size_t r{0}; r != requests; ++r) {
+        auto name = std::to_string(r + 1) + ".txt";
+        auto alone =
+            server.recall(noisy_request(name, static_cast<unsigned int>(c)));
+        CHECK(responses[c][r].ok);
+        CHECK(responses[c][r].state == alone.state);
+        CHECK(responses[c][r].iterations == alone.iterations);
+      }
+    }
+  }
+
+  SUBCASE("Serving a client while more idle clients than workers are open")
+  {
+    std::vector<std::unique_ptr<nn::Recall_Client>> idle;
+    for (std::size_t c{0}; c != 2 * server.workers(); ++c) {
+      idle.push_back(std::make_unique<nn::Recall_Client>(socket_path));
+      if (c % 2 == 0) {
+        CHECK(idle.back()->recall(noisy_request("2.txt", 1)).ok);
+      }
+    }
+
+    nn::Recall_Client client{socket_path};
+    CHECK(client.recall(noisy_request("1.txt", 0)).ok);
+    CHECK(idle.front()->recall(noisy_request("3.txt", 2)).ok);
+  }
+
+  SUBCASE("Stopping the server")
+  {
+    nn::Recall_Client client{socket_path};
+    CHECK(client.recall(noisy_request("1.txt", 0)).ok);
+
+    server.stop();
+    CHECK(!std::filesystem::exists(socket_path));
+    CHECK_THROWS(client.recall(noisy_request("1.txt", 0)));
+    CHECK_THROWS(nn::Recall_Client{socket_path});
+  }
+}
+
+TEST_CASE("Testing the request deadline of the recall server")
+{
+  // A single worker, held by the trickling client until its deadline
+  constexpr std::chrono::milliseconds timeout{200};
+  nn::Recall_Server server{"tests/", trickled_socket_path, 1, 1000,
+                           std::chrono::seconds{10}, timeout};
+
+  auto frame = nn::encode_request(noisy_request("1.txt", 0));
+  auto size  = static_cast<std::uint32_t>(frame.size());
+  auto raw   = connect_raw(trickled_socket_path);
+  REQUIRE(::send(raw, &size, sizeof(size), MSG_NOSIGNAL) == sizeof(size));
+
+  // One byte of the frame every 20 ms, each read() of the server receiving
+  // data well within the timeout, until the server closes the connection
+  auto start  = std::chrono::steady_clock::now();
+  auto closed = false;
+  for (std::size_t b{0}; b != frame.size() && !closed; ++b) {
+    std::this_thread::sleep_for(std::chrono::milliseconds{20});
+    char byte;
+    closed = ::send(raw, &frame[b], 1, MSG_NOSIGNAL) != 1
+          || ::recv(raw, &byte, 1, MSG_DONTWAIT) == 0;
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  ::close(raw);
+
+  CHECK(closed);
+  CHECK(elapsed >= timeout);
+  CHECK(elapsed < 5 * timeout);
+
+  // The worker is free again
+  nn::Recall_Client client{trickled_socket_path};
+  CHECK(client.recall(noisy_request("1.txt", 0)).ok);
+}
@@ -0,0 +1,93 @@
+// All relative paths are relative to the "build/" directory
+
+/*
+ * This test does not read or write any file.
+ */
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+
+// These two paths are the only ones relative to "thread_pool.test.cpp"
+#include "../../include/thread_pool.hpp"
+#include "../doctest.h"
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+TEST_CASE("Testing construction")
+{
+  nn::Thread_Pool pool(3);
+  CHECK(pool.threads() == 3);
+
+  nn::Thread_Pool single(1);
+  CHECK(single.threads() == 1);
+
+  nn::Thread_Pool automatic;
+  CHECK(automatic.threads() >= 1);
+}
+
+TEST_CASE("Testing parallel_for")
+{
+  for (std::size_t threads : {1u, 2u, 3u, 8u}) {
+    nn::Thread_Pool pool(threads);
+
+    for (auto partitioning :
+         {nn::Partitioning::blocked, nn::Partitioning::dynamic}) {
+      SUBCASE("Every index is visited exactly once")
+      {
+        std::vector<std::atomic<int>> visits(1000);
+        pool.parallel_for(
+            10, 1000, partitioning,
+            [&](std::size_t begin, std::size_t end) {
+              REQUIRE(begin < end);
+              for (auto i{begin}; i != end; ++i) {
+                ++visits[i];
+              }
+            },
+            7);
+
+        CHECK(std::all_of(visits.begin(), visits.begin() + 10,
+                          [](auto const& v) { return v == 0; }));
+        CHECK(std::all_of(visits.begin() + 10, visits.end(),
+                          [](auto const& v) { return v == 1; }));
+      }
+
+      SUBCASE("Empty and small ranges")
+      {
+        std::atomic<int> calls{0};
+        pool.parallel_for(5, 5, partitioning,
+                          [&](std::size_t, std::size_t) { ++calls; });
+        CHECK(calls == 0);
+
+        std::atomic<std::size_t> sum{0};
+        pool.parallel_for(0, 2, partitioning,
+                          [&](std::size_t begin, std::size_t end) {
+                            for (auto i{begin}; i != end; ++i) {
+                              sum += i + 1;
+                            }
+                          });
+        CHECK(sum == 3);
+      }
+
+      SUBCASE("Exceptions are propagated to the caller")
+      {
+        CHECK_THROWS_AS(pool.parallel_for(0, 100, partitioning,
+                                          [](std::size_t begin, std::size_t) {
+                                            if (begin == 0) {
+                                              throw std::runtime_error("0");
+                                            }
+                                          }),
+                        std::runtime_error);
+
+        // The pool is still usable after an exception
+        std::atomic<std::size_t> count{0};
+        pool.parallel_for(0, 100, partitioning,
+                          [&](std::size_t begin, std::size_t end) {
+                            count += end - begin;
+                          });
+        CHECK(count == 100);
+      }
+    }
+  }
+}
@@ -0,0 +1,179 @@
+// All relative paths used at runtime are relative to the "build/" directory
+
+/*
+ * This test generates the files "tiled.tiles", "tiled_parallel.tiles",
+ * "tiled_dimensions.tiles" and "truncated.tiles" in "../tests/weight_matrix/".
+ * These files are implicitly removed in "training.test.cpp". The directory
+ * "occupied.tiles", created there to make a fill fail, is removed by the
+ * test itself.
+ *
+ * This test does not use the patterns in "../tests/patterns/".
+ */
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+
+// These four paths are the only ones relative to
+// "tiled_weight_matrix.test.cpp"
+#include "../../include/tiled_weight_matrix.hpp"
+#include "../../include/weight_matrix.hpp"
+#include "../doctest.h"
+#include "random_patterns.hpp"
+
+#include <algorithm>
+#include <fstream>
+
+TEST_CASE("Testing the tiled weight matrix")
+{
+  // 128 neurons in tiles of 48: 3 rows of tiles, the last ones partial
+  constexpr std::size_t N{128};
+  constexpr std::size_t tile_size{48};
+  constexpr std::size_t tile_bytes{tile_size * tile_size * sizeof(double)};
+  auto patterns = random_patterns(70, N, 18);
+
+  nn::Weight_Matrix weight_matrix(N);
+  weight_matrix.fill(patterns, N);
+
+  // The cache holds two of the six tiles
+  nn::Tiled_Weight_Matrix tiled(N, 2 * tile_bytes, tile_size);
+  CHECK(!tiled.is_open());
+  CHECK(tiled.tiles() == 6);
+  CHECK(tiled.max_resident_bytes() == 4 * tile_bytes);
+
+  tiled.fill(patterns, N, "../tests/weight_matrix/", "tiled.tiles");
+  REQUIRE(tiled.is_open());
+  CHECK(std::filesystem::file_size("../tests/weight_matrix/tiled.tiles")
+        == sizeof(nn::Tiled_Weight_Matrix_Header) + 6 * tile_bytes);
+
+  SUBCASE("The weights are the ones of Weight_Matrix::fill()")
+  {
+    for (std::size_t i{1}; i <= N; ++i) {
+      for (std::size_t j{1}; j <= N; ++j) {
+        REQUIRE(tiled.at(i, j) == weight_matrix.at(i, j));
+      }
+    }
+    CHECK(tiled.cached_tiles() == 2);
+    CHECK_THROWS(tiled.at(0, 1));
+    CHECK_THROWS(tiled.at(1, N + 1));
+  }
+
+  SUBCASE("The local fields are the ones of Weight_Matrix::multiply()")
+  {
+    // N is a power of two, so the additions are exact whatever their order
+    for (auto const& state : random_patterns(4, N, 81)) {
+      std::vector<double> expected(N);
+      std::vector<double> result(N);
+      weight_matrix.multiply(state, expected);
+      tiled.multiply(state, result);
+      CHECK(result == expected);
+      CHECK(tiled.cached_tiles() <= 2);
+    }
+  }
+
+  SUBCASE("Without cache the tiles are read at every use")
+  {
+    nn::Tiled_Weight_Matrix uncached(N, 0, tile_size);
+    uncached.load_from_file("../tests/weight_matrix/", "tiled.tiles", N);
+    CHECK(uncached.max_resident_bytes() == 2 * tile_bytes);
+
+    auto const& state = patterns.front();
+    std::vector<double> expected(N);
+    std::vector<double> result(N);
+    weight_matrix.multiply(state, expected);
+    uncached.multiply(state, result);
+    CHECK(result == expected);
+    CHECK(uncached.at(5, 100) == weight_matrix.at(5, 100));
+    CHECK(uncached.cached_tiles() == 0);
+  }
+
+  SUBCASE("Filling in parallel")
+  {
+    nn::Thread_Pool pool(4);
+    nn::Tiled_Weight_Matrix parallel(N, 0, tile_size);
+    parallel.fill(patterns, N, pool, "../tests/weight_matrix/",
+                  "tiled_parallel.tiles", {16, 8});
+
+    std::ifstream first{"../tests/weight_matrix/tiled.tiles", std::ios::binary};
+    std::ifstream second{"../tests/weight_matrix/tiled_parallel.tiles",
+                         std::ios::binary};
+    first.seekg(sizeof(nn::Tiled_Weight_Matrix_Header));
+    second.seekg(sizeof(nn::Tiled_Weight_Matrix_Header));
+    CHECK(std::equal(std::istreambuf_iterator<char>{first},
+                     std::istreambuf_iterator<char>{},
+                     std::istreambuf_iterator<char>{second},
+                     std::istreambuf_iterator<char>{}));
+  }
+
+  SUBCASE("Loading a file with another tile size or number of neurons")
+  {
+    nn::Tiled_Weight_Matrix other_tiles(N, 0, 32);
+    CHECK_THROWS(other_tiles.load_from_file("../tests/weight_matrix/",
+                                            "tiled.tiles", N));
+    CHECK(!other_tiles.is_open());
+
+    nn::Tiled_Weight_Matrix other_neurons(N - 1, 0, tile_size);
+    CHECK_THROWS(other_neurons.load_from_file("../tests/weight_matrix/",
+                                              "tiled.tiles", N - 1));
+    CHECK_THROWS(other_neurons.load_from_file("../tests/weight_matrix/",
+                                              "non_existing.tiles", N - 1));
+  }
+
+  SUBCASE("Failing to write a file")
+  {
+    // A directory in the way of the rename: the temporary file is removed
+    std::filesystem::create_directories(
+        "../tests/weight_matrix/occupied.tiles/inside");
+    nn::Tiled_Weight_Matrix occupied(N, 0, tile_size);
+    CHECK_THROWS(occupied.fill(patterns, N, "../tests/weight_matrix/",
+                               "occupied.tiles"));
+    CHECK(!occupied.is_open());
+    CHECK(!std::filesystem::exists(
+        "../tests/weight_matrix/occupied.tiles.tmp"));
+    std::filesystem::remove_all("../tests/weight_matrix/occupied.tiles");
+  }
+
+  SUBCASE("Loading a truncated file")
+  {
+    std::filesystem::copy_file(
+        "../tests/weight_matrix/tiled.tiles",
+        "../tests/weight_matrix/truncated.tiles",
+        std::filesystem::copy_options::overwrite_existing);
+    std::filesystem::resize_file("../tests/weight_matrix/truncated.tiles",
+                                 sizeof(nn::Tiled_Weight_Matrix_Header)
+                                     + 5 * tile_bytes);
+
+    nn::Tiled_Weight_Matrix truncated(N, 0, tile_size);
+    CHECK_THROWS(truncated.load_from_file("../tests/weight_matrix/",
+                                          "truncated.tiles", N));
+  }
+}
+
+TEST_CASE("Testing a single tile")
+{
+  // One tile larger than the network: the whole triangle in one read
+  constexpr std::size_t N{16};
+  auto patterns = random_patterns(3, N, 7);
+
+  nn::Weight_Matrix weight_matrix(N);
+  weight_matrix.fill(patterns, N);
+
+  nn::Tiled_Weight_Matrix tiled(N, nn::default_tile_cache_bytes);
+  CHECK(tiled.tile_size() == nn::default_weight_tile_size);
+  CHECK(tiled.tiles() == 1);
+  tiled.fill(patterns, N, "../tests/weight_matrix/", "tiled_dimensions.tiles",
+             {4, 4});
+
+  std::vector<double> expected(N);
+  std::vector<double> result(N);
+  weight_matrix.multiply(patterns[1], expected);
+  tiled.multiply(patterns[1], result);
+  CHECK(result == expected);
+  CHECK(tiled.cached_tiles() == 1);
+
+  std::ifstream file{"../tests/weight_matrix/tiled_dimensions.tiles",
+                     std::ios::binary};
+  nn::Tiled_Weight_Matrix_Header header;
+  REQUIRE(file.read(reinterpret_cast<char*>(&header), sizeof(header)));
+  CHECK(header.width == 4);
+  CHECK(header.height == 4);
+  CHECK(header.neurons == N);
+}
\ No newline at end of file
@@ -2,8 +2,10 @@
 
 /*
  * This test takes as input the patterns "1.txt", "2.txt", "3.txt", "4.txt" in
- * "../tests/patterns/" and generates the weight matrix "weight_matrix.txt" in
- * "../tests/weight_matrix/".
+ * "../tests/patterns/" and generates the weight matrix "weight_matrix.bin",
+ * the pattern memory "pattern_memory.bin" and the tiled weight matrix
+ * "weight_matrix.tiles" in "../tests/weight_matrix/". The weight matrix is
+ * also updated incrementally, and then regenerated.
  *
  * This test writes temporary files to perform the necessary checks.
  *
@@ -16,9 +18,11 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 
 // These two paths are the only ones relative to "training.test.cpp"
+#include "../../include/pattern.hpp"
 #include "../../include/training.hpp"
 #include "../doctest.h"
 
+#include <algorithm>
 #include <fstream>
 
 TEST_CASE("Testing the Training class on invalid directories")
@@ -69,6 +73,7 @@ TEST_CASE("Testing acquire_and_save_weight_matrix()")
 {
   nn::Training training{"tests/"};
   REQUIRE(training.weight_matrix().neurons() == 4096);
+  REQUIRE(training.dimensions() == nn::Dimensions{64, 64});
   REQUIRE(training.weight_matrix().weights().size() == 0);
 
   SUBCASE("Acquiring an under-sized pattern \"(under_sized.txt)\"")
@@ -88,18 +93,24 @@ TEST_CASE("Testing acquire_and_save_weight_matrix()")
   }
 
   SUBCASE("Acquiring all the patterns in the directory and filling the weight "
-          "matrix")
+          "matrix and the pattern memory")
   {
     training.acquire_and_save_weight_matrix();
     CHECK(training.weight_matrix().weights().size() == 4096 * 4095 / 2);
 
     CHECK(std::filesystem::is_regular_file(
-        "../tests/weight_matrix/weight_matrix.txt"));
+        "../tests/weight_matrix/weight_matrix.bin"));
 
     nn::Weight_Matrix weight_matrix;
-    weight_matrix.load_from_file("../tests/weight_matrix/", "weight_matrix.txt",
+    weight_matrix.load_from_file("../tests/weight_matrix/", "weight_matrix.bin",
                                  4096);
+    CHECK(weight_matrix.is_mapped());
+    CHECK(nn::read_weight_matrix_dimensions(
+              "../tests/weight_matrix/weight_matrix.bin")
+          == nn::Dimensions{64, 64});
     CHECK(weight_matrix.weights().size() == 4096 * 4095 / 2);
+    CHECK(std::ranges::equal(weight_matrix.weights(),
+                             training.weight_matrix().weights()));
 
     CHECK(weight_matrix.at(1, 12)
           == doctest::Approx(0.000488281).epsilon(0.000000001));
@@ -109,5 +120,98 @@ TEST_CASE("Testing acquire_and_save_weight_matrix()")
           == doctest::Approx(0.000976562).epsilon(0.000000001));
     CHECK(weight_matrix.at(4095, 4096)
           == doctest::Approx(0.000976562).epsilon(0.000000001));
+
+    training.acquire_and_save_pattern_memory();
+    CHECK(training.pattern_memory().size() == 4);
+    CHECK(std::filesystem::is_regular_file(
+        "../tests/weight_matrix/pattern_memory.bin"));
+
+    nn::Pattern_Memory pattern_memory;
+    pattern_memory.load_from_file("../tests/weight_matrix/",
+                                  "pattern_memory.bin", 4096);
+    REQUIRE(pattern_memory.size() == 4);
+    CHECK(pattern_memory.at(1, 12) == weight_matrix.at(1, 12));
+    CHECK(pattern_memory.at(2, 5) == weight_matrix.at(2, 5));
+    CHECK(pattern_memory.at(4094, 4095) == weight_matrix.at(4094, 4095));
+    CHECK(pattern_memory.at(4095, 4096) == weight_matrix.at(4095, 4096));
+
+    // Tiles of 1000 neurons: the last row and column of tiles are partial
+    training.acquire_and_save_tiled_weight_matrix(1000);
+    CHECK(nn::read_tiled_weight_matrix_dimensions(
+              "../tests/weight_matrix/weight_matrix.tiles")
+          == nn::Dimensions{64, 64});
+    nn::Tiled_Weight_Matrix tiled(4096, 0, 1000);
+    tiled.load_from_file("../tests/weight_matrix/", "weight_matrix.tiles",
+                         4096);
+    CHECK(tiled.at(1, 12) == weight_matrix.at(1, 12));
+    CHECK(tiled.at(999, 1001) == weight_matrix.at(999, 1001));
+    CHECK(tiled.at(4095, 4096) == weight_matrix.at(4095, 4096));
+    CHECK_THROWS(training.acquire_and_save_tiled_weight_matrix(0));
+  }
+}
+
+TEST_CASE("Testing update_and_save_weight_matrix()")
+{
+  SUBCASE("Missing weight matrix")
+  {
+    std::filesystem::remove("../tests/weight_matrix/weight_matrix.bin");
+    CHECK_THROWS(nn::Training("tests/", nn::Training_Mode::incremental));
+  }
+
+  nn::Training full{"tests/"};
+  full.acquire_and_save_weight_matrix(nn::Weight_Storage::counts);
+  nn::Weight_Matrix original{full.weight_matrix()};
+
+  nn::Training training{"tests/", nn::Training_Mode::incremental};
+  CHECK(training.mode() == nn::Training_Mode::incremental);
+  CHECK(std::filesystem::is_regular_file(
+      "../tests/weight_matrix/weight_matrix.bin"));
+
+  auto saved_counts = [] {
+    nn::Weight_Matrix weight_matrix;
+    weight_matrix.load_from_file("../tests/weight_matrix/",
+                                 "weight_matrix.bin", 4096);
+    CHECK(weight_matrix.storage() == nn::Weight_Storage::counts);
+    return weight_matrix.visit([](auto elements, double) {
+      return std::vector<int>(elements.begin(), elements.end());
+    });
+  };
+  auto original_counts = original.visit([](auto elements, double) {
+    return std::vector<int>(elements.begin(), elements.end());
+  });
+
+  SUBCASE("Removing a pattern and adding it back")
+  {
+    training.update_and_save_weight_matrix({}, {"../tests/patterns/4.txt"});
+    auto counts = saved_counts();
+    CHECK(counts != original_counts);
+
+    // Same weights as a full training on the other patterns
+    nn::Pattern pattern;
+    std::vector<std::vector<int>> patterns;
+    for (auto name : {"1.txt", "2.txt", "3.txt"}) {
+      pattern.load_from_file("../tests/patterns/", name, 4096);
+      patterns.push_back(pattern.pattern());
+    }
+    nn::Weight_Matrix expected;
+    expected.fill(patterns, 4096, nn::Weight_Storage::counts);
+    CHECK(counts == expected.visit([](auto elements, double) {
+      return std::vector<int>(elements.begin(), elements.end());
+    }));
+
+    training.update_and_save_weight_matrix({"../tests/patterns/4.txt"}, {});
+    CHECK(saved_counts() == original_counts);
   }
+
+  SUBCASE("Invalid files leave the matrix unchanged")
+  {
+    CHECK_THROWS(training.update_and_save_weight_matrix(
+        {"../tests/patterns/4.txt"}, {"../tests/patterns/non_existing.txt"}));
+    CHECK(saved_counts() == original_counts);
+  }
+
+  // Leaves the files of the previous test case in place
+  full.acquire_and_save_weight_matrix();
+  full.acquire_and_save_pattern_memory();
+  full.acquire_and_save_tiled_weight_matrix();
 }
\ No newline at end of file
@@ -2,7 +2,10 @@
 
 /*
  * This test generates the files "empty_matrix.txt", "empty_matrix_1.txt",
- * "test1.txt", "test2.txt", "test.txt" in "../tests/weight_matrix/".
+ * "test1.txt", "test2.txt", "test.txt", "test1.bin", "empty_matrix.bin",
+ * "corrupted.bin", "counts8.bin", "counts16.bin",
+ * "counts.txt", "dense.bin", "incremental.bin", "dimensions.bin" in
+ * "../tests/weight_matrix/".
  * These files are implicitly removed in "training.test.cpp".
  *
  * This test does not use the patterns in "../tests/patterns/".
@@ -10,12 +13,18 @@
 
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 
-// These two paths are the only ones relative to "weight_matrix.test.cpp"
+// These four paths are the only ones relative to "weight_matrix.test.cpp"
 #include "../../include/weight_matrix.hpp"
+#include "../../include/weight_matrix_kernels.hpp"
 #include "../doctest.h"
+#include "random_patterns.hpp"
 
 #include <algorithm>
+#include <bit>
 #include <fstream>
+#include <random>
+#include <thread>
+#include <type_traits>
 
 TEST_CASE("Testing index conversion")
 {
@@ -173,6 +182,72 @@ TEST_CASE("Testing the fill method")
   }
 }
 
+TEST_CASE("Testing the tiled fill")
+{
+  // More neurons than a tile and more patterns than a slice of a tile
+  constexpr std::size_t neurons{150};
+  auto patterns = random_patterns(700, neurons, 3);
+
+  std::vector<double> expected;
+  for (std::size_t i{1}; i != neurons; ++i) {
+    for (std::size_t j{i + 1}; j <= neurons; ++j) {
+      expected.push_back(nn::compute_weight_ij(i, j, neurons, patterns));
+    }
+  }
+
+  SUBCASE("Serial fill")
+  {
+    nn::Weight_Matrix weight_matrix(neurons);
+    weight_matrix.fill(patterns, neurons);
+    CHECK(std::ranges::equal(weight_matrix.weights(), expected));
+  }
+
+  SUBCASE("Parallel fill")
+  {
+    for (std::size_t threads : {1u, 2u, 3u}) {
+      nn::Thread_Pool pool(threads);
+      nn::Weight_Matrix weight_matrix(neurons);
+      weight_matrix.fill(patterns, neurons, pool);
+      CHECK(std::ranges::equal(weight_matrix.weights(), expected));
+    }
+  }
+
+  SUBCASE("No patterns")
+  {
+    nn::Weight_Matrix weight_matrix(neurons);
+    weight_matrix.fill({}, neurons);
+    CHECK(weight_matrix.weights().size() == neurons * (neurons - 1) / 2);
+    CHECK(std::ranges::all_of(weight_matrix.weights(),
+                              [](double weight) { return weight == 0.; }));
+  }
+}
+
+TEST_CASE("Testing the XOR-popcount kernels")
+{
+  auto kernels = nn::different_bits_kernels();
+  REQUIRE(!kernels.empty());
+  CHECK(kernels.front().name == "portable");
+
+  // Lengths around the 4 words of an AVX2 register, to reach its tail loop
+  std::mt19937_64 engine{5};
+  for (std::size_t words : {0u, 1u, 3u, 4u, 5u, 67u}) {
+    std::vector<std::uint64_t> first(words);
+    std::vector<std::uint64_t> second(words);
+    std::int64_t expected{0};
+    for (std::size_t w{0}; w != words; ++w) {
+      first[w]  = engine();
+      second[w] = engine();
+      expected += std::popcount(first[w] ^ second[w]);
+    }
+
+    for (auto const& kernel : kernels) {
+      INFO(kernel.name, ", ", words, " words");
+      CHECK(kernel.function(first.data(), second.data(), words) == expected);
+      CHECK(kernel.function(first.data(), first.data(), words) == 0);
+    }
+  }
+}
+
 TEST_CASE("Testing the at method")
 {
   nn::Weight_Matrix weight_matrix(4);
@@ -203,6 +278,24 @@ TEST_CASE("Testing the at method")
   CHECK(weight_matrix.at(4, 4) == 0.);
 }
 
+TEST_CASE("Testing the accumulate_row method")
+{
+  nn::Weight_Matrix weight_matrix(5);
+  std::vector<std::vector<int>> patterns{
+      {1, -1, 1, 1, 1},   {-1, -1, 1, 1, -1},   {-1, 1, 1, -1, -1},
+      {1, 1, -1, -1, -1}, {-1, -1, -1, -1, -1}, {1, 1, 1, 1, -1}};
+  weight_matrix.fill(patterns, 5);
+  REQUIRE(weight_matrix.weights().size() == 10);
+
+  for (std::size_t i{1}; i <= 5; ++i) {
+    std::vector<double> target(5, 1.);
+    weight_matrix.accumulate_row(i, -2., target);
+    for (std::size_t j{1}; j <= 5; ++j) {
+      CHECK(target[j - 1] == 1. - 2. * weight_matrix.at(i, j));
+    }
+  }
+}
+
 TEST_CASE("Testing input and output")
 {
   SUBCASE("Saving an empty weight matrix")
@@ -277,7 +370,7 @@ TEST_CASE("Testing input and output")
     CHECK(wm.weights().size() == 10);
 
     std::size_t i{0};
-    CHECK((wm.weights() == values));
+    CHECK(std::ranges::equal(wm.weights(), values));
     CHECK(std::all_of(wm.weights().begin(), wm.weights().end(),
                       [&i, &values](double w) {
                         ++i;
@@ -307,3 +400,550 @@ TEST_CASE("Testing input and output")
     CHECK(wm.weights().size() == 10);
   }
 }
+
+TEST_CASE("Testing the binary format")
+{
+  nn::Weight_Matrix weight_matrix(5);
+  std::vector<std::vector<int>> patterns{
+      {1, -1, 1, 1, 1},   {-1, -1, 1, 1, -1},   {-1, 1, 1, -1, -1},
+      {1, 1, -1, -1, -1}, {-1, -1, -1, -1, -1}, {1, 1, 1, 1, -1}};
+  weight_matrix.fill(patterns, 5);
+  REQUIRE(weight_matrix.weights().size() == 10);
+  REQUIRE(!weight_matrix.is_mapped());
+
+  weight_matrix.save_to_file("../tests/weight_matrix/", "test1.bin", 5);
+  REQUIRE(std::filesystem::is_regular_file("../tests/weight_matrix/test1.bin"));
+  CHECK(std::filesystem::file_size("../tests/weight_matrix/test1.bin")
+        == sizeof(nn::Weight_Matrix_Header) + 10 * sizeof(double));
+
+  SUBCASE("Saving and mapping the same weight matrix")
+  {
+    nn::Weight_Matrix wm(5);
+    wm.load_from_file("../tests/weight_matrix/", "test1.bin", 5);
+    CHECK(wm.is_mapped());
+    CHECK(wm.weights().size() == 10);
+    CHECK(std::ranges::equal(wm.weights(), weight_matrix.weights()));
+    CHECK(wm.at(3, 4) == .8);
+    CHECK(wm.at(5, 2) == -.4);
+    CHECK(wm.at(2, 2) == 0.);
+
+    // The mapping is shared by copies and released by the last one
+    auto copy = wm;
+    CHECK(copy.weights().data() == wm.weights().data());
+  }
+
+  SUBCASE("Converting between the text and the binary format")
+  {
+    nn::Weight_Matrix wm(5);
+    wm.load_from_file("../tests/weight_matrix/", "test1.bin", 5);
+    wm.save_to_file("../tests/weight_matrix/", "test1.txt", 5);
+    wm.load_from_file("../tests/weight_matrix/", "test1.txt", 5);
+    CHECK(!wm.is_mapped());
+    CHECK(std::ranges::equal(wm.weights(), weight_matrix.weights()));
+  }
+
+  SUBCASE("Saving and mapping an empty weight matrix")
+  {
+    nn::Weight_Matrix wm(0);
+    wm.save_to_file("../tests/weight_matrix/", "empty_matrix.bin", 0);
+    CHECK(std::filesystem::file_size("../tests/weight_matrix/empty_matrix.bin")
+          == sizeof(nn::Weight_Matrix_Header));
+    wm.load_from_file("../tests/weight_matrix/", "empty_matrix.bin", 0);
+    CHECK(wm.weights().size() == 0);
+  }
+
+  SUBCASE("Mapping a weight matrix with a different number of neurons")
+  {
+    nn::Weight_Matrix wm(4);
+    CHECK_THROWS(wm.load_from_file("../tests/weight_matrix/", "test1.bin", 4));
+  }
+
+  SUBCASE("Mapping a corrupted weight matrix")
+  {
+    std::filesystem::copy_file(
+        "../tests/weight_matrix/test1.bin",
+        "../tests/weight_matrix/corrupted.bin",
+        std::filesystem::copy_options::overwrite_existing);
+    std::fstream corrupted{"../tests/weight_matrix/corrupted.bin",
+                           std::ios::in | std::ios::out | std::ios::binary};
+    corrupted.seekp(sizeof(nn::Weight_Matrix_Header) + 3);
+    corrupted.put('\x7f');
+    corrupted.close();
+
+    nn::Weight_Matrix wm(5);
+    CHECK_THROWS(
+        wm.load_from_file("../tests/weight_matrix/", "corrupted.bin", 5));
+    CHECK(wm.weights().size() == 0);
+
+    // A text file is not a valid binary file
+    std::filesystem::copy_file(
+        "../tests/weight_matrix/test.txt",
+        "../tests/weight_matrix/corrupted.bin",
+        std::filesystem::copy_options::overwrite_existing);
+    CHECK_THROWS(
+        wm.load_from_file("../tests/weight_matrix/", "corrupted.bin", 5));
+  }
+
+  SUBCASE("Sharing a weight matrix through POSIX shared memory")
+  {
+    weight_matrix.save_to_shared_memory("/hnn_weight_matrix_test");
+
+    nn::Weight_Matrix first(5);
+    nn::Weight_Matrix second(5);
+    first.load_from_shared_memory("/hnn_weight_matrix_test", 5);
+    second.load_from_shared_memory("/hnn_weight_matrix_test", 5);
+    CHECK(first.is_mapped());
+    CHECK(std::ranges::equal(first.weights(), weight_matrix.weights()));
+    CHECK(std::ranges::equal(second.weights(), weight_matrix.weights()));
+
+    nn::Weight_Matrix other(4);
+    CHECK_THROWS(other.load_from_shared_memory("/hnn_weight_matrix_test", 4));
+
+    // The mappings outlive the object
+    nn::remove_shared_weight_matrix("/hnn_weight_matrix_test");
+    CHECK(first.at(3, 4) == .8);
+    CHECK_THROWS(second.load_from_shared_memory("/hnn_weight_matrix_test", 5));
+  }
+
+  SUBCASE("Loading a shared weight matrix once")
+  {
+    auto first =
+        nn::load_shared_weight_matrix("../tests/weight_matrix/test1.bin", 5);
+    auto second =
+        nn::load_shared_weight_matrix("../tests/weight_matrix/test1.bin", 5);
+    CHECK(first == second);
+    CHECK(std::ranges::equal(first->weights(), weight_matrix.weights()));
+
+    // A file saved again is loaded again
+    weight_matrix.save_to_file("../tests/weight_matrix/", "test1.bin", 5);
+    auto third =
+        nn::load_shared_weight_matrix("../tests/weight_matrix/test1.bin", 5);
+    CHECK(third != first);
+    CHECK(std::ranges::equal(third->weights(), weight_matrix.weights()));
+
+    // Concurrent loads of a released file share the matrix of one of them
+    first.reset();
+    second.reset();
+    third.reset();
+    std::vector<nn::Shared_Weight_Matrix> matrices(4);
+    std::vector<std::thread> threads;
+    for (auto& matrix : matrices) {
+      threads.emplace_back([&matrix] {
+        matrix = nn::load_shared_weight_matrix(
+            "../tests/weight_matrix/test1.bin", 5);
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    CHECK(std::all_of(
+        matrices.begin(), matrices.end(),
+        [&](auto const& matrix) { return matrix == matrices.front(); }));
+
+    CHECK_THROWS(nn::load_shared_weight_matrix(
+        "../tests/weight_matrix/non_existing.bin", 5));
+  }
+}
+
+TEST_CASE("Testing the count storage")
+{
+  constexpr std::size_t neurons{128};
+
+  // 8-bit counts up to 127 patterns, 16-bit counts from 128 patterns
+  for (std::size_t count : {10u, 127u, 128u, 300u}) {
+    auto patterns = random_patterns(count, neurons, 5);
+
+    nn::Weight_Matrix real(neurons);
+    real.fill(patterns, neurons);
+    nn::Weight_Matrix counts(neurons);
+    counts.fill(patterns, neurons, nn::Weight_Storage::counts);
+    REQUIRE(counts.storage() == nn::Weight_Storage::counts);
+    REQUIRE(counts.size() == neurons * (neurons - 1) / 2);
+
+    auto bytes = counts.visit(
+        [](auto elements, double) { return elements.size_bytes(); });
+    CHECK(bytes * (count < 128 ? 8 : 4) == real.weights().size_bytes());
+
+    for (std::size_t i{1}; i <= neurons; ++i) {
+      for (std::size_t j{1}; j <= neurons; ++j) {
+        REQUIRE(counts.at(i, j) == real.at(i, j));
+      }
+    }
+
+    // Bit-identical accumulations, N being a power of two
+    std::vector<double> expected(neurons, .5);
+    std::vector<double> target(neurons, .5);
+    for (std::size_t i{1}; i <= neurons; i += 7) {
+      real.accumulate_row(i, -2., expected);
+      counts.accumulate_row(i, -2., target);
+    }
+    CHECK(target == expected);
+
+    nn::Thread_Pool pool(3);
+    nn::Weight_Matrix parallel(neurons);
+    parallel.fill(patterns, neurons, pool, nn::Weight_Storage::counts);
+    CHECK(parallel.visit([&counts](auto elements, double) {
+      return counts.visit([&elements](auto other, double) {
+        return std::ranges::equal(elements, other);
+      });
+    }));
+  }
+
+  SUBCASE("Saving and mapping counts")
+  {
+    for (std::size_t count : {10u, 300u}) {
+      auto patterns = random_patterns(count, neurons, 5);
+      std::filesystem::path name{count < 128 ? "counts8.bin" : "counts16.bin"};
+
+      nn::Weight_Matrix counts(neurons);
+      counts.fill(patterns, neurons, nn::Weight_Storage::counts);
+      counts.save_to_file("../tests/weight_matrix/", name, neurons);
+      CHECK(std::filesystem::file_size("../tests/weight_matrix/" / name)
+            == sizeof(nn::Weight_Matrix_Header)
+                   + neurons * (neurons - 1) / 2 * (count < 128 ? 1 : 2));
+
+      nn::Weight_Matrix wm(neurons);
+      wm.load_from_file("../tests/weight_matrix/", name, neurons);
+      CHECK(wm.is_mapped());
+      CHECK(wm.storage() == nn::Weight_Storage::counts);
+      CHECK(wm.at(3, 100) == counts.at(3, 100));
+      CHECK(wm.at(100, 3) == counts.at(100, 3));
+      CHECK(wm.at(7, 7) == 0.);
+
+      // Loading a text file restores the real storage
+      wm.save_to_file("../tests/weight_matrix/", "counts.txt", neurons);
+      wm.load_from_file("../tests/weight_matrix/", "counts.txt", neurons);
+      CHECK(wm.storage() == nn::Weight_Storage::real);
+    }
+  }
+}
+
+TEST_CASE("Testing the count_products method")
+{
+  // Sizes which are not multiples of the vector widths, 8-bit and 16-bit
+  // counts
+  for (std::size_t neurons : {1u, 2u, 9u, 37u, 100u}) {
+    for (std::size_t count : {3u, 200u}) {
+      auto patterns = random_patterns(count, neurons, 6);
+      nn::Weight_Matrix counts(neurons);
+      counts.fill(patterns, neurons, nn::Weight_Storage::counts);
+
+      for (auto const& state : random_patterns(3, neurons, 7)) {
+        std::vector<std::int16_t> values(neurons);
+        std::vector<std::int32_t> sums(neurons, 42);
+        counts.count_products(state, values, sums);
+        for (std::size_t i{1}; i <= neurons; ++i) {
+          std::int32_t expected{0};
+          for (std::size_t j{1}; j <= neurons; ++j) {
+            for (auto const& pattern : patterns) {
+              if (j != i) {
+                expected += pattern[i - 1] * pattern[j - 1] * state[j - 1];
+              }
+            }
+          }
+          REQUIRE(sums[i - 1] == expected);
+        }
+      }
+    }
+  }
+}
+
+// Every kernel adds the sums of the definition, for counts up to the limits
+// of Count
+template<class Count>
+void check_count_products_kernels(std::default_random_engine& engine)
+{
+  auto kernels = nn::count_products_kernels<Count>();
+  REQUIRE(!kernels.empty());
+  CHECK(kernels.front().name == "portable");
+
+  constexpr int limit{std::is_same_v<Count, std::int8_t> ? 127 : 32'767};
+  std::uniform_int_distribution<int> count_dist{-limit, limit};
+  std::bernoulli_distribution value_dist{0.5};
+
+  // Neurons around the 8 and 16 counts of the SSE4.1 and AVX2 registers
+  for (std::size_t neurons : {1u, 2u, 7u, 9u, 16u, 17u, 33u, 100u}) {
+    std::vector<Count> counts(neurons * (neurons - 1) / 2);
+    for (auto& count : counts) {
+      count = static_cast<Count>(count_dist(engine));
+    }
+    std::vector<std::int16_t> state(neurons);
+    for (auto& value : state) {
+      value = value_dist(engine) ? +1 : -1;
+    }
+
+    std::vector<std::int32_t> expected(neurons, 42);
+    for (std::size_t i{1}; i <= neurons; ++i) {
+      for (std::size_t j{1}; j <= neurons; ++j) {
+        if (j != i) {
+          expected[i - 1] += counts[nn::matrix_to_vector_index(i, j, neurons)]
+                           * state[j - 1];
+        }
+      }
+    }
+    for (auto const& kernel : kernels) {
+      INFO(kernel.name, ", ", neurons, " neurons");
+      std::vector<std::int32_t> sums(neurons, 42);
+      kernel.function(counts, state, sums);
+      CHECK(sums == expected);
+    }
+  }
+}
+
+TEST_CASE("Testing the count_products kernels")
+{
+  std::default_random_engine engine{8};
+  check_count_products_kernels<std::int8_t>(engine);
+  check_count_products_kernels<std::int16_t>(engine);
+}
+
+TEST_CASE("Testing the row_product and multiply methods")
+{
+  // Sums with the same order of the additions as the ones over at() are equal
+  // also when N is not a power of two
+  constexpr std::size_t neurons{75};
+  auto patterns = random_patterns(9, neurons, 7);
+  auto state    = random_patterns(1, neurons, 70).front();
+
+  for (auto storage : {nn::Weight_Storage::real, nn::Weight_Storage::counts}) {
+    nn::Weight_Matrix weight_matrix(neurons);
+    weight_matrix.fill(patterns, neurons, storage);
+
+    std::vector<double> expected(neurons, 0.);
+    for (std::size_t i{1}; i <= neurons; ++i) {
+      for (std::size_t j{1}; j <= neurons; ++j) {
+        expected[i - 1] += weight_matrix.at(i, j) * state[j - 1];
+      }
+      CHECK(weight_matrix.row_product(i, state) == expected[i - 1]);
+    }
+
+    std::vector<double> result(neurons, 1.);
+    weight_matrix.multiply(state, result);
+    CHECK(result == expected);
+  }
+
+  // A shorter state only gives the products with its first neurons
+  nn::Weight_Matrix weight_matrix(neurons);
+  weight_matrix.fill(patterns, neurons);
+  std::vector<int> prefix(state.begin(), state.begin() + 10);
+  for (std::size_t i{1}; i <= 10; ++i) {
+    double expected{0.};
+    for (std::size_t j{1}; j <= 10; ++j) {
+      expected += weight_matrix.at(i, j) * prefix[j - 1];
+    }
+    CHECK(weight_matrix.row_product(i, prefix) == expected);
+  }
+}
+
+TEST_CASE("Testing the dense layout")
+{
+  constexpr std::size_t neurons{21};
+  auto patterns = random_patterns(6, neurons, 8);
+  auto state    = random_patterns(1, neurons, 80).front();
+
+  nn::Weight_Matrix packed(neurons);
+  packed.fill(patterns, neurons);
+  REQUIRE(packed.layout() == nn::Weight_Layout::packed);
+
+  nn::Weight_Matrix dense = packed;
+  dense.set_layout(nn::Weight_Layout::dense);
+  REQUIRE(dense.layout() == nn::Weight_Layout::dense);
+  REQUIRE(dense.size() == neurons * (neurons - 1) / 2);
+
+  for (std::size_t i{1}; i <= neurons; ++i) {
+    auto row = dense.row(i);
+    CHECK(row.size() == neurons);
+    CHECK(reinterpret_cast<std::uintptr_t>(row.data()) % 64 == 0);
+    for (std::size_t j{1}; j <= neurons; ++j) {
+      REQUIRE(row[j - 1] == packed.at(i, j));
+      REQUIRE(dense.at(i, j) == packed.at(i, j));
+    }
+    CHECK(dense.row_product(i, state) == packed.row_product(i, state));
+
+    std::vector<double> expected(neurons, .25);
+    std::vector<double> target(neurons, .25);
+    packed.accumulate_row(i, -2., expected);
+    dense.accumulate_row(i, -2., target);
+    CHECK(target == expected);
+  }
+
+  std::vector<double> expected(neurons);
+  std::vector<double> result(neurons);
+  packed.multiply(state, expected);
+  dense.multiply(state, result);
+  CHECK(result == expected);
+
+  SUBCASE("Converting back to the packed layout")
+  {
+    dense.set_layout(nn::Weight_Layout::packed);
+    CHECK(dense.layout() == nn::Weight_Layout::packed);
+    CHECK(std::ranges::equal(dense.weights(), packed.weights()));
+  }
+
+  SUBCASE("Saving a dense matrix and loading it as dense")
+  {
+    dense.save_to_file("../tests/weight_matrix/", "dense.bin", neurons);
+    CHECK(std::filesystem::file_size("../tests/weight_matrix/dense.bin")
+          == sizeof(nn::Weight_Matrix_Header)
+                 + neurons * (neurons - 1) / 2 * sizeof(double));
+
+    nn::Weight_Matrix wm(neurons);
+    wm.load_from_file("../tests/weight_matrix/", "dense.bin", neurons);
+    CHECK(wm.is_mapped());
+    CHECK(std::ranges::equal(wm.weights(), packed.weights()));
+
+    wm.load_from_file("../tests/weight_matrix/", "dense.bin", neurons,
+                      nn::Weight_Layout::dense);
+    CHECK(!wm.is_mapped());
+    CHECK(wm.layout() == nn::Weight_Layout::dense);
+    CHECK(wm.at(4, 17) == packed.at(4, 17));
+  }
+
+  SUBCASE("Counts cannot be dense")
+  {
+    nn::Weight_Matrix counts(neurons);
+    counts.fill(patterns, neurons, nn::Weight_Storage::counts);
+    CHECK_THROWS(counts.set_layout(nn::Weight_Layout::dense));
+    CHECK(counts.layout() == nn::Weight_Layout::packed);
+  }
+}
+
+TEST_CASE("Testing the add_pattern and remove_pattern methods")
+{
+  // Not a power of two, so the weights are not dyadic
+  constexpr std::size_t neurons{50};
+  auto patterns = random_patterns(8, neurons, 9);
+  auto first = std::vector<std::vector<int>>(patterns.begin(),
+                                             patterns.end() - 1);
+
+  auto equal = [](nn::Weight_Matrix const& lhs, nn::Weight_Matrix const& rhs) {
+    return lhs.storage() == rhs.storage()
+        && lhs.visit([&rhs](auto elements, double) {
+             return rhs.visit([&elements](auto other, double) {
+               return std::ranges::equal(elements, other);
+             });
+           });
+  };
+
+  for (auto storage : {nn::Weight_Storage::real, nn::Weight_Storage::counts}) {
+    nn::Weight_Matrix all(neurons);
+    all.fill(patterns, neurons, storage);
+    nn::Weight_Matrix original(neurons);
+    original.fill(first, neurons, storage);
+
+    auto wm = original;
+    wm.add_pattern(patterns.back());
+    CHECK(equal(wm, all));
+    wm.remove_pattern(patterns.back());
+    CHECK(equal(wm, original));
+
+    // Removing a stored pattern other than the last one
+    wm.remove_pattern(patterns.front());
+    nn::Weight_Matrix rest(neurons);
+    rest.fill(std::vector<std::vector<int>>(patterns.begin() + 1,
+                                            patterns.end() - 1),
+              neurons, storage);
+    CHECK(equal(wm, rest));
+  }
+
+  SUBCASE("Starting from an empty matrix")
+  {
+    nn::Weight_Matrix wm(neurons);
+    for (auto const& pattern : patterns) {
+      wm.add_pattern(pattern);
+    }
+    nn::Weight_Matrix all(neurons);
+    all.fill(patterns, neurons);
+    CHECK(std::ranges::equal(wm.weights(), all.weights()));
+  }
+
+  SUBCASE("Updating a mapped matrix")
+  {
+    nn::Weight_Matrix original(neurons);
+    original.fill(first, neurons, nn::Weight_Storage::counts);
+    original.save_to_file("../tests/weight_matrix/", "incremental.bin",
+                          neurons);
+
+    nn::Weight_Matrix wm(neurons);
+    wm.load_from_file("../tests/weight_matrix/", "incremental.bin", neurons);
+    REQUIRE(wm.is_mapped());
+    wm.add_pattern(patterns.back());
+    CHECK(!wm.is_mapped());
+    nn::Weight_Matrix all(neurons);
+    all.fill(patterns, neurons, nn::Weight_Storage::counts);
+    CHECK(equal(wm, all));
+
+    // The file is left unchanged
+    nn::Weight_Matrix saved(neurons);
+    saved.load_from_file("../tests/weight_matrix/", "incremental.bin",
+                         neurons);
+    CHECK(equal(saved, original));
+  }
+
+  SUBCASE("Updating a dense matrix")
+  {
+    nn::Weight_Matrix wm(neurons);
+    wm.fill(first, neurons);
+    wm.set_layout(nn::Weight_Layout::dense);
+    wm.add_pattern(patterns.back());
+    REQUIRE(wm.layout() == nn::Weight_Layout::dense);
+
+    nn::Weight_Matrix all(neurons);
+    all.fill(patterns, neurons);
+    for (std::size_t i{1}; i <= neurons; ++i) {
+      for (std::size_t j{1}; j <= neurons; ++j) {
+        REQUIRE(wm.at(i, j) == all.at(i, j));
+      }
+    }
+  }
+
+  SUBCASE("Widening the 8-bit counts")
+  {
+    std::vector<std::vector<int>> same(127, patterns.front());
+    nn::Weight_Matrix wm(neurons);
+    wm.fill(same, neurons, nn::Weight_Storage::counts);
+    REQUIRE(wm.visit([](auto elements, double) {
+      return sizeof(elements[0]);
+    }) == sizeof(std::int8_t));
+
+    wm.add_pattern(patterns.front());
+    CHECK(wm.visit([](auto elements, double) { return sizeof(elements[0]); })
+          == sizeof(std::int16_t));
+    same.push_back(patterns.front());
+    nn::Weight_Matrix all(neurons);
+    all.fill(same, neurons, nn::Weight_Storage::counts);
+    CHECK(equal(wm, all));
+  }
+}
+
+TEST_CASE("Testing the dimensions in the binary header")
+{
+  std::vector<std::vector<int>> patterns{std::vector<int>(32, +1)};
+  patterns[0][5] = -1;
+
+  nn::Weight_Matrix weight_matrix(32);
+  weight_matrix.fill(patterns, 32);
+
+  weight_matrix.save_to_file("../tests/weight_matrix/", "dimensions.bin",
+                             nn::Dimensions{8, 4});
+  CHECK(nn::read_weight_matrix_dimensions(
+            "../tests/weight_matrix/dimensions.bin")
+        == nn::Dimensions{8, 4});
+
+  nn::Weight_Matrix loaded(32);
+  loaded.load_from_file("../tests/weight_matrix/", "dimensions.bin", 32);
+  CHECK(std::ranges::equal(loaded.weights(), weight_matrix.weights()));
+
+  // Unknown dimensions of a network which is not square
+  weight_matrix.save_to_file("../tests/weight_matrix/", "dimensions.bin", 32);
+  CHECK_THROWS(nn::read_weight_matrix_dimensions(
+      "../tests/weight_matrix/dimensions.bin"));
+
+  // Unknown dimensions of a square network
+  nn::Weight_Matrix square(16);
+  square.fill({std::vector<int>(16, -1)}, 16);
+  square.save_to_file("../tests/weight_matrix/", "dimensions.bin", 16);
+  CHECK(nn::read_weight_matrix_dimensions(
+            "../tests/weight_matrix/dimensions.bin")
+        == nn::Dimensions{4, 4});
+}
\ No newline at end of file